@@ -3,6 +3,11 @@ import { ec as EC } from 'elliptic';
 
 const secp256k1 = new EC('secp256k1');
 
+// secp256k1 field prime p
+const FIELD_PRIME = Buffer.from('FFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFEFFFFFC2F', 'hex');
+
+let choicePointCache: Buffer | null = null;
+
 export class ECCUtils {
   /**
    * generate a random private scalar (32 byte Buffer)
@@ -62,6 +67,32 @@ export class ECCUtils {
     return Buffer.from(negated.encode('array', false));
   }
 
+  /**
+   * Fixed point T with unknown discrete log, hashed to the curve as the
+   * server's CryptoOperations::choicePoint() does: the first
+   * x = SHA-256("mta-cot choice point" || counter byte) below p that is on
+   * the curve, with even y. Bob publishes B = bG + cT for his choice bit c.
+   */
+  static choicePoint(): Buffer {
+    if (choicePointCache) {
+      return choicePointCache;
+    }
+    const tag = Buffer.from('mta-cot choice point', 'ascii');
+    for (let counter = 0; counter < 256; counter++) {
+      const x = crypto.createHash('sha256').update(Buffer.concat([tag, Buffer.from([counter])])).digest();
+      if (x.compare(FIELD_PRIME) >= 0) {
+        continue;
+      }
+      const compressed = Buffer.concat([Buffer.from([0x02]), x]);
+      if (ECCUtils.isValidPoint(compressed)) {
+        const point = secp256k1.curve.decodePoint(compressed);
+        choicePointCache = Buffer.from(point.encode('array', false));
+        return choicePointCache;
+      }
+    }
+    throw new Error('No choice point found');
+  }
+
   /**
    * validate if a buffer is a valid point on the curve
    */
@@ -23,6 +23,7 @@ export interface IBobMessages {
   otResponses: Uint8Array[];
   encryptedResult: Uint8Array;
   correlationCheck: number;
+  maskedShare: number;
 }
 
 export interface IMTAResult {
@@ -148,7 +149,8 @@ export class MTAProtobufHandler {
         success: object.success || false,
         otResponses: (object.ot_responses || []).map((resp: any) => new Uint8Array(resp)),
         encryptedResult: new Uint8Array(object.encrypted_result || []),
-        correlationCheck: object.correlation_check || 0
+        correlationCheck: object.correlation_check || 0,
+        maskedShare: object.masked_share || 0
       };
       
     } catch (error) {
@@ -255,7 +257,8 @@ export class BackwardCompatibilityAdapter {
       ...messages,
       ot_responses: messages.otResponses,
       encrypted_result: messages.encryptedResult,
-      correlation_check: messages.correlationCheck
+      correlation_check: messages.correlationCheck,
+      masked_share: messages.maskedShare
     };
   }
 }
@@ -278,4 +281,5 @@ export interface ProtoBobMessages {
   ot_responses: Uint8Array[];
   encrypted_result: Uint8Array;
   correlation_check: number;
+  masked_share: number;
 }
\ No newline at end of file
@@ -149,8 +149,8 @@ export class AliceCOTProtocol {
   }
 
   /**
-   * Calculate Alice's additive share of the multiplication result
-   * Alice's share U = Σ(2^i * Ui)
+   * Calculate Alice's pad sum U = Σ(2^i * Ui)
+   * Bob's decrypted values add up to V = U + x*y
    */
   calculateAdditiveShare(): number {
     let U = 0;
@@ -28,6 +28,10 @@ export interface MTAResult {
 /**
  * Alice's implementation of the MTA (Multiplication to Addition) Protocol
  * Compatible with Bob's C++ MTA implementation for secure multiplication
+ *
+ * Alice sends U + alpha, where U is her COT pad sum. Bob returns
+ * V - (U + alpha) + beta = x*y - alpha + beta and keeps -beta, so Alice's
+ * share is his masked share plus alpha.
  */
 export class AliceMTAProtocol {
   private cotProtocol: AliceCOTProtocol;
@@ -100,8 +104,6 @@ async prepareAliceMessages(xShare: number, bobSetup: BobSetup): Promise<AliceMes
   }
 
   this.alpha = this.generateRandomUint32();
-  
-  result.masked_share = (xShare * this.alpha) >>> 0;
 
   const cotSetup: COTSetup = {
     points_A: Buffer.alloc(0),
@@ -118,6 +120,7 @@ async prepareAliceMessages(xShare: number, bobSetup: BobSetup): Promise<AliceMes
       return result;
     }
 
+    result.masked_share = (cotResult.additive_share_U + this.alpha) >>> 0;
     result.points_A = cotResult.alice_messages.points_A;
     result.encrypted_m0_messages = cotResult.alice_messages.encrypted_m0_messages;
     result.encrypted_m1_messages = cotResult.alice_messages.encrypted_m1_messages;
@@ -148,9 +151,8 @@ async prepareAliceMessages(xShare: number, bobSetup: BobSetup): Promise<AliceMes
     console.log(`Executing Alice MTA with x_share: ${xShare}`);
 
     try {
-      const cotAdditiveShare = this.cotProtocol.calculateAdditiveShare();
-            
-      result.additive_share = cotAdditiveShare;
+      // Bob returned x*y - alpha + beta
+      result.additive_share = (bobMessages.masked_share + this.alpha) >>> 0;
       result.success = true;
 
       console.log(`Alice's final additive share: ${result.additive_share}`);
@@ -26,8 +26,8 @@ export class OTProtocol {
 
   /**
    * Alice receives point B from Bob and encrypts her two messages
-   * Bob sends B = bG (if c=0) or B = bG + A (if c=1)
-   * Alice encrypts m0 with key derived from a*B and m1 with key derived from a*(B-A)
+   * Bob sends B = bG (if c=0) or B = bG + T (if c=1), T = ECCUtils.choicePoint()
+   * Alice encrypts m0 with key derived from a*B and m1 with key derived from a*(B-T)
    */
   encryptMessages(
     pointB: Buffer,
@@ -42,7 +42,7 @@ export class OTProtocol {
       // Calculate aB (shared secret for message 0)
       const key0 = this.deriveKey0(pointB);
       
-      // Calculate a(B-A) (shared secret for message 1)
+      // Calculate a(B-T) (shared secret for message 1)
       const key1 = this.deriveKey1(pointB);
 
       // Encrypt both messages
@@ -72,21 +72,19 @@ export class OTProtocol {
   }
 
   /**
-   * Derive key for message 1: key1 = x-coordinate of (a * (B - A))
-   * When Bob chooses c=1, he sends B = bG + A
-   * So B - A = bG, and a*(B-A) = a*bG = (ab)G
-   * Bob calculates b*A = (ab)G, so keys match
+   * Derive key for message 1: key1 = x-coordinate of (a * (B - T))
+   * When Bob chooses c=1, he sends B = bG + T
+   * So B - T = bG, and a*(B-T) = a*bG = (ab)G
+   * Bob calculates b*A = (ab)G, so keys match. T has no known discrete
+   * log, so Bob cannot also know the key for the other message.
    */
   private deriveKey1(pointB: Buffer): Buffer {
     try {
-      // Get point A (Alice's public point)
-      const pointA = this.generatePointA();
+      // Calculate B - T
+      const pointB_minus_T = this.pointSubtract(pointB, ECCUtils.choicePoint());
       
-      // Calculate B - A
-      const pointB_minus_A = this.pointSubtract(pointB, pointA);
-      
-      // Calculate a * (B - A)
-      const sharedPoint = this.scalarMultiplyPoint(this.a_scalar, pointB_minus_A);
+      // Calculate a * (B - T)
+      const sharedPoint = this.scalarMultiplyPoint(this.a_scalar, pointB_minus_T);
       
       // Extract x-coordinate as key
       return EncryptionUtils.deriveKeyFromPoint(sharedPoint);
@@ -164,7 +164,7 @@ export class AliceMTAClient {
       return;
     }    
     const internalBobMessages: BobMessages = {
-      masked_share: bobMessages.masked_share,
+      masked_share: bobMessages.maskedShare,
       success: bobMessages.success
     };
     
@@ -0,0 +1,274 @@
+#include "alice_mta_protocol.h"
+#include "binary_codec.h"
+#include "logger.h"
+#include <cstring>
+
+extern "C" {
+    #include <trezor-crypto/memzero.h>
+}
+
+AliceMTAProtocol::AliceMTAProtocol()
+    : x_share(0),
+      initialized(false),
+      binary_codec(false),
+      offered_features(0),
+      accepted_features(0),
+      a_scalars(BIT_LENGTH * 32),
+      points_A(BIT_LENGTH * 65),
+      alpha(0) {
+    std::memset(random_U, 0, sizeof(random_U));
+}
+
+void AliceMTAProtocol::offerFeatures(uint32_t features) {
+    offered_features = features;
+}
+
+void AliceMTAProtocol::useBinaryCodec(bool enabled) {
+    binary_codec = enabled;
+}
+
+bool AliceMTAProtocol::initializeAsAlice(uint32_t x_share) {
+    this->x_share = x_share;
+    initialized = false;
+    
+    for (int i = 0; i < BIT_LENGTH; i++) {
+        crypto_ops.generateRandomScalar(&a_scalars[i * 32]);
+        random_U[i] = crypto_ops.generateRandomUint32();
+    }
+    alpha = crypto_ops.generateRandomUint32();
+    
+    if (!crypto_ops.generatePointsFromScalars(a_scalars.data(), BIT_LENGTH, points_A.data())) {
+        MTA_LOG_ERROR("Alice failed to generate points A");
+        return false;
+    }
+    
+    initialized = true;
+    return true;
+}
+
+MTAProtocol::AliceMessages AliceMTAProtocol::prepareAliceMessages(const MTAProtocol::BobSetup& bob_setup) {
+    MTAProtocol::AliceMessages messages;
+    messages.success = false;
+    
+    if (!initialized) {
+        MTA_LOG_ERROR("Alice not initialized: call initializeAsAlice first");
+        return messages;
+    }
+    if (!bob_setup.success || bob_setup.points_B.size() != BIT_LENGTH * 65) {
+        MTA_LOG_ERROR("Bob setup is invalid (%zu bytes of points B)", bob_setup.points_B.size());
+        return messages;
+    }
+    
+    messages.masked_share = maskedShare();
+    messages.success = encryptInstances(bob_setup.points_B.data(), 0, BIT_LENGTH, messages);
+    return messages;
+}
+
+MTAProtocol::AliceMessages AliceMTAProtocol::prepareAliceChunk(const MTAProtocol::BobSetup& chunk, uint32_t first) {
+    MTAProtocol::AliceMessages messages;
+    messages.success = false;
+    
+    size_t count = chunk.points_B.size() / 65;
+    if (!initialized) {
+        MTA_LOG_ERROR("Alice not initialized: call initializeAsAlice first");
+        return messages;
+    }
+    if (!chunk.success || count == 0 || chunk.points_B.size() != count * 65 || first + count > BIT_LENGTH) {
+        MTA_LOG_ERROR("Bob setup chunk at %u is invalid (%zu bytes of points B)", first, chunk.points_B.size());
+        return messages;
+    }
+    
+    // Every chunk carries it; Bob uses it once all are in
+    messages.masked_share = maskedShare();
+    messages.success = encryptInstances(chunk.points_B.data(), static_cast<int>(first), static_cast<int>(count),
+                                        messages);
+    return messages;
+}
+
+bool AliceMTAProtocol::encryptInstances(const uint8_t* points_B, int first, int count,
+                                        MTAProtocol::AliceMessages& messages) {
+    messages.points_A.assign(points_A.begin() + first * 65, points_A.begin() + (first + count) * 65);
+    messages.encrypted_m0_messages.resize(count * 32);
+    messages.encrypted_m1_messages.resize(count * 32);
+    
+    const uint8_t* choice_point = CryptoOperations::choicePoint();
+    for (int j = 0; j < count; j++) {
+        int i = first + j;
+        const uint8_t* a_scalar = &a_scalars[i * 32];
+        const uint8_t* point_B = &points_B[j * 65];
+        
+        uint8_t key0[32];
+        uint8_t key1[32];
+        uint8_t point_B_minus_T[65];
+        if (!crypto_ops.performECDH(a_scalar, point_B, key0) ||
+            !crypto_ops.subtractPoints(point_B, choice_point, point_B_minus_T) ||
+            !crypto_ops.performECDH(a_scalar, point_B_minus_T, key1)) {
+            MTA_LOG_ERROR("Invalid point B at index %d", i);
+            messages.encrypted_m0_messages.clear();
+            messages.encrypted_m1_messages.clear();
+            return false;
+        }
+        
+        // m0 = U_i, m1 = U_i + x, little-endian in a 32-byte block
+        uint8_t m0[32] = {};
+        uint8_t m1[32] = {};
+        crypto_ops.uint32ToBytes(random_U[i], m0);
+        crypto_ops.uint32ToBytes(random_U[i] + x_share, m1);
+        
+        crypto_ops.xorEncryptDecrypt(m0, key0, &messages.encrypted_m0_messages[j * 32], 32);
+        crypto_ops.xorEncryptDecrypt(m1, key1, &messages.encrypted_m1_messages[j * 32], 32);
+        
+        memzero(key0, sizeof(key0));
+        memzero(key1, sizeof(key1));
+    }
+    
+    return true;
+}
+
+uint32_t AliceMTAProtocol::maskedShare() const {
+    uint32_t accumulated_U = 0;
+    for (int i = 0; i < BIT_LENGTH; i++) {
+        accumulated_U += random_U[i] << i;
+    }
+    return accumulated_U + alpha;
+}
+
+MTAProtocol::MTAResult AliceMTAProtocol::executeAliceMTA(const MTAProtocol::BobMessages& bob_messages) {
+    MTAProtocol::MTAResult result;
+    result.success = false;
+    
+    if (!initialized) {
+        result.error_message = "Alice not initialized";
+        return result;
+    }
+    if (!bob_messages.success) {
+        result.error_message = "Bob messages indicate failure";
+        return result;
+    }
+    
+    // Bob returned x*y - alpha + beta
+    result.additive_share = bob_messages.masked_share + alpha;
+    result.success = true;
+    
+    memzero(a_scalars.data(), a_scalars.size());
+    memzero(random_U, sizeof(random_U));
+    memzero(&alpha, sizeof(alpha));
+    initialized = false;
+    return result;
+}
+
+std::vector<uint8_t> AliceMTAProtocol::serializeCorrelationDelta(uint32_t delta) {
+    if (binary_codec) {
+        std::vector<uint8_t> buffer;
+        BinaryCodec::encodeCorrelationDelta(delta, offered_features, buffer);
+        return buffer;
+    }
+    return protobuf_handler.serializeCorrelationDelta(delta, offered_features);
+}
+
+bool AliceMTAProtocol::deserializeBobSetup(const std::vector<uint8_t>& buffer, MTAProtocol::BobSetup& setup) {
+    if (BinaryCodec::isBinary(buffer)) {
+        if (!BinaryCodec::decodeBobSetup(buffer, setup)) {
+            return false;
+        }
+        if (setup.features & ~offered_features) {
+            MTA_LOG_ERROR("Bob accepted features that were not offered: %#x", setup.features);
+            return false;
+        }
+        accepted_features = setup.features;
+        return true;
+    }
+
+    mta_BobSetup proto_setup;
+    if (!protobuf_handler.deserializeBobSetup(buffer, proto_setup)) {
+        return false;
+    }
+    
+    if (proto_setup.features & ~offered_features) {
+        MTA_LOG_ERROR("Bob accepted features that were not offered: %#x", proto_setup.features);
+        return false;
+    }
+    setup.success = proto_setup.success;
+    setup.num_ot_instances = proto_setup.num_ot_instances;
+    setup.features = proto_setup.features;
+    accepted_features = proto_setup.features;
+    
+    setup.points_B.clear();
+    setup.points_B.reserve(BIT_LENGTH * 65);
+    if (accepted_features & MTAProtocol::FEATURE_COMPRESSED_POINTS) {
+        uint8_t compressed[BIT_LENGTH * 33];
+        size_t count = 0;
+        for (const auto& chunk : protobuf_handler.temp_bytes_arrays_) {
+            if (chunk.size() != 33 || count == BIT_LENGTH) {
+                return false;
+            }
+            std::memcpy(compressed + count * 33, chunk.data(), 33);
+            count++;
+        }
+        setup.points_B.resize(count * 65);
+        if (!CryptoOperations::decompressPoints(compressed, count, setup.points_B.data())) {
+            MTA_LOG_ERROR("Bob setup carries an invalid compressed point");
+            return false;
+        }
+    } else {
+        for (const auto& chunk : protobuf_handler.temp_bytes_arrays_) {
+            setup.points_B.insert(setup.points_B.end(), chunk.begin(), chunk.end());
+        }
+    }
+    
+    setup.public_key.assign(proto_setup.public_key.bytes,
+                            proto_setup.public_key.bytes + proto_setup.public_key.size);
+    return true;
+}
+
+std::vector<uint8_t> AliceMTAProtocol::serializeAliceMessages(const MTAProtocol::AliceMessages& messages) {
+    if (binary_codec) {
+        std::vector<uint8_t> buffer;
+        BinaryCodec::encodeAliceMessages(messages, accepted_features, buffer);
+        return buffer;
+    }
+
+    // success, masked_share (LE), points A, m0 blocks, m1 blocks
+    size_t point_count = messages.points_A.size() / 65;
+    std::vector<uint8_t> buffer;
+    buffer.reserve(5 + point_count * MTAProtocol::wirePointSize(accepted_features) +
+                   messages.encrypted_m0_messages.size() + messages.encrypted_m1_messages.size());
+    
+    buffer.push_back(messages.success ? 1 : 0);
+    uint8_t masked[4];
+    crypto_ops.uint32ToBytes(messages.masked_share, masked);
+    buffer.insert(buffer.end(), masked, masked + 4);
+    if (accepted_features & MTAProtocol::FEATURE_INTERLEAVED_MESSAGES) {
+        size_t offset = buffer.size();
+        buffer.resize(offset + point_count * MTAProtocol::interleavedRecordSize(accepted_features));
+        MTAProtocol::writeInterleavedRecords(messages, accepted_features, buffer.data() + offset);
+        return buffer;
+    }
+    if (accepted_features & MTAProtocol::FEATURE_COMPRESSED_POINTS) {
+        size_t offset = buffer.size();
+        buffer.resize(offset + point_count * 33);
+        CryptoOperations::compressPoints(messages.points_A.data(), point_count, buffer.data() + offset);
+    } else {
+        buffer.insert(buffer.end(), messages.points_A.begin(), messages.points_A.end());
+    }
+    buffer.insert(buffer.end(), messages.encrypted_m0_messages.begin(), messages.encrypted_m0_messages.end());
+    buffer.insert(buffer.end(), messages.encrypted_m1_messages.begin(), messages.encrypted_m1_messages.end());
+    return buffer;
+}
+
+bool AliceMTAProtocol::deserializeBobMessages(const std::vector<uint8_t>& buffer, MTAProtocol::BobMessages& messages) {
+    if (BinaryCodec::isBinary(buffer)) {
+        return BinaryCodec::decodeBobMessages(buffer, messages);
+    }
+
+    mta_BobMessages proto_messages;
+    if (!protobuf_handler.deserializeBobMessages(buffer, proto_messages)) {
+        return false;
+    }
+    
+    messages.success = proto_messages.success;
+    messages.masked_share = proto_messages.masked_share;
+    messages.encrypted_result.assign(proto_messages.encrypted_result.bytes,
+                                     proto_messages.encrypted_result.bytes + proto_messages.encrypted_result.size);
+    return true;
+}
@@ -0,0 +1,77 @@
+#ifndef ALICE_MTA_PROTOCOL_H
+#define ALICE_MTA_PROTOCOL_H
+
+#include "mta_protocol.h"
+#include "crypto_operations.h"
+#include "protobuf_handler.h"
+#include <vector>
+#include <cstdint>
+
+// Alice's (sender's) side of the MtA protocol, the counterpart of
+// MTAProtocol's Bob methods. Per session:
+//
+//   initializeAsAlice(x)        draws a_i, U_i, alpha and computes A_i = a_i*G
+//   prepareAliceMessages(setup) encrypts m0_i = U_i under a_i*B_i and
+//                               m1_i = U_i + x under a_i*(B_i - T), and
+//                               sends U + alpha, U = sum(2^i * U_i)
+//   executeAliceMTA(messages)   Alice's additive share, Bob's masked share
+//                               plus alpha
+//
+// When Bob accepts FEATURE_STREAMED_SETUP his setup arrives in chunks of
+// STREAM_CHUNK instances, and prepareAliceChunk answers each one as it
+// arrives instead of prepareAliceMessages.
+//
+// Bob decrypts m_{y_i} for every bit, so V = sum(2^i * (U_i + y_i*x)) =
+// U + x*y, and returns V - (U + alpha) + beta while keeping -beta; the two
+// shares add up to x*y mod 2^32 (see MTAProtocol::prepareBobMessages). One
+// instance per session at a time; not thread-safe.
+class AliceMTAProtocol {
+public:
+    static const int BIT_LENGTH = 32;
+    
+    AliceMTAProtocol();
+    
+    // MTAProtocol::FEATURE_* bits to offer in CorrelationDelta. The wire
+    // format then follows what Bob accepts in BobSetup.
+    void offerFeatures(uint32_t features);
+    // Speak BinaryCodec instead of protobuf. The server's busy frame is
+    // protobuf either way.
+    void useBinaryCodec(bool enabled);
+    
+    bool initializeAsAlice(uint32_t x_share);
+    MTAProtocol::AliceMessages prepareAliceMessages(const MTAProtocol::BobSetup& bob_setup);
+    // The messages for the instances of `chunk`, which start at `first`
+    MTAProtocol::AliceMessages prepareAliceChunk(const MTAProtocol::BobSetup& chunk, uint32_t first);
+    MTAProtocol::MTAResult executeAliceMTA(const MTAProtocol::BobMessages& bob_messages);
+    
+    // Wire format, as the server reads and writes it
+    std::vector<uint8_t> serializeCorrelationDelta(uint32_t delta);
+    bool deserializeBobSetup(const std::vector<uint8_t>& buffer, MTAProtocol::BobSetup& setup);
+    std::vector<uint8_t> serializeAliceMessages(const MTAProtocol::AliceMessages& messages);
+    bool deserializeBobMessages(const std::vector<uint8_t>& buffer, MTAProtocol::BobMessages& messages);
+    
+    // Features Bob accepted in the last BobSetup
+    uint32_t acceptedFeatures() const { return accepted_features; }
+    
+private:
+    // Encrypts m0/m1 for instances [first, first + count) against their
+    // points B, into messages (which then holds just those instances)
+    bool encryptInstances(const uint8_t* points_B, int first, int count, MTAProtocol::AliceMessages& messages);
+    // U + alpha, Alice's masked share
+    uint32_t maskedShare() const;
+    
+    CryptoOperations crypto_ops;
+    MTAProtobufHandler protobuf_handler;
+    
+    uint32_t x_share;
+    bool initialized;
+    bool binary_codec;
+    uint32_t offered_features;
+    uint32_t accepted_features;         // from the last BobSetup
+    std::vector<uint8_t> a_scalars;     // BIT_LENGTH * 32
+    std::vector<uint8_t> points_A;      // BIT_LENGTH * 65
+    uint32_t random_U[BIT_LENGTH];
+    uint32_t alpha;
+};
+
+#endif
@@ -1,11 +1,148 @@
 #include <crypto_operations.h>
+#include <array>
 #include <cstring>
 #include <iostream>
+#include <vector>
 
 extern "C" {
     #include <trezor-crypto/rand.h>
+    #include <trezor-crypto/memzero.h>
+    #include <trezor-crypto/sha2.h>
 }
 
+#if USE_PRECOMPUTED_CP
+// Jacobian coordinates (X / Z^2, Y / Z^3) used by the batched fixed-base path
+struct JacobianPoint {
+    bignum256 x, y, z;
+};
+
+// x = a * x, fully reduced
+static void fieldMultiply(const bignum256* a, bignum256* x, const bignum256* prime) {
+    bn_multiply(a, x, prime);
+    bn_mod(x, prime);
+}
+
+// res = a - b, fully reduced
+static void fieldSubtract(const bignum256* a, const bignum256* b, bignum256* res, const bignum256* prime) {
+    bn_subtractmod(a, b, res, prime);
+    bn_fast_mod(res, prime);
+    bn_mod(res, prime);
+}
+
+// p += q for jacobian p and affine q. The signed-digit recoding below never
+// produces p == +-q, so the doubling and infinity cases are not handled.
+static void jacobianAddAffine(const curve_point* q, JacobianPoint* p, const bignum256* prime) {
+    bignum256 zz, u2, s2, h, r, hh, hhh, v, r2, t, x3, y3;
+
+    bn_copy(&p->z, &zz);
+    fieldMultiply(&p->z, &zz, prime);          // zz = Z1^2
+    bn_copy(&q->x, &u2);
+    fieldMultiply(&zz, &u2, prime);            // u2 = x2 * Z1^2
+    bn_copy(&q->y, &s2);
+    fieldMultiply(&zz, &s2, prime);
+    fieldMultiply(&p->z, &s2, prime);          // s2 = y2 * Z1^3
+
+    fieldSubtract(&u2, &p->x, &h, prime);      // h = u2 - X1
+    fieldSubtract(&s2, &p->y, &r, prime);      // r = s2 - Y1
+
+    bn_copy(&h, &hh);
+    fieldMultiply(&h, &hh, prime);             // hh = h^2
+    bn_copy(&hh, &hhh);
+    fieldMultiply(&h, &hhh, prime);            // hhh = h^3
+    bn_copy(&p->x, &v);
+    fieldMultiply(&hh, &v, prime);             // v = X1 * h^2
+
+    // X3 = r^2 - h^3 - 2v
+    bn_copy(&r, &r2);
+    fieldMultiply(&r, &r2, prime);
+    fieldSubtract(&r2, &hhh, &t, prime);
+    fieldSubtract(&t, &v, &x3, prime);
+    fieldSubtract(&x3, &v, &t, prime);
+    bn_copy(&t, &x3);
+
+    // Y3 = r * (v - X3) - Y1 * h^3
+    fieldSubtract(&v, &x3, &t, prime);
+    fieldMultiply(&r, &t, prime);
+    bn_copy(&p->y, &y3);
+    fieldMultiply(&hhh, &y3, prime);
+    fieldSubtract(&t, &y3, &p->y, prime);
+
+    // Z3 = Z1 * h
+    fieldMultiply(&h, &p->z, prime);
+    bn_copy(&x3, &p->x);
+
+    memzero(&r, sizeof(r));
+    memzero(&h, sizeof(h));
+}
+
+// Loads +-|digit| * 16^position * G from the curve's precomputed table
+static void loadTablePoint(int position, int digit, curve_point* out, const bignum256* prime) {
+    int magnitude = digit < 0 ? -digit : digit;
+    const curve_point* entry = &secp256k1.cp[position][(magnitude - 1) >> 1];
+
+    bignum256 zero, negated_y;
+    bn_zero(&zero);
+    fieldSubtract(&zero, &entry->y, &negated_y, prime);
+
+    bn_copy(&entry->x, &out->x);
+    bn_cmov(&out->y, digit < 0, &negated_y, &entry->y);
+}
+
+// Computes k * G in jacobian form without the final inversion. Returns false
+// when k is not a valid nonzero scalar. `negate` is set when the caller must
+// flip the sign of y after converting to affine.
+static bool scalarMultiplyJacobian(const uint8_t* scalar, JacobianPoint* out, bool* negate) {
+    const bignum256* prime = &secp256k1.prime;
+    bignum256 k;
+    bn_read_be(scalar, &k);
+    if (bn_is_zero(&k) || !bn_is_less(&k, &secp256k1.order)) {
+        return false;
+    }
+
+    // Work with an odd multiplier: k * G = -((n - k) * G) when k is even
+    *negate = (scalar[31] & 1) == 0;
+    bignum256 m;
+    if (*negate) {
+        fieldSubtract(&secp256k1.order, &k, &m, &secp256k1.order);
+    } else {
+        bn_copy(&k, &m);
+    }
+
+    uint8_t m_bytes[32];
+    bn_write_be(&m, m_bytes);
+
+    // Signed odd base-16 digits: whenever a nibble is even, borrow 16 from the
+    // digit below it. m is odd, so every digit ends up odd and in [-15, 15].
+    int digits[64];
+    for (int i = 0; i < 64; i++) {
+        digits[i] = (m_bytes[31 - i / 2] >> (4 * (i & 1))) & 0x0F;
+    }
+    for (int i = 1; i < 64; i++) {
+        if ((digits[i] & 1) == 0) {
+            digits[i] += 1;
+            digits[i - 1] -= 16;
+        }
+    }
+
+    curve_point term;
+    loadTablePoint(0, digits[0], &term, prime);
+    bn_copy(&term.x, &out->x);
+    bn_copy(&term.y, &out->y);
+    bn_one(&out->z);
+
+    for (int i = 1; i < 64; i++) {
+        loadTablePoint(i, digits[i], &term, prime);
+        jacobianAddAffine(&term, out, prime);
+    }
+
+    memzero(digits, sizeof(digits));
+    memzero(m_bytes, sizeof(m_bytes));
+    memzero(&m, sizeof(m));
+    memzero(&k, sizeof(k));
+    return true;
+}
+#endif
+
 CryptoOperations::CryptoOperations() {}
 
 bool CryptoOperations::generateECDHKeyPair(uint8_t* private_key, uint8_t* public_point) {
@@ -28,6 +165,81 @@ bool CryptoOperations::generatePointFromScalar(const uint8_t* scalar, uint8_t* p
     return true;
 }
 
+bool CryptoOperations::generatePointsFromScalars(const uint8_t* scalars, size_t count, uint8_t* points_out) {
+#if USE_PRECOMPUTED_CP
+    if (count == 0) {
+        return true;
+    }
+
+    const bignum256* prime = &secp256k1.prime;
+    std::vector<JacobianPoint> points(count);
+    std::vector<uint8_t> negate(count);
+    std::vector<bignum256> prefix(count);
+
+    for (size_t i = 0; i < count; i++) {
+        bool flip = false;
+        if (!scalarMultiplyJacobian(scalars + i * 32, &points[i], &flip)) {
+            return false;
+        }
+        negate[i] = flip;
+
+        // prefix[i] = z_0 * ... * z_i
+        bn_copy(&points[i].z, &prefix[i]);
+        if (i > 0) {
+            fieldMultiply(&prefix[i - 1], &prefix[i], prime);
+        }
+    }
+
+    // Montgomery's trick: one inversion for the whole batch
+    bignum256 inverse;
+    bn_copy(&prefix[count - 1], &inverse);
+    bn_inverse(&inverse, prime);
+    bn_mod(&inverse, prime);
+
+    for (size_t i = count; i-- > 0;) {
+        bignum256 z_inv;
+        if (i > 0) {
+            bn_copy(&prefix[i - 1], &z_inv);
+            fieldMultiply(&inverse, &z_inv, prime);
+            fieldMultiply(&points[i].z, &inverse, prime);
+        } else {
+            bn_copy(&inverse, &z_inv);
+        }
+
+        bignum256 z_inv2, z_inv3, x, y;
+        bn_copy(&z_inv, &z_inv2);
+        fieldMultiply(&z_inv, &z_inv2, prime);
+        bn_copy(&z_inv2, &z_inv3);
+        fieldMultiply(&z_inv, &z_inv3, prime);
+
+        bn_copy(&points[i].x, &x);
+        fieldMultiply(&z_inv2, &x, prime);
+        bn_copy(&points[i].y, &y);
+        fieldMultiply(&z_inv3, &y, prime);
+
+        bignum256 zero, negated_y;
+        bn_zero(&zero);
+        fieldSubtract(&zero, &y, &negated_y, prime);
+        bn_cmov(&y, negate[i], &negated_y, &y);
+
+        uint8_t* point_out = points_out + i * 65;
+        point_out[0] = 0x04;
+        bn_write_be(&x, point_out + 1);
+        bn_write_be(&y, point_out + 33);
+    }
+
+    memzero(points.data(), points.size() * sizeof(JacobianPoint));
+    return true;
+#else
+    for (size_t i = 0; i < count; i++) {
+        if (!generatePointFromScalar(scalars + i * 32, points_out + i * 65)) {
+            return false;
+        }
+    }
+    return true;
+#endif
+}
+
 bool CryptoOperations::performECDH(const uint8_t* private_scalar, const uint8_t* public_point, uint8_t* shared_secret) {
     curve_point point;
     if (!ecdsa_read_pubkey(&secp256k1, public_point, &point)) {
@@ -45,6 +257,120 @@ bool CryptoOperations::performECDH(const uint8_t* private_scalar, const uint8_t*
     return true;
 }
 
+static void writePoint(const curve_point* point, uint8_t* out) {
+    out[0] = 0x04;
+    bn_write_be(&point->x, out + 1);
+    bn_write_be(&point->y, out + 33);
+}
+
+void CryptoOperations::compressPoints(const uint8_t* points, size_t count, uint8_t* compressed_out) {
+    for (size_t i = 0; i < count; i++) {
+        const uint8_t* point = points + i * 65;
+        uint8_t* compressed = compressed_out + i * 33;
+        compressed[0] = 0x02 | (point[64] & 1);
+        std::memcpy(compressed + 1, point + 1, 32);
+    }
+}
+
+bool CryptoOperations::decompressPoints(const uint8_t* compressed, size_t count, uint8_t* points_out) {
+    const bignum256* prime = &secp256k1.prime;
+    std::vector<bignum256> x(count);
+    std::vector<bignum256> y(count);
+
+    // y^2 = x^3 + 7 for every point before any square root
+    for (size_t i = 0; i < count; i++) {
+        const uint8_t* point = compressed + i * 33;
+        if (point[0] != 0x02 && point[0] != 0x03) {
+            return false;
+        }
+        bn_read_be(point + 1, &x[i]);
+        if (!bn_is_less(&x[i], prime)) {
+            return false;
+        }
+        bn_copy(&x[i], &y[i]);
+        bn_multiply(&x[i], &y[i], prime);
+        bn_multiply(&x[i], &y[i], prime);
+        bn_add(&y[i], &secp256k1.b);
+        bn_fast_mod(&y[i], prime);
+        bn_mod(&y[i], prime);
+    }
+
+    // p = 3 mod 4, so each root is one exponentiation. Squaring it back is
+    // the curve check: for a non-residue it gives -(x^3 + 7).
+    for (size_t i = 0; i < count; i++) {
+        bignum256 root, check;
+        bn_copy(&y[i], &root);
+        bn_sqrt(&root, prime);
+        bn_mod(&root, prime);
+        bn_copy(&root, &check);
+        bn_multiply(&root, &check, prime);
+        bn_mod(&check, prime);
+        if (!bn_is_equal(&check, &y[i])) {
+            return false;
+        }
+
+        const uint8_t* point = compressed + i * 33;
+        if ((root.val[0] & 1) != (point[0] & 1)) {
+            bn_subtract(prime, &root, &root);
+        }
+
+        uint8_t* point_out = points_out + i * 65;
+        point_out[0] = 0x04;
+        bn_write_be(&x[i], point_out + 1);
+        bn_write_be(&root, point_out + 33);
+    }
+    return true;
+}
+
+bool CryptoOperations::addPoints(const uint8_t* p, const uint8_t* q, uint8_t* out) {
+    curve_point lhs, rhs;
+    if (!ecdsa_read_pubkey(&secp256k1, p, &lhs) || !ecdsa_read_pubkey(&secp256k1, q, &rhs)) {
+        return false;
+    }
+    
+    point_add(&secp256k1, &lhs, &rhs);
+    writePoint(&rhs, out);
+    return true;
+}
+
+bool CryptoOperations::subtractPoints(const uint8_t* p, const uint8_t* q, uint8_t* out) {
+    curve_point lhs, rhs;
+    if (!ecdsa_read_pubkey(&secp256k1, p, &lhs) || !ecdsa_read_pubkey(&secp256k1, q, &rhs)) {
+        return false;
+    }
+    
+    // -(x, y) = (x, prime - y)
+    bn_subtract(&secp256k1.prime, &rhs.y, &rhs.y);
+    point_add(&secp256k1, &lhs, &rhs);
+    writePoint(&rhs, out);
+    return true;
+}
+
+const uint8_t* CryptoOperations::choicePoint() {
+    // Try-and-increment: the first x = SHA-256(tag || counter) on the curve,
+    // with even y
+    static const std::array<uint8_t, 65> point = []() {
+        static const char tag[] = "mta-cot choice point";
+        uint8_t input[sizeof(tag)];
+        std::memcpy(input, tag, sizeof(tag) - 1);
+        
+        std::array<uint8_t, 65> uncompressed = {};
+        for (uint8_t counter = 0;; counter++) {
+            input[sizeof(tag) - 1] = counter;
+            uint8_t compressed[33];
+            compressed[0] = 0x02;
+            sha256_Raw(input, sizeof(input), compressed + 1);
+            
+            curve_point candidate;
+            if (ecdsa_read_pubkey(&secp256k1, compressed, &candidate)) {
+                writePoint(&candidate, uncompressed.data());
+                return uncompressed;
+            }
+        }
+    }();
+    return point.data();
+}
+
 void CryptoOperations::xorEncryptDecrypt(const uint8_t* data, const uint8_t* key, uint8_t* output, size_t length) {
     for (size_t i = 0; i < length; i++) {
         output[i] = data[i] ^ key[i % 32];
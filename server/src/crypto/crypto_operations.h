@@ -20,9 +20,26 @@ public:
     
     bool generateECDHKeyPair(uint8_t* private_key, uint8_t* public_point);
     bool generatePointFromScalar(const uint8_t* scalar, uint8_t* point_out);
+    // Same as generatePointFromScalar for `count` consecutive 32-byte scalars,
+    // sharing a single field inversion across the whole batch
+    bool generatePointsFromScalars(const uint8_t* scalars, size_t count, uint8_t* points_out);
     
     bool performECDH(const uint8_t* private_scalar, const uint8_t* public_point, uint8_t* shared_secret);
     
+    // SEC1 compression of `count` consecutive 65-byte points into 33 bytes
+    // each, and back. decompressPoints lifts every x first and then takes
+    // the square roots back to back; it fails if any x is not on the curve.
+    static void compressPoints(const uint8_t* points, size_t count, uint8_t* compressed_out);
+    static bool decompressPoints(const uint8_t* compressed, size_t count, uint8_t* points_out);
+    
+    // out = p + q and out = p - q on 65-byte uncompressed points
+    bool addPoints(const uint8_t* p, const uint8_t* q, uint8_t* out);
+    bool subtractPoints(const uint8_t* p, const uint8_t* q, uint8_t* out);
+    
+    // Fixed point T with unknown discrete log (hashed to the curve). The COT
+    // receiver publishes B = b*G + c*T for its choice bit c.
+    static const uint8_t* choicePoint();
+    
     void xorEncryptDecrypt(const uint8_t* data, const uint8_t* key, uint8_t* output, size_t length);
     
     bool validatePublicPoint(const uint8_t* point);
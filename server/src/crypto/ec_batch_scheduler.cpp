@@ -0,0 +1,146 @@
+#include "ec_batch_scheduler.h"
+#include <algorithm>
+#include <cstring>
+#include "logger.h"
+#include "metrics.h"
+#include "span_trace.h"
+
+extern "C" {
+    #include <trezor-crypto/memzero.h>
+}
+
+static const uint64_t REPORT_EVERY_BATCHES = 1024;
+
+ECBatchScheduler::ECBatchScheduler(boost::asio::io_context& io_context,
+                                   std::chrono::microseconds window,
+                                   size_t max_jobs)
+    : io_context_(io_context),
+      timer_(io_context),
+      window_(window),
+      max_jobs_(std::max<size_t>(max_jobs, 1)),
+      flush_pending_(false),
+      flush_generation_(0),
+      scalar_batch_(max_jobs_ * 32 * 32) {
+    pending_.reserve(max_jobs_);
+}
+
+void ECBatchScheduler::submit(const uint8_t* scalars, size_t count, uint8_t* points_out, Callback on_complete) {
+    pending_.push_back({scalars, count, points_out, std::move(on_complete),
+                        std::chrono::steady_clock::now()});
+
+    if (pending_.size() >= max_jobs_) {
+        timer_.cancel();
+        flush_pending_ = false;
+        flush_generation_++;
+        flush();
+        return;
+    }
+
+    schedule_flush();
+}
+
+const ECBatchScheduler::Stats& ECBatchScheduler::stats() const {
+    return stats_;
+}
+
+void ECBatchScheduler::schedule_flush() {
+    if (flush_pending_) {
+        return;
+    }
+    flush_pending_ = true;
+    uint64_t generation = ++flush_generation_;
+
+    if (window_.count() == 0) {
+        boost::asio::post(io_context_, [this, generation]() {
+            if (flush_pending_ && generation == flush_generation_) {
+                flush_pending_ = false;
+                flush();
+            }
+        });
+        return;
+    }
+
+    timer_.expires_after(window_);
+    timer_.async_wait([this, generation](boost::system::error_code ec) {
+        if (ec == boost::asio::error::operation_aborted || !flush_pending_ || generation != flush_generation_) {
+            return;
+        }
+        flush_pending_ = false;
+        flush();
+    });
+}
+
+void ECBatchScheduler::flush() {
+    if (pending_.empty()) {
+        return;
+    }
+
+    // Completions may submit follow-up work, so detach the batch first
+    std::vector<Job> batch;
+    batch.swap(pending_);
+    pending_.reserve(max_jobs_);
+
+    auto started_at = std::chrono::steady_clock::now();
+    size_t total_points = 0;
+    uint64_t batch_delay_us = 0;
+    for (const auto& job : batch) {
+        total_points += job.count;
+        uint64_t delay_us = std::chrono::duration_cast<std::chrono::microseconds>(
+            started_at - job.enqueued_at).count();
+        batch_delay_us += delay_us;
+        stats_.max_queue_delay_us = std::max(stats_.max_queue_delay_us, delay_us);
+    }
+    stats_.total_queue_delay_us += batch_delay_us;
+
+    if (scalar_batch_.size() < total_points * 32) {
+        scalar_batch_ = SecureBuffer(total_points * 32);
+    }
+    point_batch_.resize(total_points * 65);
+
+    size_t offset = 0;
+    for (const auto& job : batch) {
+        std::memcpy(scalar_batch_.data() + offset * 32, job.scalars, job.count * 32);
+        offset += job.count;
+    }
+
+    bool success = crypto_ops_.generatePointsFromScalars(scalar_batch_.data(), total_points, point_batch_.data());
+    memzero(scalar_batch_.data(), total_points * 32);
+    // Not sampled: one span per batch is small next to the batch itself,
+    // and a traced session's batch must not be missing from its timeline
+    if (SpanTrace::enabled()) {
+        SpanTrace::record("ec_batch", "crypto", started_at, std::chrono::steady_clock::now(), "points", total_points);
+    }
+
+    stats_.batches++;
+    stats_.jobs += batch.size();
+    stats_.points += total_points;
+    stats_.max_batch_jobs = std::max<uint64_t>(stats_.max_batch_jobs, batch.size());
+    Metrics::increment(MetricCounter::EC_BATCHES);
+    Metrics::increment(MetricCounter::EC_BATCH_JOBS, batch.size());
+    Metrics::increment(MetricCounter::EC_BATCH_POINTS, total_points);
+    Metrics::increment(MetricCounter::EC_QUEUE_DELAY_US, batch_delay_us);
+    if (stats_.batches % REPORT_EVERY_BATCHES == 0) {
+        report();
+    }
+
+    offset = 0;
+    for (auto& job : batch) {
+        if (success) {
+            std::memcpy(job.points_out, &point_batch_[offset * 65], job.count * 65);
+        }
+        offset += job.count;
+        boost::asio::post(io_context_,
+            [handler = std::move(job.on_complete), success]() mutable {
+                std::move(handler)(success);
+            });
+    }
+}
+
+void ECBatchScheduler::report() const {
+    double avg_jobs = static_cast<double>(stats_.jobs) / stats_.batches;
+    double avg_delay_us = static_cast<double>(stats_.total_queue_delay_us) / stats_.jobs;
+    MTA_LOG_INFO("[BATCH] %llu batches, avg %.2f jobs/batch (max %llu), avg queue delay %.1f us (max %llu us)",
+                 static_cast<unsigned long long>(stats_.batches), avg_jobs,
+                 static_cast<unsigned long long>(stats_.max_batch_jobs), avg_delay_us,
+                 static_cast<unsigned long long>(stats_.max_queue_delay_us));
+}
@@ -0,0 +1,82 @@
+#ifndef EC_BATCH_SCHEDULER_H
+#define EC_BATCH_SCHEDULER_H
+
+#include <boost/asio.hpp>
+#include <boost/asio/any_completion_handler.hpp>
+#include <chrono>
+#include <cstdint>
+#include <vector>
+#include "crypto_operations.h"
+#include "secure_arena.h"
+
+// Collects fixed-base point generation jobs from the sessions of one
+// io_context and runs them together, so a single field inversion is shared
+// by every point in the batch. A batch is flushed when `max_jobs` are queued
+// or when the oldest job has waited `window`; a zero window flushes on the
+// next turn of the reactor, batching only what arrived together. Batch
+// sizes and queueing delays are exported through Metrics.
+class ECBatchScheduler {
+public:
+    using Callback = boost::asio::any_completion_handler<void(bool success)>;
+
+    struct Stats {
+        uint64_t batches = 0;
+        uint64_t jobs = 0;
+        uint64_t points = 0;
+        uint64_t max_batch_jobs = 0;
+        uint64_t total_queue_delay_us = 0;
+        uint64_t max_queue_delay_us = 0;
+    };
+
+    ECBatchScheduler(boost::asio::io_context& io_context,
+                     std::chrono::microseconds window,
+                     size_t max_jobs);
+
+    // `scalars` (count * 32 bytes) and `points_out` (count * 65 bytes) must
+    // stay valid until `on_complete` runs; completions are posted to the
+    // io_context, never invoked from inside submit().
+    void submit(const uint8_t* scalars, size_t count, uint8_t* points_out, Callback on_complete);
+
+    // Asio-style wrapper, e.g. `co_await async_submit(..., use_awaitable)`
+    template <typename CompletionToken>
+    auto async_submit(const uint8_t* scalars, size_t count, uint8_t* points_out, CompletionToken&& token) {
+        return boost::asio::async_initiate<CompletionToken, void(bool)>(
+            [this, scalars, count, points_out](auto handler) {
+                submit(scalars, count, points_out, std::move(handler));
+            },
+            token);
+    }
+
+    const Stats& stats() const;
+
+private:
+    struct Job {
+        const uint8_t* scalars;
+        size_t count;
+        uint8_t* points_out;
+        Callback on_complete;
+        std::chrono::steady_clock::time_point enqueued_at;
+    };
+
+    void schedule_flush();
+    void flush();
+    void report() const;
+
+    boost::asio::io_context& io_context_;
+    boost::asio::steady_timer timer_;
+    std::chrono::microseconds window_;
+    size_t max_jobs_;
+    bool flush_pending_;
+    // Bumped whenever an armed flush is superseded; a timer or post handler
+    // only flushes if it still carries the current generation, since a
+    // handler that had already expired when cancel() ran is not aborted
+    uint64_t flush_generation_;
+
+    CryptoOperations crypto_ops_;
+    std::vector<Job> pending_;
+    SecureBuffer scalar_batch_;     // sessions' scalars, grown as batches need
+    std::vector<uint8_t> point_batch_;
+    Stats stats_;
+};
+
+#endif
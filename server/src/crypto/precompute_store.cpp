@@ -0,0 +1,271 @@
+#include "precompute_store.h"
+#include "logger.h"
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+extern "C" {
+    #include <trezor-crypto/hmac.h>
+    #include <trezor-crypto/memzero.h>
+    #include <trezor-crypto/rand.h>
+}
+
+static const char STORE_MAGIC[8] = {'M', 'T', 'A', 'P', 'R', 'E', '0', '1'};
+static const size_t HEADER_SIZE = 4096;
+static const size_t SLOT_SIZE = PrecomputeStore::ENTRY_SIZE + 32;
+static const size_t GROW_ENTRIES = 1024;
+
+// Header fields
+static const size_t ENTRY_SIZE_OFFSET = 8;
+static const size_t FILE_ID_OFFSET = 16;
+static const size_t COUNT_OFFSET = 32;
+static const size_t CURSOR_OFFSET = 40;
+
+static void store64(uint8_t* out, uint64_t value) {
+    for (size_t i = 0; i < 8; i++) {
+        out[i] = static_cast<uint8_t>(value >> (8 * i));
+    }
+}
+
+static uint64_t load64(const uint8_t* in) {
+    uint64_t value = 0;
+    for (size_t i = 0; i < 8; i++) {
+        value |= static_cast<uint64_t>(in[i]) << (8 * i);
+    }
+    return value;
+}
+
+static int hexDigit(char c) {
+    if (c >= '0' && c <= '9') return c - '0';
+    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+    if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+    return -1;
+}
+
+bool PrecomputeStore::parseKey(const std::string& hex, uint8_t key[KEY_SIZE]) {
+    if (hex.size() != 2 * KEY_SIZE) {
+        return false;
+    }
+    for (size_t i = 0; i < KEY_SIZE; i++) {
+        int high = hexDigit(hex[2 * i]);
+        int low = hexDigit(hex[2 * i + 1]);
+        if (high < 0 || low < 0) {
+            return false;
+        }
+        key[i] = static_cast<uint8_t>(high << 4 | low);
+    }
+    return true;
+}
+
+std::unique_ptr<PrecomputeStore> PrecomputeStore::open(const std::string& path, const uint8_t key[KEY_SIZE],
+                                                       bool create) {
+    int fd = ::open(path.c_str(), O_RDWR | O_CLOEXEC | (create ? O_CREAT : 0), 0600);
+    if (fd < 0) {
+        MTA_LOG_ERROR("Cannot open precompute store %s: %s", path.c_str(), std::strerror(errno));
+        return nullptr;
+    }
+    // One process at a time: the cursor is only advanced through this mapping
+    if (::flock(fd, LOCK_EX | LOCK_NB) != 0) {
+        MTA_LOG_ERROR("Precompute store %s is in use by another process", path.c_str());
+        ::close(fd);
+        return nullptr;
+    }
+
+    struct stat st;
+    if (::fstat(fd, &st) != 0) {
+        ::close(fd);
+        return nullptr;
+    }
+    size_t size = static_cast<size_t>(st.st_size);
+    bool fresh = size == 0;
+    if (fresh) {
+        if (!create || ::ftruncate(fd, HEADER_SIZE) != 0) {
+            MTA_LOG_ERROR("Precompute store %s is empty", path.c_str());
+            ::close(fd);
+            return nullptr;
+        }
+        size = HEADER_SIZE;
+    }
+    if (size < HEADER_SIZE) {
+        MTA_LOG_ERROR("%s is not a precompute store", path.c_str());
+        ::close(fd);
+        return nullptr;
+    }
+
+    void* map = ::mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (map == MAP_FAILED) {
+        MTA_LOG_ERROR("Cannot map precompute store %s: %s", path.c_str(), std::strerror(errno));
+        ::close(fd);
+        return nullptr;
+    }
+    uint8_t* header = static_cast<uint8_t*>(map);
+    if (fresh) {
+        std::memcpy(header, STORE_MAGIC, sizeof(STORE_MAGIC));
+        uint32_t entry_size = ENTRY_SIZE;
+        std::memcpy(header + ENTRY_SIZE_OFFSET, &entry_size, sizeof(entry_size));
+        random_buffer(header + FILE_ID_OFFSET, 16);
+        ::msync(header, HEADER_SIZE, MS_SYNC);
+    }
+
+    uint32_t entry_size;
+    std::memcpy(&entry_size, header + ENTRY_SIZE_OFFSET, sizeof(entry_size));
+    uint64_t count = load64(header + COUNT_OFFSET);
+    if (std::memcmp(header, STORE_MAGIC, sizeof(STORE_MAGIC)) != 0 || entry_size != ENTRY_SIZE ||
+        HEADER_SIZE + count * SLOT_SIZE > size || load64(header + CURSOR_OFFSET) > count) {
+        MTA_LOG_ERROR("%s is not a precompute store of this version", path.c_str());
+        ::munmap(map, size);
+        ::close(fd);
+        return nullptr;
+    }
+    return std::unique_ptr<PrecomputeStore>(new PrecomputeStore(fd, header, size, key));
+}
+
+PrecomputeStore::PrecomputeStore(int fd, uint8_t* map, size_t map_size, const uint8_t key[KEY_SIZE])
+    : fd_(fd),
+      map_(map),
+      map_size_(map_size),
+      appended_(load64(map + COUNT_OFFSET)) {
+    // Separate keys for the keystream and the tag
+    static const char ENCRYPTION_LABEL[] = "MTAPRE01 encryption";
+    static const char MAC_LABEL[] = "MTAPRE01 mac";
+    hmac_sha256(key, KEY_SIZE, reinterpret_cast<const uint8_t*>(ENCRYPTION_LABEL), sizeof(ENCRYPTION_LABEL) - 1,
+                encryption_key_);
+    hmac_sha256(key, KEY_SIZE, reinterpret_cast<const uint8_t*>(MAC_LABEL), sizeof(MAC_LABEL) - 1, mac_key_);
+}
+
+PrecomputeStore::~PrecomputeStore() {
+    memzero(encryption_key_, sizeof(encryption_key_));
+    memzero(mac_key_, sizeof(mac_key_));
+    ::munmap(map_, map_size_);
+    ::close(fd_);
+}
+
+uint64_t PrecomputeStore::remaining() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return load64(map_ + COUNT_OFFSET) - load64(map_ + CURSOR_OFFSET);
+}
+
+size_t PrecomputeStore::claim(size_t count, uint64_t& first) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    uint64_t cursor = load64(map_ + CURSOR_OFFSET);
+    uint64_t available = load64(map_ + COUNT_OFFSET) - cursor;
+    size_t claimed = static_cast<size_t>(std::min<uint64_t>(count, available));
+    if (claimed == 0) {
+        return 0;
+    }
+    store64(map_ + CURSOR_OFFSET, cursor + claimed);
+    if (::msync(map_, HEADER_SIZE, MS_SYNC) != 0) {
+        // The cursor may not be on disk: the entries could be handed out
+        // again after a crash, so do not use them
+        MTA_LOG_ERROR("Cannot sync precompute store cursor: %s", std::strerror(errno));
+        return 0;
+    }
+    first = cursor;
+    return claimed;
+}
+
+uint8_t* PrecomputeStore::slot(uint64_t index) const {
+    return map_ + HEADER_SIZE + index * SLOT_SIZE;
+}
+
+// Block j of entry `index` is HMAC(encryption key, file id || index || j)
+void PrecomputeStore::keystream(uint64_t index, uint8_t* data) const {
+    uint8_t input[16 + 8 + 4];
+    std::memcpy(input, map_ + FILE_ID_OFFSET, 16);
+    store64(input + 16, index);
+    uint8_t block[32];
+    for (size_t offset = 0, j = 0; offset < ENTRY_SIZE; offset += sizeof(block), j++) {
+        uint32_t counter = static_cast<uint32_t>(j);
+        std::memcpy(input + 24, &counter, sizeof(counter));
+        hmac_sha256(encryption_key_, sizeof(encryption_key_), input, sizeof(input), block);
+        size_t length = std::min(sizeof(block), ENTRY_SIZE - offset);
+        for (size_t k = 0; k < length; k++) {
+            data[offset + k] ^= block[k];
+        }
+    }
+    memzero(block, sizeof(block));
+}
+
+// HMAC(mac key, file id || index || ciphertext)
+void PrecomputeStore::tag(uint64_t index, const uint8_t* ciphertext, uint8_t* out) const {
+    uint8_t input[16 + 8 + ENTRY_SIZE];
+    std::memcpy(input, map_ + FILE_ID_OFFSET, 16);
+    store64(input + 16, index);
+    std::memcpy(input + 24, ciphertext, ENTRY_SIZE);
+    hmac_sha256(mac_key_, sizeof(mac_key_), input, sizeof(input), out);
+}
+
+bool PrecomputeStore::read(uint64_t index, uint8_t* scalars, uint8_t* points) const {
+    if (index >= load64(map_ + COUNT_OFFSET)) {
+        return false;
+    }
+    const uint8_t* ciphertext = slot(index);
+    uint8_t expected[32];
+    tag(index, ciphertext, expected);
+    uint8_t difference = 0;
+    for (size_t i = 0; i < sizeof(expected); i++) {
+        difference |= expected[i] ^ ciphertext[ENTRY_SIZE + i];
+    }
+    if (difference != 0) {
+        MTA_LOG_ERROR("Precompute store entry %llu does not verify", static_cast<unsigned long long>(index));
+        return false;
+    }
+
+    uint8_t entry[ENTRY_SIZE];
+    std::memcpy(entry, ciphertext, ENTRY_SIZE);
+    keystream(index, entry);
+    std::memcpy(scalars, entry, SCALARS_SIZE);
+    std::memcpy(points, entry + SCALARS_SIZE, POINTS_SIZE);
+    memzero(entry, sizeof(entry));
+    return true;
+}
+
+bool PrecomputeStore::remap(size_t size) {
+    if (::ftruncate(fd_, static_cast<off_t>(size)) != 0) {
+        MTA_LOG_ERROR("Cannot grow precompute store: %s", std::strerror(errno));
+        return false;
+    }
+    void* map = ::mremap(map_, map_size_, size, MREMAP_MAYMOVE);
+    if (map == MAP_FAILED) {
+        MTA_LOG_ERROR("Cannot map grown precompute store: %s", std::strerror(errno));
+        return false;
+    }
+    map_ = static_cast<uint8_t*>(map);
+    map_size_ = size;
+    return true;
+}
+
+bool PrecomputeStore::append(const uint8_t* scalars, const uint8_t* points) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    size_t end = HEADER_SIZE + (appended_ + 1) * SLOT_SIZE;
+    if (end > map_size_ && !remap(HEADER_SIZE + (appended_ + GROW_ENTRIES) * SLOT_SIZE)) {
+        return false;
+    }
+
+    // Sealed on the stack: the shared mapping only ever sees ciphertext
+    uint8_t sealed[SLOT_SIZE];
+    std::memcpy(sealed, scalars, SCALARS_SIZE);
+    std::memcpy(sealed + SCALARS_SIZE, points, POINTS_SIZE);
+    keystream(appended_, sealed);
+    tag(appended_, sealed, sealed + ENTRY_SIZE);
+    std::memcpy(slot(appended_), sealed, SLOT_SIZE);
+    memzero(sealed, sizeof(sealed));
+    appended_++;
+    return true;
+}
+
+bool PrecomputeStore::sync() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    // Entries reach the disk before the count that makes them visible
+    if (::msync(map_, map_size_, MS_SYNC) != 0) {
+        MTA_LOG_ERROR("Cannot sync precompute store: %s", std::strerror(errno));
+        return false;
+    }
+    store64(map_ + COUNT_OFFSET, appended_);
+    return ::msync(map_, HEADER_SIZE, MS_SYNC) == 0;
+}
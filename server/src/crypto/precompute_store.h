@@ -0,0 +1,76 @@
+#ifndef PRECOMPUTE_STORE_H
+#define PRECOMPUTE_STORE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+
+// Precomputed Bob OT material kept on disk across restarts: mta_precompute
+// appends entries, tcp_server draws one per session (MTA_PRECOMPUTE_PATH)
+// instead of generating the points while the client waits.
+//
+// An entry is one session's 32 scalars b_i and points b_i*G, before the
+// choice bits are encoded. The file is memory-mapped, little-endian:
+//   header, 4096 bytes: magic "MTAPRE01", uint32 entry size, uint32 0,
+//                       16-byte file id, uint64 entries appended,
+//                       uint64 entries claimed (the cursor)
+//   entries:            ciphertext[ENTRY_SIZE], tag[32]
+// Entries are sealed under a 32-byte key (MTA_PRECOMPUTE_KEY, 64 hex
+// digits): an HMAC-SHA256 keystream and an HMAC-SHA256 tag, both keyed from
+// it and bound to the file id and entry index, so an entry that is altered,
+// moved or copied from another store fails to open.
+//
+// No entry is handed out twice. claim() moves the cursor past a batch and
+// syncs it to disk before any of the batch is used, so a crash loses at
+// most the unused rest of a batch and never reuses one.
+class PrecomputeStore {
+public:
+    static const size_t SCALARS_SIZE = 32 * 32;
+    static const size_t POINTS_SIZE = 32 * 65;
+    static const size_t ENTRY_SIZE = SCALARS_SIZE + POINTS_SIZE;
+    static const size_t KEY_SIZE = 32;
+
+    // 64 hex digits to a key; false if malformed
+    static bool parseKey(const std::string& hex, uint8_t key[KEY_SIZE]);
+
+    // Opens the store at `path`, creating an empty one when `create` is set
+    // and there is none. Null (and an error logged) on failure, including
+    // when another process has it open.
+    static std::unique_ptr<PrecomputeStore> open(const std::string& path, const uint8_t key[KEY_SIZE], bool create);
+    ~PrecomputeStore();
+
+    // Entries appended and not yet claimed
+    uint64_t remaining() const;
+
+    // Claims up to `count` entries for the caller alone, [first, first + n),
+    // and returns n. Thread-safe.
+    size_t claim(size_t count, uint64_t& first);
+    // Decrypts entry `index` into scalars and points; false if its tag does
+    // not verify. Thread-safe.
+    bool read(uint64_t index, uint8_t* scalars, uint8_t* points) const;
+
+    // Seals an entry after the last one, growing the file as needed. It
+    // counts once sync() has written it out.
+    bool append(const uint8_t* scalars, const uint8_t* points);
+    bool sync();
+
+private:
+    PrecomputeStore(int fd, uint8_t* map, size_t map_size, const uint8_t key[KEY_SIZE]);
+
+    bool remap(size_t size);
+    uint8_t* slot(uint64_t index) const;
+    void keystream(uint64_t index, uint8_t* data) const;
+    void tag(uint64_t index, const uint8_t* ciphertext, uint8_t* out) const;
+
+    int fd_;
+    uint8_t* map_;
+    size_t map_size_;
+    uint8_t encryption_key_[32];
+    uint8_t mac_key_[32];
+    mutable std::mutex mutex_;
+    uint64_t appended_;                 // including entries not yet synced
+};
+
+#endif // PRECOMPUTE_STORE_H
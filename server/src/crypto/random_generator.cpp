@@ -1,11 +1,27 @@
 #include <random_generator.h>
+#include <atomic>
 
 extern "C" {
     #include <trezor-crypto/rand.h>
 }
 
+static std::atomic<SecureRandom::Source> random_source{nullptr};
+
 SecureRandom::SecureRandom() {}
 
+void SecureRandom::setSource(Source source) {
+    random_source.store(source, std::memory_order_release);
+}
+
+void SecureRandom::fillRandom(uint8_t* out, size_t length) {
+    Source source = random_source.load(std::memory_order_acquire);
+    if (source == nullptr) {
+        random_buffer(out, length);
+        return;
+    }
+    source(out, length);
+}
+
 uint32_t SecureRandom::bytesToUint32(const uint8_t* bytes) const {
     uint32_t value = 0;
     for (int i = 3; i >= 0; --i) {
@@ -15,14 +31,19 @@ uint32_t SecureRandom::bytesToUint32(const uint8_t* bytes) const {
 }
 
 uint32_t SecureRandom::generateMultiplicativeShare() {
-    return random32();
+    if (random_source.load(std::memory_order_acquire) == nullptr) {
+        return random32();
+    }
+    uint8_t bytes[4];
+    fillRandom(bytes, sizeof(bytes));
+    return bytesToUint32(bytes);
 }
 
 void SecureRandom::generateScalar(uint8_t* out) {
     uint8_t candidate[32];
     
     do {
-        random_buffer(candidate, 32);
+        fillRandom(candidate, 32);
         
         bignum256 bn_candidate;
         bn_read_be(candidate, &bn_candidate);
@@ -36,4 +57,4 @@ void SecureRandom::generateScalar(uint8_t* out) {
     for (int i = 0; i < 32; i++) {
         out[i] = candidate[i];
     }
-}
\ No newline at end of file
+}
@@ -1,6 +1,7 @@
 #ifndef RANDOM_GENERATOR_H
 #define RANDOM_GENERATOR_H
 
+#include <cstddef>
 #include <cstdint>
 #include <stdexcept>
 
@@ -18,6 +19,15 @@ public:
     SecureRandom();
     uint32_t generateMultiplicativeShare();
     void generateScalar(uint8_t* out);
+
+    // Replaces the system RNG for the whole process; nullptr restores it.
+    // Nothing in the server installs one. mta_bench injects its own seeded
+    // stream so that benchmark runs are reproducible.
+    using Source = void (*)(uint8_t* out, size_t length);
+    static void setSource(Source source);
+
+private:
+    static void fillRandom(uint8_t* out, size_t length);
 };
 
 #endif
@@ -0,0 +1,177 @@
+#include "secure_arena.h"
+#include "logger.h"
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <cstring>
+#include <mutex>
+#include <new>
+#include <sys/mman.h>
+#include <unistd.h>
+
+extern "C" {
+    #include <trezor-crypto/memzero.h>
+}
+
+static const size_t CLASS_COUNT = 8;            // MIN_SLOT_SIZE << 0 .. 7
+static const size_t SLAB_BYTES = 16 * 1024;
+
+// A free slot holds the next free slot of its class; the rest of it is zero
+struct FreeSlot {
+    FreeSlot* next;
+};
+
+// Shared state, under arena_mutex
+static std::mutex arena_mutex;
+static size_t region_bytes = 0;                 // 0 until the first region
+static uint8_t* region_next = nullptr;
+static uint8_t* region_end = nullptr;
+static FreeSlot* orphaned[CLASS_COUNT];         // left by threads that exited
+
+static std::atomic<bool> lock_warned{false};
+static std::atomic<size_t> mapped_bytes{0};       // regions only
+static std::atomic<size_t> locked_bytes{0};
+
+// Free lists of one thread, returned to the arena when it exits
+struct ThreadCache {
+    FreeSlot* free[CLASS_COUNT] = {};
+
+    ~ThreadCache() {
+        std::lock_guard<std::mutex> lock(arena_mutex);
+        for (size_t i = 0; i < CLASS_COUNT; i++) {
+            while (free[i] != nullptr) {
+                FreeSlot* slot = free[i];
+                free[i] = slot->next;
+                slot->next = orphaned[i];
+                orphaned[i] = slot;
+            }
+        }
+    }
+};
+
+static thread_local ThreadCache thread_cache;
+
+static size_t classIndex(size_t size) {
+    size_t index = 0;
+    while ((SecureArena::MIN_SLOT_SIZE << index) < size) {
+        index++;
+    }
+    return index;
+}
+
+static size_t pageRound(size_t size) {
+    static const size_t page_size = static_cast<size_t>(::sysconf(_SC_PAGESIZE));
+    return (size + page_size - 1) / page_size * page_size;
+}
+
+// Anonymous memory kept out of core dumps and, limits permitting, locked
+// in RAM; null if it cannot be mapped
+static uint8_t* mapLocked(size_t bytes, bool& locked) {
+    void* map = ::mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (map == MAP_FAILED) {
+        MTA_LOG_ERROR("Secure arena: cannot map %zu bytes: %s", bytes, std::strerror(errno));
+        return nullptr;
+    }
+#ifdef MADV_DONTDUMP
+    ::madvise(map, bytes, MADV_DONTDUMP);
+#endif
+    locked = ::mlock(map, bytes) == 0;
+    if (!locked && !lock_warned.exchange(true)) {
+        MTA_LOG_WARN("Secure arena: cannot lock %zu bytes (%s); secrets may be swapped out. "
+                     "Raise RLIMIT_MEMLOCK (ulimit -l)", bytes, std::strerror(errno));
+    }
+    return static_cast<uint8_t*>(map);
+}
+
+// Maps the next region; under arena_mutex
+static bool mapRegion() {
+    if (region_bytes == 0) {
+        region_bytes = SecureArena::DEFAULT_REGION_BYTES;
+    }
+    bool locked;
+    uint8_t* region = mapLocked(region_bytes, locked);
+    if (region == nullptr) {
+        return false;
+    }
+    mapped_bytes.fetch_add(region_bytes, std::memory_order_relaxed);
+    if (locked) {
+        locked_bytes.fetch_add(region_bytes, std::memory_order_relaxed);
+    }
+    region_next = region;
+    region_end = region + region_bytes;
+    return true;
+}
+
+// Refills the thread's list of class `index` from slots left by exited
+// threads or from a new slab
+static void refill(size_t index) {
+    std::lock_guard<std::mutex> lock(arena_mutex);
+    if (orphaned[index] != nullptr) {
+        thread_cache.free[index] = orphaned[index];
+        orphaned[index] = nullptr;
+        return;
+    }
+    if (static_cast<size_t>(region_end - region_next) < SLAB_BYTES && !mapRegion()) {
+        throw std::bad_alloc();
+    }
+    uint8_t* slab = region_next;
+    region_next += SLAB_BYTES;
+
+    size_t slot_size = SecureArena::MIN_SLOT_SIZE << index;
+    FreeSlot* head = nullptr;
+    for (size_t offset = SLAB_BYTES; offset >= slot_size; offset -= slot_size) {
+        FreeSlot* slot = reinterpret_cast<FreeSlot*>(slab + offset - slot_size);
+        slot->next = head;
+        head = slot;
+    }
+    thread_cache.free[index] = head;
+}
+
+void SecureArena::reserve(size_t bytes) {
+    std::lock_guard<std::mutex> lock(arena_mutex);
+    region_bytes = (std::max(bytes, SLAB_BYTES) + SLAB_BYTES - 1) / SLAB_BYTES * SLAB_BYTES;
+    if (region_next == nullptr) {
+        mapRegion();
+    }
+}
+
+void* SecureArena::allocate(size_t size) {
+    if (size > MAX_SLOT_SIZE) {
+        bool locked;
+        uint8_t* data = mapLocked(pageRound(size), locked);
+        if (data == nullptr) {
+            throw std::bad_alloc();
+        }
+        return data;
+    }
+
+    size_t index = classIndex(size);
+    if (thread_cache.free[index] == nullptr) {
+        refill(index);
+    }
+    FreeSlot* slot = thread_cache.free[index];
+    thread_cache.free[index] = slot->next;
+    slot->next = nullptr;
+    return slot;
+}
+
+void SecureArena::release(void* data, size_t size) {
+    memzero(data, size);
+    if (size > MAX_SLOT_SIZE) {
+        ::munmap(data, pageRound(size));
+        return;
+    }
+
+    size_t index = classIndex(size);
+    FreeSlot* slot = static_cast<FreeSlot*>(data);
+    slot->next = thread_cache.free[index];
+    thread_cache.free[index] = slot;
+}
+
+size_t SecureArena::mappedBytes() {
+    return mapped_bytes.load(std::memory_order_relaxed);
+}
+
+size_t SecureArena::lockedBytes() {
+    return locked_bytes.load(std::memory_order_relaxed);
+}
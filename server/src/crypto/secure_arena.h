@@ -0,0 +1,95 @@
+#ifndef SECURE_ARENA_H
+#define SECURE_ARENA_H
+
+#include <cstddef>
+#include <cstdint>
+
+// Locked memory for secret scalars and shares, kept out of swap and core
+// dumps. Regions are mapped, mlock'd and marked MADV_DONTDUMP once, up front,
+// and carved into slabs of power-of-two slots from 32 bytes to 4 KB. Each
+// thread allocates from and frees to its own free lists, so a session's
+// allocations take no lock and no system call; a thread only takes the
+// arena lock to carve a new slab, and maps another region when the current
+// one is used up. Slots are zeroed when freed.
+//
+// If the memlock limit (RLIMIT_MEMLOCK) is too low the memory is still
+// excluded from core dumps, and a warning says it is not locked.
+class SecureArena {
+public:
+    static const size_t MIN_SLOT_SIZE = 32;
+    static const size_t MAX_SLOT_SIZE = 4096;
+    static const size_t DEFAULT_REGION_BYTES = 1024 * 1024;
+
+    // Maps and locks the first region of `region_bytes` now, and sizes later
+    // ones the same. Call before any allocation, e.g. at server start;
+    // otherwise the first allocation maps one of DEFAULT_REGION_BYTES.
+    static void reserve(size_t region_bytes);
+
+    // Zeroed memory of at least `size` bytes. Sizes above MAX_SLOT_SIZE get
+    // a locked mapping of their own.
+    static void* allocate(size_t size);
+    // Zeroes the `size` bytes at `data` and returns the slot
+    static void release(void* data, size_t size);
+
+    // Bytes of slab regions mapped so far, and how many of them are locked
+    static size_t mappedBytes();
+    static size_t lockedBytes();
+};
+
+// A buffer in the arena, released (and so zeroed) with its owner
+class SecureBuffer {
+public:
+    explicit SecureBuffer(size_t size)
+        : data_(static_cast<uint8_t*>(SecureArena::allocate(size))),
+          size_(size) {}
+    ~SecureBuffer() {
+        if (data_ != nullptr) {
+            SecureArena::release(data_, size_);
+        }
+    }
+
+    SecureBuffer(SecureBuffer&& other) noexcept : data_(other.data_), size_(other.size_) {
+        other.data_ = nullptr;
+        other.size_ = 0;
+    }
+    SecureBuffer& operator=(SecureBuffer&& other) noexcept {
+        if (this != &other) {
+            if (data_ != nullptr) {
+                SecureArena::release(data_, size_);
+            }
+            data_ = other.data_;
+            size_ = other.size_;
+            other.data_ = nullptr;
+            other.size_ = 0;
+        }
+        return *this;
+    }
+    SecureBuffer(const SecureBuffer&) = delete;
+    SecureBuffer& operator=(const SecureBuffer&) = delete;
+
+    uint8_t* data() { return data_; }
+    const uint8_t* data() const { return data_; }
+    size_t size() const { return size_; }
+
+private:
+    uint8_t* data_;
+    size_t size_;
+};
+
+// A secret integer kept in the arena, e.g. a share or a mask
+template <typename T>
+class SecureValue {
+public:
+    SecureValue() : buffer_(sizeof(T)) {}
+    explicit SecureValue(T value) : buffer_(sizeof(T)) { get() = value; }
+
+    T& get() { return *reinterpret_cast<T*>(buffer_.data()); }
+    const T& get() const { return *reinterpret_cast<const T*>(buffer_.data()); }
+    T& operator*() { return get(); }
+    const T& operator*() const { return get(); }
+
+private:
+    SecureBuffer buffer_;
+};
+
+#endif // SECURE_ARENA_H
@@ -1,7 +1,9 @@
-#include <iostream>
 #include <boost/asio.hpp>
 #include <random>
 #include "tcp/mta_server.h"
+#include "tcp/server_config.h"
+#include "crypto/secure_arena.h"
+#include "util/logger.h"
 
 int main(int argc, char* argv[]) {
     try {
@@ -11,7 +13,7 @@ int main(int argc, char* argv[]) {
         if (argc >= 2) {
             port = std::atoi(argv[1]);
             if (port <= 0 || port > 65535) {
-                std::cerr << "Invalid port number: " << port << std::endl;
+                MTA_LOG_ERROR("Invalid port number: %d", port);
                 return 1;
             }
         }
@@ -20,30 +22,33 @@ int main(int argc, char* argv[]) {
             bob_share = static_cast<uint32_t>(std::atoi(argv[2]));
         }
         
-        std::cout << "Usage: " << argv[0] << " [port] [bob_multiplicative_share]" << std::endl;
-        std::cout << "Port: " << port << std::endl;
+        MTA_LOG_INFO("Usage: %s [port] [bob_multiplicative_share]", argv[0]);
+        MTA_LOG_INFO("Port: %d", port);
         
         if (bob_share == 0) {
             std::random_device rd;
             std::mt19937 gen(rd());
             std::uniform_int_distribution<uint32_t> dis(1, 1000000);
             bob_share = dis(gen);
-            std::cout << "Generated random Bob's multiplicative share: " << bob_share << std::endl;
+            MTA_LOG_INFO("Generated random Bob's multiplicative share: %u", bob_share);
         } else {
-            std::cout << "Using provided Bob's multiplicative share: " << bob_share << std::endl;
+            MTA_LOG_INFO("Using provided Bob's multiplicative share: %u", bob_share);
         }
                 
+        ServerConfig config = ServerConfig::fromEnvironment();
+        SecureArena::reserve(config.secure_arena_bytes);
+        
         boost::asio::io_context io_context;
         
-        MTAServer server(io_context, static_cast<short>(port), bob_share);
+        MTAServer server(io_context, static_cast<short>(port), bob_share, config);
         
-        std::cout << "Server is running. Press Ctrl+C to stop." << std::endl;
-        std::cout << "Waiting for Alice (client) to connect...\n" << std::endl;
+        MTA_LOG_INFO("Server is running. Press Ctrl+C to stop.");
+        MTA_LOG_INFO("Waiting for Alice (client) to connect...");
         
         io_context.run();
         
     } catch (std::exception& e) {
-        std::cerr << "Exception: " << e.what() << std::endl;
+        MTA_LOG_ERROR("Exception: %s", e.what());
         return 1;
     }
     
@@ -0,0 +1,55 @@
+#include "bob_setup_template.h"
+#include "logger.h"
+#include <algorithm>
+#include <cstring>
+
+BobSetupTemplate::BobSetupTemplate(MTAProtobufHandler& protobuf_handler, size_t point_count, size_t point_size,
+                                   const std::vector<uint8_t>& public_key, uint32_t features)
+    : point_size_(point_size),
+      features_(features) {
+    // Placeholder i is point_size copies of one byte, distinct per point, so
+    // that it can be found again in the encoded message
+    std::vector<std::vector<uint8_t>> placeholders;
+    for (size_t i = 0; i < point_count; i++) {
+        placeholders.emplace_back(point_size, static_cast<uint8_t>(0x80 + i));
+    }
+
+    mta_BobSetup setup = mta_BobSetup_init_zero;
+    setup.success = true;
+    setup.num_ot_instances = static_cast<uint32_t>(point_count);
+    setup.features = features;
+    setup.ot_messages.funcs.encode = MTAProtobufHandler::encode_bytes_array;
+    setup.ot_messages.arg = &placeholders;
+    setup.public_key.size = std::min(sizeof(setup.public_key.bytes), public_key.size());
+    std::copy(public_key.begin(), public_key.begin() + setup.public_key.size, setup.public_key.bytes);
+
+    std::vector<uint8_t> message = protobuf_handler.serializeBobSetup(setup);
+    if (message.empty() || point_count == 0 || point_count > 0x80) {
+        MTA_LOG_WARN("BobSetup template unavailable, sessions will encode their setup");
+        return;
+    }
+
+    uint32_t size = static_cast<uint32_t>(message.size());
+    frame_ = {static_cast<uint8_t>(size), static_cast<uint8_t>(size >> 8),
+              static_cast<uint8_t>(size >> 16), static_cast<uint8_t>(size >> 24)};
+    frame_.insert(frame_.end(), message.begin(), message.end());
+
+    auto search_from = frame_.begin() + 4;
+    for (const std::vector<uint8_t>& placeholder : placeholders) {
+        auto found = std::search(search_from, frame_.end(), placeholder.begin(), placeholder.end());
+        if (found == frame_.end()) {
+            MTA_LOG_WARN("BobSetup template unavailable, sessions will encode their setup");
+            point_offsets_.clear();
+            return;
+        }
+        point_offsets_.push_back(static_cast<size_t>(found - frame_.begin()));
+        search_from = found + point_size;
+    }
+}
+
+void BobSetupTemplate::write(const uint8_t* points, uint8_t* out) const {
+    std::memcpy(out, frame_.data(), frame_.size());
+    for (size_t i = 0; i < point_offsets_.size(); i++) {
+        std::memcpy(out + point_offsets_[i], points + i * point_size_, point_size_);
+    }
+}
@@ -0,0 +1,36 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "protobuf_handler.h"
+
+// A size-prefixed protobuf BobSetup frame encoded once, with blanks where
+// the points go. Apart from the points, every successful BobSetup a server
+// sends is identical: the same tags, lengths, public key, instance count
+// and features. So a session's frame is a copy of the template with its
+// points written in at fixed offsets.
+class BobSetupTemplate {
+public:
+    BobSetupTemplate(MTAProtobufHandler& protobuf_handler, size_t point_count, size_t point_size,
+                     const std::vector<uint8_t>& public_key, uint32_t features);
+
+    // False if the encoder's output could not be mapped, in which case
+    // sessions encode their BobSetup normally
+    bool valid() const { return !point_offsets_.empty(); }
+
+    size_t point_count() const { return point_offsets_.size(); }
+    size_t point_size() const { return point_size_; }
+    uint32_t features() const { return features_; }
+    size_t frame_size() const { return frame_.size(); }
+
+    // Writes the whole frame to `out` (frame_size() bytes), taking
+    // point_count() points of point_size() bytes from `points`
+    void write(const uint8_t* points, uint8_t* out) const;
+
+private:
+    std::vector<uint8_t> frame_;
+    std::vector<size_t> point_offsets_;
+    size_t point_size_;
+    uint32_t features_;
+};
@@ -12,6 +12,7 @@
 /* Struct definitions */
 typedef struct _mta_CorrelationDelta {
     uint32_t delta;
+    uint32_t features;
 } mta_CorrelationDelta;
 
 typedef PB_BYTES_ARRAY_T(256) mta_BobSetup_public_key_t;
@@ -20,6 +21,7 @@ typedef struct _mta_BobSetup {
     pb_callback_t ot_messages;
     mta_BobSetup_public_key_t public_key;
     uint32_t num_ot_instances;
+    uint32_t features;
 } mta_BobSetup;
 
 typedef struct _mta_AliceMessages {
@@ -33,7 +35,7 @@ typedef struct _mta_BobMessages {
     bool success;
     pb_callback_t ot_responses;
     mta_BobMessages_encrypted_result_t encrypted_result;
-    uint32_t correlation_check;
+    uint32_t correlation_check; /* Always 0: the check stays in the server's log and result journal */
     uint32_t masked_share;
 } mta_BobMessages;
 
@@ -49,23 +51,25 @@ extern "C" {
 #endif
 
 /* Initializer values for message structs */
-#define mta_CorrelationDelta_init_default        {0}
-#define mta_BobSetup_init_default                {0, {{NULL}, NULL}, {0, {0}}, 0}
+#define mta_CorrelationDelta_init_default        {0, 0}
+#define mta_BobSetup_init_default                {0, {{NULL}, NULL}, {0, {0}}, 0, 0}
 #define mta_AliceMessages_init_default           {0, {{NULL}, NULL}, {{NULL}, NULL}}
-#define mta_BobMessages_init_default             {0, {{NULL}, NULL}, {0, {0}}, 0}
+#define mta_BobMessages_init_default             {0, {{NULL}, NULL}, {0, {0}}, 0, 0}
 #define mta_MTAResult_init_default               {0, 0, ""}
-#define mta_CorrelationDelta_init_zero           {0}
-#define mta_BobSetup_init_zero                   {0, {{NULL}, NULL}, {0, {0}}, 0}
+#define mta_CorrelationDelta_init_zero           {0, 0}
+#define mta_BobSetup_init_zero                   {0, {{NULL}, NULL}, {0, {0}}, 0, 0}
 #define mta_AliceMessages_init_zero              {0, {{NULL}, NULL}, {{NULL}, NULL}}
-#define mta_BobMessages_init_zero                {0, {{NULL}, NULL}, {0, {0}}, 0}
+#define mta_BobMessages_init_zero                {0, {{NULL}, NULL}, {0, {0}}, 0, 0}
 #define mta_MTAResult_init_zero                  {0, 0, ""}
 
 /* Field tags (for use in manual encoding/decoding) */
 #define mta_CorrelationDelta_delta_tag           1
+#define mta_CorrelationDelta_features_tag        2
 #define mta_BobSetup_success_tag                 1
 #define mta_BobSetup_ot_messages_tag             2
 #define mta_BobSetup_public_key_tag              3
 #define mta_BobSetup_num_ot_instances_tag        4
+#define mta_BobSetup_features_tag                5
 #define mta_AliceMessages_masked_share_tag       1
 #define mta_AliceMessages_ot_choices_tag         2
 #define mta_AliceMessages_encrypted_shares_tag   3
@@ -73,13 +77,15 @@ extern "C" {
 #define mta_BobMessages_ot_responses_tag         2
 #define mta_BobMessages_encrypted_result_tag     3
 #define mta_BobMessages_correlation_check_tag    4
+#define mta_BobMessages_masked_share_tag         5
 #define mta_MTAResult_success_tag                1
 #define mta_MTAResult_additive_share_tag         2
 #define mta_MTAResult_error_message_tag          3
 
 /* Struct field encoding specification for nanopb */
 #define mta_CorrelationDelta_FIELDLIST(X, a) \
-X(a, STATIC,   SINGULAR, UINT32,   delta,             1)
+X(a, STATIC,   SINGULAR, UINT32,   delta,             1) \
+X(a, STATIC,   SINGULAR, UINT32,   features,          2)
 #define mta_CorrelationDelta_CALLBACK NULL
 #define mta_CorrelationDelta_DEFAULT NULL
 
@@ -87,7 +93,8 @@ X(a, STATIC,   SINGULAR, UINT32,   delta,             1)
 X(a, STATIC,   SINGULAR, BOOL,     success,           1) \
 X(a, CALLBACK, REPEATED, BYTES,    ot_messages,       2) \
 X(a, STATIC,   SINGULAR, BYTES,    public_key,        3) \
-X(a, STATIC,   SINGULAR, UINT32,   num_ot_instances,   4)
+X(a, STATIC,   SINGULAR, UINT32,   num_ot_instances,   4) \
+X(a, STATIC,   SINGULAR, UINT32,   features,          5)
 #define mta_BobSetup_CALLBACK pb_default_field_callback
 #define mta_BobSetup_DEFAULT NULL
 
@@ -102,7 +109,8 @@ X(a, CALLBACK, REPEATED, BYTES,    encrypted_shares,   3)
 X(a, STATIC,   SINGULAR, BOOL,     success,           1) \
 X(a, CALLBACK, REPEATED, BYTES,    ot_responses,      2) \
 X(a, STATIC,   SINGULAR, BYTES,    encrypted_result,   3) \
-X(a, STATIC,   SINGULAR, UINT32,   correlation_check,   4)
+X(a, STATIC,   SINGULAR, UINT32,   correlation_check,   4) \
+X(a, STATIC,   SINGULAR, UINT32,   masked_share,      5)
 #define mta_BobMessages_CALLBACK pb_default_field_callback
 #define mta_BobMessages_DEFAULT NULL
 
@@ -131,7 +139,7 @@ extern const pb_msgdesc_t mta_MTAResult_msg;
 /* mta_AliceMessages_size depends on runtime parameters */
 /* mta_BobMessages_size depends on runtime parameters */
 #define MTA_MTA_PB_H_MAX_SIZE                    mta_MTAResult_size
-#define mta_CorrelationDelta_size                6
+#define mta_CorrelationDelta_size                12
 #define mta_MTAResult_size                       138
 
 #ifdef __cplusplus
@@ -1,13 +1,15 @@
 #include "protobuf_handler.h"
-#include <iostream>
+#include "logger.h"
+#include <cstring>
 
 MTAProtobufHandler::MTAProtobufHandler() {}
 
 MTAProtobufHandler::~MTAProtobufHandler() {}
 
-std::vector<uint8_t> MTAProtobufHandler::serializeCorrelationDelta(uint32_t delta) {
+std::vector<uint8_t> MTAProtobufHandler::serializeCorrelationDelta(uint32_t delta, uint32_t features) {
     mta_CorrelationDelta msg = mta_CorrelationDelta_init_zero;
     msg.delta = delta;
+    msg.features = features;
 
     std::vector<uint8_t> buffer(128);
     pb_ostream_t stream = pb_ostream_from_buffer(buffer.data(), buffer.size());
@@ -21,15 +23,22 @@ std::vector<uint8_t> MTAProtobufHandler::serializeCorrelationDelta(uint32_t delt
 }
 
 bool MTAProtobufHandler::deserializeCorrelationDelta(const std::vector<uint8_t>& data, uint32_t& delta) {
+    uint32_t features;
+    return deserializeCorrelationDelta(data, delta, features);
+}
+
+bool MTAProtobufHandler::deserializeCorrelationDelta(const std::vector<uint8_t>& data, uint32_t& delta,
+                                                     uint32_t& features) {
     mta_CorrelationDelta msg = mta_CorrelationDelta_init_zero;
     pb_istream_t stream = pb_istream_from_buffer(data.data(), data.size());
 
     if (!pb_decode(&stream, &mta_CorrelationDelta_msg, &msg)) {
-        std::cerr << "⚠️ Nanopb decode failed: " << PB_GET_ERROR(&stream) << std::endl;
+        MTA_LOG_ERROR("Nanopb decode failed: %s", PB_GET_ERROR(&stream));
         return false;
     }
 
     delta = msg.delta;
+    features = msg.features;
     return true;
 }
 
@@ -40,7 +49,7 @@ std::vector<uint8_t> MTAProtobufHandler::serializeBobSetup(const mta_BobSetup& s
     mta_BobSetup setup_copy = setup;
 
     if (!pb_encode(&stream, mta_BobSetup_fields, &setup_copy)) {
-        std::cerr << "[ERROR] Failed to encode mta_BobSetup: " << PB_GET_ERROR(&stream) << "\n";
+        MTA_LOG_ERROR("Failed to encode mta_BobSetup: %s", PB_GET_ERROR(&stream));
         return {};
     }
 
@@ -58,7 +67,7 @@ bool MTAProtobufHandler::deserializeBobSetup(const std::vector<uint8_t>& data, m
     pb_istream_t stream = pb_istream_from_buffer(data.data(), data.size());
 
     if (!pb_decode(&stream, mta_BobSetup_fields, &setup)) {
-        std::cerr << "[ERROR] Failed to decode mta_BobSetup: " << PB_GET_ERROR(&stream) << "\n";
+        MTA_LOG_ERROR("Failed to decode mta_BobSetup: %s", PB_GET_ERROR(&stream));
         return false;
     }
 
@@ -118,7 +127,7 @@ bool MTAProtobufHandler::deserializeBobMessages(const std::vector<uint8_t>& data
     messages.ot_responses.arg = this;
 
     if (!pb_decode(&stream, &mta_BobMessages_msg, &messages)) {
-        std::cerr << "[PROTOBUF ERROR] Failed to decode BobMessages: " << PB_GET_ERROR(&stream) << std::endl;
+        MTA_LOG_ERROR("Failed to decode BobMessages: %s", PB_GET_ERROR(&stream));
         return false;
     }
 
@@ -154,7 +163,7 @@ messages.masked_share = masked_share;
 
 temp_bool_array_ = ot_choices;
 messages.ot_choices.funcs.encode = encode_bool_array;
-messages.ot_choices.arg = &temp_bool_array_;
+messages.ot_choices.arg = this;
 
 temp_encrypted_shares_ = encrypted_shares;
 messages.encrypted_shares.funcs.encode = encode_bytes_array;
@@ -167,12 +176,10 @@ mta_BobMessages MTAProtobufHandler::createBobMessages(
     bool success,
     const std::vector<std::vector<uint8_t>>& ot_responses,
     const std::vector<uint8_t>& encrypted_result,
-    uint32_t correlation_check,
     uint32_t masked_share
 ) {
     mta_BobMessages messages = mta_BobMessages_init_zero;
     messages.success = success;
-    messages.correlation_check = correlation_check;
     messages.masked_share = masked_share;
 
     temp_ot_responses_ = ot_responses;
@@ -180,7 +187,7 @@ mta_BobMessages MTAProtobufHandler::createBobMessages(
     messages.ot_responses.arg = &temp_ot_responses_;
 
     if (encrypted_result.size() > sizeof(messages.encrypted_result.bytes)) {
-        std::cerr << "[ERROR] Encrypted result exceeds max allowed size\n";
+        MTA_LOG_ERROR("Encrypted result exceeds max allowed size");
     } else {
         messages.encrypted_result.size = encrypted_result.size();
         std::memcpy(messages.encrypted_result.bytes, encrypted_result.data(), encrypted_result.size());
@@ -205,13 +212,13 @@ bool MTAProtobufHandler::decode_bytes_array(pb_istream_t *stream, const pb_field
 
     pb_istream_t substream;
     if (!pb_make_string_substream(stream, &substream)) {
-        std::cerr << "[PROTOBUF ERROR] Failed to make string substream\n";
+        MTA_LOG_ERROR("Failed to make string substream");
         return false;
     }
 
     std::vector<uint8_t> bytes(substream.bytes_left);
     if (!pb_read(&substream, bytes.data(), substream.bytes_left)) {
-        std::cerr << "[PROTOBUF ERROR] Failed to read from substream\n";
+        MTA_LOG_ERROR("Failed to read from substream");
         pb_close_string_substream(stream, &substream);
         return false;
     }
@@ -219,7 +226,7 @@ bool MTAProtobufHandler::decode_bytes_array(pb_istream_t *stream, const pb_field
     handler->temp_bytes_arrays_.push_back(std::move(bytes));
 
     if (!pb_close_string_substream(stream, &substream)) {
-        std::cerr << "[PROTOBUF ERROR] Failed to close string substream\n";
+        MTA_LOG_ERROR("Failed to close string substream");
         return false;
     }
 
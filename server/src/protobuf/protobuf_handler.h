@@ -13,7 +13,7 @@ public:
     MTAProtobufHandler();
     ~MTAProtobufHandler();
 
-    std::vector<uint8_t> serializeCorrelationDelta(uint32_t delta);
+    std::vector<uint8_t> serializeCorrelationDelta(uint32_t delta, uint32_t features = 0);
     std::vector<uint8_t> serializeBobSetup(const mta_BobSetup& setup);
     std::vector<uint8_t> serializeAliceMessages(const mta_AliceMessages& messages);
     std::vector<uint8_t> serializeBobMessages(const mta_BobMessages& messages);
@@ -27,6 +27,7 @@ public:
         std::vector<std::vector<uint8_t>> temp_ot_responses_;
 
     bool deserializeCorrelationDelta(const std::vector<uint8_t>& data, uint32_t& delta);
+    bool deserializeCorrelationDelta(const std::vector<uint8_t>& data, uint32_t& delta, uint32_t& features);
     bool deserializeBobSetup(const std::vector<uint8_t>& data, mta_BobSetup& setup);
     bool deserializeAliceMessages(const std::vector<uint8_t>& data, mta_AliceMessages& messages);
     bool deserializeBobMessages(const std::vector<uint8_t>& data, mta_BobMessages& messages);
@@ -43,7 +44,6 @@ public:
     mta_BobMessages createBobMessages(bool success,
                                       const std::vector<std::vector<uint8_t>>& ot_responses,
                                       const std::vector<uint8_t>& encrypted_result,
-                                      uint32_t correlation_check,
                                       uint32_t masked_share);
 
     static bool decode_single_bytes(pb_istream_t *stream, const pb_field_t *field, void **arg);
@@ -0,0 +1,180 @@
+#include "binary_codec.h"
+#include "crypto_operations.h"
+#include <algorithm>
+#include <bit>
+#include <cstring>
+
+static_assert(std::endian::native == std::endian::little, "BinaryCodec copies integers as they are in memory");
+
+static const size_t OT_INSTANCES = 32;
+static const size_t BLOCK_SIZE = 32;
+
+static void store32(uint8_t* out, uint32_t value) {
+    std::memcpy(out, &value, sizeof(value));
+}
+
+static void store16(uint8_t* out, uint16_t value) {
+    std::memcpy(out, &value, sizeof(value));
+}
+
+static uint32_t load32(const uint8_t* data) {
+    uint32_t value;
+    std::memcpy(&value, data, sizeof(value));
+    return value;
+}
+
+static uint16_t load16(const uint8_t* data) {
+    uint16_t value;
+    std::memcpy(&value, data, sizeof(value));
+    return value;
+}
+
+// `count` uncompressed points to their wire form at `out`
+static void storePoints(const uint8_t* points, size_t count, uint32_t features, uint8_t* out) {
+    if (features & MTAProtocol::FEATURE_COMPRESSED_POINTS) {
+        CryptoOperations::compressPoints(points, count, out);
+    } else {
+        std::memcpy(out, points, count * 65);
+    }
+}
+
+static bool loadPoints(const uint8_t* data, size_t count, uint32_t features, std::vector<uint8_t>& points) {
+    points.resize(count * 65);
+    if (features & MTAProtocol::FEATURE_COMPRESSED_POINTS) {
+        return CryptoOperations::decompressPoints(data, count, points.data());
+    }
+    std::memcpy(points.data(), data, count * 65);
+    return true;
+}
+
+void BinaryCodec::encodeCorrelationDelta(uint32_t delta, uint32_t features, std::vector<uint8_t>& out) {
+    out.resize(9);
+    out[0] = VERSION;
+    store32(&out[1], delta);
+    store32(&out[5], features);
+}
+
+bool BinaryCodec::decodeCorrelationDelta(std::span<const uint8_t> message, uint32_t& delta, uint32_t& features) {
+    if (message.size() != 9 || message[0] != VERSION) {
+        return false;
+    }
+    delta = load32(&message[1]);
+    features = load32(&message[5]);
+    return true;
+}
+
+void BinaryCodec::encodeBobSetup(const MTAProtocol::BobSetup& setup, std::vector<uint8_t>& out) {
+    size_t point_count = setup.points_B.size() / 65;
+    size_t points_size = point_count * MTAProtocol::wirePointSize(setup.features);
+    uint16_t key_size = static_cast<uint16_t>(std::min<size_t>(setup.public_key.size(), UINT16_MAX));
+
+    out.resize(12 + points_size + key_size);
+    out[0] = VERSION;
+    out[1] = setup.success ? 1 : 0;
+    store32(&out[2], static_cast<uint32_t>(point_count));
+    store32(&out[6], setup.features);
+    store16(&out[10], key_size);
+    storePoints(setup.points_B.data(), point_count, setup.features, &out[12]);
+    if (key_size > 0) {
+        std::memcpy(&out[12 + points_size], setup.public_key.data(), key_size);
+    }
+}
+
+bool BinaryCodec::decodeBobSetup(std::span<const uint8_t> message, MTAProtocol::BobSetup& setup) {
+    if (message.size() < 12 || message[0] != VERSION) {
+        return false;
+    }
+    uint32_t point_count = load32(&message[2]);
+    uint32_t features = load32(&message[6]);
+    uint16_t key_size = load16(&message[10]);
+    if (point_count > OT_INSTANCES) {
+        return false;
+    }
+    size_t points_size = point_count * MTAProtocol::wirePointSize(features);
+    if (message.size() != 12 + points_size + key_size) {
+        return false;
+    }
+
+    setup.success = message[1] != 0;
+    setup.num_ot_instances = point_count;
+    setup.features = features;
+    if (!loadPoints(&message[12], point_count, features, setup.points_B)) {
+        return false;
+    }
+    setup.public_key.assign(message.begin() + 12 + points_size, message.end());
+    return true;
+}
+
+void BinaryCodec::encodeAliceMessages(const MTAProtocol::AliceMessages& messages, uint32_t features,
+                                      std::vector<uint8_t>& out) {
+    size_t count = messages.points_A.size() / 65;
+    size_t points_size = count * MTAProtocol::wirePointSize(features);
+    size_t blocks_size = count * BLOCK_SIZE;
+
+    out.resize(6 + points_size + 2 * blocks_size);
+    out[0] = VERSION;
+    out[1] = messages.success ? 1 : 0;
+    store32(&out[2], messages.masked_share);
+    if (features & MTAProtocol::FEATURE_INTERLEAVED_MESSAGES) {
+        MTAProtocol::writeInterleavedRecords(messages, features, &out[6]);
+        return;
+    }
+    storePoints(messages.points_A.data(), count, features, &out[6]);
+    std::memcpy(&out[6 + points_size], messages.encrypted_m0_messages.data(), blocks_size);
+    std::memcpy(&out[6 + points_size + blocks_size], messages.encrypted_m1_messages.data(), blocks_size);
+}
+
+bool BinaryCodec::decodeAliceMessages(std::span<const uint8_t> message, uint32_t features,
+                                      MTAProtocol::AliceMessages& messages, size_t count) {
+    size_t points_size = count * MTAProtocol::wirePointSize(features);
+    size_t blocks_size = count * BLOCK_SIZE;
+    if (count > OT_INSTANCES || message.size() != 6 + points_size + 2 * blocks_size || message[0] != VERSION) {
+        return false;
+    }
+
+    messages.success = message[1] != 0;
+    messages.masked_share = load32(&message[2]);
+    if (!loadPoints(&message[6], count, features, messages.points_A)) {
+        return false;
+    }
+    const uint8_t* blocks = &message[6 + points_size];
+    messages.encrypted_m0_messages.assign(blocks, blocks + blocks_size);
+    messages.encrypted_m1_messages.assign(blocks + blocks_size, blocks + 2 * blocks_size);
+    return true;
+}
+
+void BinaryCodec::encodeBobMessages(const MTAProtocol::BobMessages& messages, std::vector<uint8_t>& out) {
+    uint16_t response_count = static_cast<uint16_t>(messages.ot_responses.size() / BLOCK_SIZE);
+    uint16_t result_size = static_cast<uint16_t>(std::min<size_t>(messages.encrypted_result.size(), UINT16_MAX));
+    size_t responses_size = response_count * BLOCK_SIZE;
+
+    out.resize(10 + responses_size + result_size);
+    out[0] = VERSION;
+    out[1] = messages.success ? 1 : 0;
+    store32(&out[2], messages.masked_share);
+    store16(&out[6], response_count);
+    store16(&out[8], result_size);
+    if (responses_size > 0) {
+        std::memcpy(&out[10], messages.ot_responses.data(), responses_size);
+    }
+    if (result_size > 0) {
+        std::memcpy(&out[10 + responses_size], messages.encrypted_result.data(), result_size);
+    }
+}
+
+bool BinaryCodec::decodeBobMessages(std::span<const uint8_t> message, MTAProtocol::BobMessages& messages) {
+    if (message.size() < 10 || message[0] != VERSION) {
+        return false;
+    }
+    size_t responses_size = load16(&message[6]) * BLOCK_SIZE;
+    size_t result_size = load16(&message[8]);
+    if (message.size() != 10 + responses_size + result_size) {
+        return false;
+    }
+
+    messages.success = message[1] != 0;
+    messages.masked_share = load32(&message[2]);
+    messages.ot_responses.assign(message.begin() + 10, message.begin() + 10 + responses_size);
+    messages.encrypted_result.assign(message.begin() + 10 + responses_size, message.end());
+    return true;
+}
@@ -0,0 +1,62 @@
+#ifndef BINARY_CODEC_H
+#define BINARY_CODEC_H
+
+#include "mta_protocol.h"
+#include <cstdint>
+#include <span>
+#include <vector>
+
+// Fixed-layout binary encoding of the four session messages, the fast
+// alternative to the protobuf wire format. Every field sits at a fixed
+// offset, integers are little-endian, and encode and decode are a bounds
+// check plus memcpy, with no tags, varints or callbacks.
+//
+// A client selects it with the first byte of its CorrelationDelta. A
+// protobuf message starts with a field tag, whose low three bits are the
+// wire type, and wire type 7 does not exist: a decoder rejects it rather
+// than skipping it as an unknown field. So VERSION, which has those bits
+// set, cannot start a protobuf message, the server tells the two apart
+// without a separate handshake, and every later message of the session
+// uses the same codec. Each message starts with VERSION.
+//
+//   CorrelationDelta  0 version  1 delta:u32  5 features:u32               (9)
+//   BobSetup          0 version  1 success:u8  2 num_ot_instances:u32
+//                     6 features:u32  10 public_key_size:u16
+//                     12 points  then public key
+//   AliceMessages     0 version  1 success:u8  2 masked_share:u32
+//                     6 n points A  then n x 32 m0, n x 32 m1
+//                     (n = 32, or MTAProtocol::STREAM_CHUNK when streamed;
+//                     interleaved, n records of point A, m0, m1 instead,
+//                     which the server reads record by record)
+//   BobMessages       0 version  1 success:u8  2 masked_share:u32
+//                     6 ot_response_count:u16  8 encrypted_result_size:u16
+//                     10 responses (32 each)  then encrypted result
+//
+// Points are 65 or 33 bytes as MTAProtocol::wirePointSize(features) says.
+class BinaryCodec {
+public:
+    static const uint8_t VERSION = 0xB7;
+    static_assert((VERSION & 7) == 7, "VERSION must not parse as a protobuf tag");
+
+    // Whether `message` is in this encoding
+    static bool isBinary(std::span<const uint8_t> message) {
+        return !message.empty() && message[0] == VERSION;
+    }
+
+    static void encodeCorrelationDelta(uint32_t delta, uint32_t features, std::vector<uint8_t>& out);
+    static bool decodeCorrelationDelta(std::span<const uint8_t> message, uint32_t& delta, uint32_t& features);
+
+    // Compresses the points when setup.features asks for it
+    static void encodeBobSetup(const MTAProtocol::BobSetup& setup, std::vector<uint8_t>& out);
+    static bool decodeBobSetup(std::span<const uint8_t> message, MTAProtocol::BobSetup& setup);
+
+    static void encodeAliceMessages(const MTAProtocol::AliceMessages& messages, uint32_t features,
+                                    std::vector<uint8_t>& out);
+    static bool decodeAliceMessages(std::span<const uint8_t> message, uint32_t features,
+                                    MTAProtocol::AliceMessages& messages, size_t count = 32);
+
+    static void encodeBobMessages(const MTAProtocol::BobMessages& messages, std::vector<uint8_t>& out);
+    static bool decodeBobMessages(std::span<const uint8_t> message, MTAProtocol::BobMessages& messages);
+};
+
+#endif // BINARY_CODEC_H
@@ -1,10 +1,20 @@
 #include "cot_protocol.h"
-#include <iostream>
+#include "logger.h"
 #include <cstring>
 
-CorrelatedOTProtocol::CorrelatedOTProtocol() {
+extern "C" {
+    #include <trezor-crypto/memzero.h>
+}
+
+CorrelatedOTProtocol::CorrelatedOTProtocol() : stored_scalars(BIT_LENGTH * 32) {
     ot_instances.reserve(BIT_LENGTH);
-    stored_scalars.resize(BIT_LENGTH * 32);
+    correlation_x = 0;
+}
+
+void CorrelatedOTProtocol::reset() {
+    ot_instances.clear();
+    memzero(stored_scalars.data(), stored_scalars.size());
+    *choice_bits = 0;
     correlation_x = 0;
 }
 
@@ -17,23 +27,66 @@ bool CorrelatedOTProtocol::generatePointB(int index, uint8_t* point_B_out) {
         return false;
     }
     
-    uint8_t* b_scalar = &stored_scalars[index * 32];
+    uint8_t* b_scalar = stored_scalars.data() + index * 32;
     
     if (!crypto_ops.generateECDHKeyPair(b_scalar, point_B_out)) {
-        std::cerr << "generateECDHKeyPair failed at index " << index << "\n";
+        MTA_LOG_ERROR("generateECDHKeyPair failed at index %d", index);
         return false;
     }
     
+    if (getBit(*choice_bits, index) &&
+        !crypto_ops.addPoints(point_B_out, CryptoOperations::choicePoint(), point_B_out)) {
+        MTA_LOG_ERROR("Failed to encode choice bit at index %d", index);
+        return false;
+    }
+    
+    return true;
+}
+
+const uint8_t* CorrelatedOTProtocol::prepareCOT(uint32_t alice_x, uint32_t choice_bits, const uint8_t* scalars) {
+    correlation_x = alice_x;
+    *this->choice_bits = choice_bits;
+    
+    ot_instances.clear();
+    
+    for (int i = 0; i < BIT_LENGTH; i++) {
+        ot_instances.push_back(std::make_unique<ObliviousTransferProtocol>());
+        if (scalars != nullptr) {
+            std::memcpy(stored_scalars.data() + i * 32, scalars + i * 32, 32);
+        } else {
+            crypto_ops.generateRandomScalar(stored_scalars.data() + i * 32);
+        }
+    }
+    
+    return stored_scalars.data();
+}
+
+bool CorrelatedOTProtocol::encodeChoiceBits(uint8_t* points_B, int first, int count) {
+    if (first < 0 || count < 0 || first + count > BIT_LENGTH) {
+        return false;
+    }
+    const uint8_t* choice_point = CryptoOperations::choicePoint();
+    for (int i = first; i < first + count; i++) {
+        if (!getBit(*choice_bits, i)) {
+            continue;
+        }
+        uint8_t* point_B = points_B + i * 65;
+        if (!crypto_ops.addPoints(point_B, choice_point, point_B)) {
+            MTA_LOG_ERROR("Failed to encode choice bit at index %d", i);
+            return false;
+        }
+    }
     return true;
 }
 
-CorrelatedOTProtocol::COTSetup CorrelatedOTProtocol::initializeCOT(uint32_t alice_x) {
+CorrelatedOTProtocol::COTSetup CorrelatedOTProtocol::initializeCOT(uint32_t alice_x, uint32_t choice_bits) {
     COTSetup setup;
     setup.points_B.resize(BIT_LENGTH * 65);
     setup.correlation_x = alice_x;
     setup.success = false;
     
     correlation_x = alice_x;
+    *this->choice_bits = choice_bits;
     
     ot_instances.clear();
     
@@ -62,9 +115,14 @@ bool CorrelatedOTProtocol::processSingleCOT(
     if (bit_index >= BIT_LENGTH || bit_index < 0) {
         return false;
     }
-    uint8_t* b_scalar = &stored_scalars[bit_index * 32];
+    uint8_t* b_scalar = stored_scalars.data() + bit_index * 32;
     
+    // b*A equals Alice's a*B (c = 0) or a*(B - T) (c = 1)
     uint8_t shared_secret[32];
+    if (!crypto_ops.performECDH(b_scalar, point_A, shared_secret)) {
+        MTA_LOG_ERROR("Invalid point A at index %d", bit_index);
+        return false;
+    }
     const uint8_t* encrypted_message = choice_bit ? encrypted_m1 : encrypted_m0;
     
     uint8_t decrypted_message[32];
@@ -72,6 +130,8 @@ bool CorrelatedOTProtocol::processSingleCOT(
     
     received_value = crypto_ops.bytesToUint32(decrypted_message);
     
+    memzero(shared_secret, sizeof(shared_secret));
+    memzero(decrypted_message, sizeof(decrypted_message));
     return true;
 }
 
@@ -90,18 +150,43 @@ CorrelatedOTProtocol::COTResult CorrelatedOTProtocol::executeCOTMultiplication(
         return result;
     }
     uint32_t accumulated_V = 0;
+    if (!accumulateCOT(y, 0, BIT_LENGTH, points_A.data(), encrypted_m0_messages.data(),
+                       encrypted_m1_messages.data(), accumulated_V)) {
+        return result;
+    }
+    result.additive_share_V = accumulated_V;
+    result.success = true;
+    return result;
+}
+
+bool CorrelatedOTProtocol::accumulateCOT(
+    uint32_t y,
+    int first,
+    int count,
+    const uint8_t* points_A,
+    const uint8_t* encrypted_m0_messages,
+    const uint8_t* encrypted_m1_messages,
+    uint32_t& accumulated_V
+) {
+    if (first < 0 || count < 0 || first + count > BIT_LENGTH || ot_instances.size() != BIT_LENGTH) {
+        return false;
+    }
+    if (y != *choice_bits) {
+        MTA_LOG_ERROR("Choice bits committed in setup do not match y");
+        return false;
+    }
     
     // Process each bit of y according to COT specification
-    for (int i = 0; i < BIT_LENGTH; i++) {
+    for (int i = first; i < first + count; i++) {
         bool y_bit = getBit(y, i);  // yi = ith bit of y
         
-        const uint8_t* point_A = &points_A[i * 65];
-        const uint8_t* encrypted_m0 = &encrypted_m0_messages[i * 32];
-        const uint8_t* encrypted_m1 = &encrypted_m1_messages[i * 32];
+        const uint8_t* point_A = &points_A[(i - first) * 65];
+        const uint8_t* encrypted_m0 = &encrypted_m0_messages[(i - first) * 32];
+        const uint8_t* encrypted_m1 = &encrypted_m1_messages[(i - first) * 32];
         
         uint32_t mc_i;  // this is Ui + yi * x
         if (!processSingleCOT(i, y_bit, point_A, encrypted_m0, encrypted_m1, 32, mc_i)) {
-            return result;
+            return false;
         }
         
         // calculate V = Σ(2^i * mc_i)
@@ -110,9 +195,7 @@ CorrelatedOTProtocol::COTResult CorrelatedOTProtocol::executeCOTMultiplication(
         accumulated_V = (accumulated_V + ((uint64_t)mc_i * (1ULL << i)) % MODULUS) % MODULUS;
 
     }
-    result.additive_share_V = accumulated_V;
-    result.success = true;
-    return result;
+    return true;
 }
 
 std::vector<uint8_t> CorrelatedOTProtocol::serializeCOTSetup(const COTSetup& setup) {
@@ -3,6 +3,7 @@
 
 #include "ot_protocol.h"
 #include "crypto_operations.h"
+#include "secure_arena.h"
 #include <vector>
 #include <cstdint>
 #include <memory>
@@ -14,10 +15,11 @@ class CorrelatedOTProtocol {
 private:
     static const int BIT_LENGTH = 32;
     std::vector<std::unique_ptr<ObliviousTransferProtocol>> ot_instances;
-    std::vector<uint8_t> stored_scalars;
+    SecureBuffer stored_scalars;        // BIT_LENGTH scalars b_i, in the secure arena
     CryptoOperations crypto_ops;
 
     uint32_t correlation_x;
+    SecureValue<uint32_t> choice_bits;  // y, in the secure arena
     
     bool getBit(uint32_t value, int bit_position);
     bool generatePointB(int index, uint8_t* point_B_out);
@@ -43,7 +45,21 @@ public:
         bool success;
     };
     
-    COTSetup initializeCOT(uint32_t alice_x);
+    // Bob is the OT receiver: bit i of choice_bits selects which of Alice's
+    // two messages he can decrypt, via B_i = b_i*G + c_i*T
+    COTSetup initializeCOT(uint32_t alice_x, uint32_t choice_bits);
+    
+    // Zeroes the scalars and choice bits and drops the OT instances, so a
+    // reused protocol object carries nothing over from the last session
+    void reset();
+    
+    // Split form of initializeCOT: draws the BIT_LENGTH scalars, or takes
+    // them from `scalars` (precomputed), and returns them (BIT_LENGTH * 32
+    // bytes) so the points b_i*G can be generated elsewhere;
+    // encodeChoiceBits then turns those into the B_i
+    const uint8_t* prepareCOT(uint32_t alice_x, uint32_t choice_bits, const uint8_t* scalars = nullptr);
+    // Encodes instances [first, first + count) of the BIT_LENGTH points
+    bool encodeChoiceBits(uint8_t* points_B, int first = 0, int count = BIT_LENGTH);
     
     bool processSingleCOT(
         int bit_index,
@@ -55,6 +71,18 @@ public:
         uint32_t& received_value
     );
     
+    // Adds 2^i * mc_i for bits [first, first + count) to accumulated_V;
+    // the arrays hold just those bits' points and messages
+    bool accumulateCOT(
+        uint32_t y,
+        int first,
+        int count,
+        const uint8_t* points_A,
+        const uint8_t* encrypted_m0_messages,
+        const uint8_t* encrypted_m1_messages,
+        uint32_t& accumulated_V
+    );
+    
     COTResult executeCOTMultiplication(
         uint32_t y,
         const std::vector<uint8_t>& points_A,
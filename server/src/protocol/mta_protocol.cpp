@@ -1,17 +1,23 @@
 #include "mta_protocol.h"
 #include "cot_protocol.h"
 #include "crypto_operations.h"
-#include <iostream>
+#include "logger.h"
 #include <cstring>
 #include <algorithm>
 #include "protobuf_handler.h"
 
-MTAProtocol::MTAProtocol() : beta(0) {
+MTAProtocol::MTAProtocol() : bob_scalars(nullptr) {
     cot_protocol = std::make_unique<CorrelatedOTProtocol>();
 }
 
 MTAProtocol::~MTAProtocol() = default;
 
+void MTAProtocol::reset() {
+    cot_protocol->reset();
+    *beta = 0;
+    bob_scalars = nullptr;
+}
+
 uint32_t MTAProtocol::computeFinalShare(uint32_t received_share, uint32_t mask, uint32_t own_share) {
     return received_share + mask * own_share;
 }
@@ -20,15 +26,16 @@ bool MTAProtocol::validateMTAInputs(uint32_t share1, uint32_t share2) {
     return true;
 }
 
-MTAProtocol::BobSetup MTAProtocol::initializeAsBob(uint32_t correlation_delta) {
+MTAProtocol::BobSetup MTAProtocol::initializeAsBob(uint32_t correlation_delta, uint32_t y_share) {
     BobSetup setup;
     setup.success = true;
     setup.correlation_delta = correlation_delta;
     setup.num_ot_instances = 32;
 
-    auto cot_setup = cot_protocol->initializeCOT(correlation_delta);
+    auto cot_setup = cot_protocol->initializeCOT(correlation_delta, y_share);
     if (!cot_setup.success) {
-        std::cerr << "Failed to initialize COT protocol" << std::endl;
+        MTA_LOG_ERROR("Failed to initialize COT protocol");
+        setup.success = false;
         return setup;
     }
     
@@ -36,49 +43,76 @@ MTAProtocol::BobSetup MTAProtocol::initializeAsBob(uint32_t correlation_delta) {
     setup.correlation_delta = correlation_delta;
     setup.success = true;
     
-    std::cout << "Bob initialized COT with correlation delta: " << correlation_delta << std::endl;
+    MTA_LOG_DEBUG("Bob initialized COT with correlation delta: %u", correlation_delta);
+    return setup;
+}
+
+MTAProtocol::BobSetup MTAProtocol::beginBobSetup(uint32_t correlation_delta, uint32_t y_share,
+                                                 const uint8_t* scalars) {
+    BobSetup setup;
+    setup.correlation_delta = correlation_delta;
+    setup.num_ot_instances = 32;
+    
+    bob_scalars = cot_protocol->prepareCOT(correlation_delta, y_share, scalars);
+    setup.points_B.resize(setup.num_ot_instances * 65);
+    setup.success = true;
+    
     return setup;
 }
 
+const uint8_t* MTAProtocol::bobScalars() const {
+    return bob_scalars;
+}
+
+bool MTAProtocol::finishBobSetup(BobSetup& setup) {
+    return finishBobSetupChunk(setup, 0, setup.num_ot_instances);
+}
+
+bool MTAProtocol::finishBobSetupChunk(BobSetup& setup, uint32_t first, uint32_t count) {
+    if (setup.points_B.size() != setup.num_ot_instances * 65 ||
+        !cot_protocol->encodeChoiceBits(setup.points_B.data(), first, count)) {
+        setup.success = false;
+        return false;
+    }
+    return true;
+}
+
 MTAProtocol::BobMessages MTAProtocol::prepareBobMessages(uint32_t y_share) {
     BobMessages messages;
     messages.success = false;
     
     if (!validateMTAInputs(y_share, 0)) {
-        std::cerr << "Invalid MTA inputs" << std::endl;
+        MTA_LOG_ERROR("Invalid MTA inputs");
         return messages;
     }
     
-    beta = crypto_ops.generateRandomUint32();
-    
-    messages.masked_share = y_share * beta;
+    *beta = crypto_ops.generateRandomUint32();
     messages.success = true;
     
-    std::cout << "Bob prepared messages with y_share: " << y_share 
-              << ", beta: " << beta 
-              << ", masked_share: " << messages.masked_share << std::endl;
+    MTA_LOG_TRACE("Bob prepared messages with y_share: %u, beta: %u", y_share, *beta);
     
     return messages;
 }
 
 MTAProtocol::MTAResult MTAProtocol::executeBobMTA(
     uint32_t y_share,
-    const AliceMessages& alice_messages
+    const AliceMessages& alice_messages,
+    BobMessages& bob_messages
 ) {
     MTAResult result;
     result.success = false;
     
     if (!alice_messages.success) {
-        std::cerr << "Alice messages are invalid" << std::endl;
+        MTA_LOG_ERROR("Alice messages are invalid");
         return result;
     }
     
     if (!validateMTAInputs(y_share, alice_messages.masked_share)) {
-        std::cerr << "Invalid MTA inputs for execution" << std::endl;
+        MTA_LOG_ERROR("Invalid MTA inputs for execution");
         return result;
     }
     
-    std::cout << "Executing COT multiplication with y_share: " << y_share << std::endl;
+    MTA_LOG_TRACE("Executing COT multiplication with y_share: %u", y_share);
     auto cot_result = cot_protocol->executeCOTMultiplication(
         y_share, 
         alice_messages.points_A, 
@@ -87,29 +121,87 @@ MTAProtocol::MTAResult MTAProtocol::executeBobMTA(
     );
     
     if (!cot_result.success) {
-        std::cerr << "COT multiplication failed" << std::endl;
+        MTA_LOG_ERROR("COT multiplication failed");
         return result;
     }
     
-    std::cout << "COT result: " << cot_result.additive_share_V << std::endl;
+    MTA_LOG_TRACE("COT result: %u", cot_result.additive_share_V);
     
-    // share_B = beta * x_masked_share + cot_result
-    const uint64_t MODULUS = 0x100000000ULL;
-    uint64_t product = (uint64_t)beta * alice_messages.masked_share;
-    uint64_t additive = (product + cot_result.additive_share_V) % MODULUS;
-    result.additive_share = (uint32_t)additive;
+    return completeBobMTA(alice_messages.masked_share, cot_result.additive_share_V, bob_messages);
+}
 
+bool MTAProtocol::accumulateBobMTA(uint32_t y_share, uint32_t first, const AliceMessages& chunk,
+                                   uint32_t& accumulated_V) {
+    size_t count = chunk.points_A.size() / 65;
+    if (!chunk.success ||
+        chunk.points_A.size() != count * 65 ||
+        chunk.encrypted_m0_messages.size() != count * 32 ||
+        chunk.encrypted_m1_messages.size() != count * 32) {
+        MTA_LOG_ERROR("Alice messages chunk at %u is invalid", first);
+        return false;
+    }
+    
+    return cot_protocol->accumulateCOT(
+        y_share,
+        static_cast<int>(first),
+        static_cast<int>(count),
+        chunk.points_A.data(),
+        chunk.encrypted_m0_messages.data(),
+        chunk.encrypted_m1_messages.data(),
+        accumulated_V
+    );
+}
+
+bool MTAProtocol::accumulateBobRecord(uint32_t y_share, uint32_t index, const uint8_t* record, uint32_t features,
+                                      uint32_t& accumulated_V) {
+    size_t point_size = wirePointSize(features);
+    const uint8_t* point_A = record;
+    uint8_t decompressed[65];
+    if (features & FEATURE_COMPRESSED_POINTS) {
+        if (!crypto_ops.decompressPoints(record, 1, decompressed)) {
+            MTA_LOG_ERROR("Invalid compressed point A at index %u", index);
+            return false;
+        }
+        point_A = decompressed;
+    }
+    
+    return cot_protocol->accumulateCOT(
+        y_share,
+        static_cast<int>(index),
+        1,
+        point_A,
+        record + point_size,
+        record + point_size + 32,
+        accumulated_V
+    );
+}
+
+MTAProtocol::MTAResult MTAProtocol::completeBobMTA(uint32_t masked_share, uint32_t accumulated_V,
+                                                   BobMessages& bob_messages) {
+    MTAResult result;
+    
+    // V - (U + alpha) = x*y - alpha, returned under beta; Bob keeps -beta
+    // (all mod 2^32)
+    bob_messages.masked_share = accumulated_V - masked_share + *beta;
+    result.additive_share = 0u - *beta;
     result.success = true;
     
     return result;
 }
 
 std::vector<uint8_t> MTAProtocol::serializeBobSetup(const BobSetup& setup) {
-    std::cout << "[Bob] First point_B[0]: " << std::hex << (int)setup.points_B[0] << std::endl;
+    MTA_LOG_TRACE("[Bob] First point_B[0]: %02x", setup.points_B[0]);
 
     static MTAProtobufHandler protobuf_handler;
 
-    std::vector<std::vector<uint8_t>> ot_messages = splitIntoByteVectors(setup.points_B, 65);
+    std::vector<std::vector<uint8_t>> ot_messages;
+    if (setup.features & FEATURE_COMPRESSED_POINTS) {
+        std::vector<uint8_t> compressed(setup.points_B.size() / 65 * 33);
+        crypto_ops.compressPoints(setup.points_B.data(), setup.points_B.size() / 65, compressed.data());
+        ot_messages = splitIntoByteVectors(compressed, 33);
+    } else {
+        ot_messages = splitIntoByteVectors(setup.points_B, 65);
+    }
 
     mta_BobSetup proto_setup = protobuf_handler.createBobSetup(
         setup.success,
@@ -117,6 +209,7 @@ std::vector<uint8_t> MTAProtocol::serializeBobSetup(const BobSetup& setup) {
         setup.public_key,
         setup.num_ot_instances
     );
+    proto_setup.features = setup.features;
 
     return protobuf_handler.serializeBobSetup(proto_setup);
 }
@@ -139,16 +232,28 @@ bool MTAProtocol::deserializeBobSetup(const std::vector<uint8_t>& buffer, BobSet
 
     pb_istream_t stream = pb_istream_from_buffer(buffer.data(), buffer.size());
     if (!pb_decode(&stream, mta_BobSetup_fields, &proto_setup)) {
-        std::cerr << "[ERROR] Failed to decode mta_BobSetup: " << PB_GET_ERROR(&stream) << "\n";
+        MTA_LOG_ERROR("Failed to decode mta_BobSetup: %s", PB_GET_ERROR(&stream));
         return false;
     }
 
     setup.success = proto_setup.success;
     setup.num_ot_instances = proto_setup.num_ot_instances;
+    setup.features = proto_setup.features;
 
-    setup.points_B.clear();
+    std::vector<uint8_t> wire_points;
     for (const auto& chunk : protobuf_handler.temp_bytes_arrays_) {
-        setup.points_B.insert(setup.points_B.end(), chunk.begin(), chunk.end());
+        wire_points.insert(wire_points.end(), chunk.begin(), chunk.end());
+    }
+    if (setup.features & FEATURE_COMPRESSED_POINTS) {
+        size_t count = wire_points.size() / 33;
+        setup.points_B.resize(count * 65);
+        if (wire_points.size() != count * 33 ||
+            !crypto_ops.decompressPoints(wire_points.data(), count, setup.points_B.data())) {
+            MTA_LOG_ERROR("Invalid compressed points in mta_BobSetup");
+            return false;
+        }
+    } else {
+        setup.points_B = std::move(wire_points);
     }
 
     setup.public_key.clear();
@@ -161,7 +266,22 @@ bool MTAProtocol::deserializeBobSetup(const std::vector<uint8_t>& buffer, BobSet
     return true;
 }
 
-std::vector<uint8_t> MTAProtocol::serializeAliceMessages(const AliceMessages& messages) {
+void MTAProtocol::writeInterleavedRecords(const AliceMessages& messages, uint32_t features, uint8_t* out) {
+    size_t count = messages.points_A.size() / 65;
+    size_t point_size = wirePointSize(features);
+    for (size_t i = 0; i < count; i++) {
+        if (features & FEATURE_COMPRESSED_POINTS) {
+            CryptoOperations::compressPoints(&messages.points_A[i * 65], 1, out);
+        } else {
+            std::memcpy(out, &messages.points_A[i * 65], 65);
+        }
+        std::memcpy(out + point_size, &messages.encrypted_m0_messages[i * 32], 32);
+        std::memcpy(out + point_size + 32, &messages.encrypted_m1_messages[i * 32], 32);
+        out += point_size + 64;
+    }
+}
+
+std::vector<uint8_t> MTAProtocol::serializeAliceMessages(const AliceMessages& messages, uint32_t features) {
     std::vector<uint8_t> buffer;
     
     buffer.push_back(messages.success ? 1 : 0);
@@ -171,8 +291,20 @@ std::vector<uint8_t> MTAProtocol::serializeAliceMessages(const AliceMessages& me
     buffer.push_back((masked >> 8) & 0xFF);
     buffer.push_back((masked >> 16) & 0xFF);
     buffer.push_back((masked >> 24) & 0xFF);
-    std::cout << "[SERIALIZE] First byte of points_A[0]: " << std::hex << (int)messages.points_A[0] << std::endl;
-    buffer.insert(buffer.end(), messages.points_A.begin(), messages.points_A.end());
+    MTA_LOG_TRACE("[SERIALIZE] First byte of points_A[0]: %02x", messages.points_A[0]);
+    if (features & FEATURE_INTERLEAVED_MESSAGES) {
+        size_t offset = buffer.size();
+        buffer.resize(offset + messages.points_A.size() / 65 * interleavedRecordSize(features));
+        writeInterleavedRecords(messages, features, buffer.data() + offset);
+        return buffer;
+    }
+    if (features & FEATURE_COMPRESSED_POINTS) {
+        size_t offset = buffer.size();
+        buffer.resize(offset + messages.points_A.size() / 65 * 33);
+        crypto_ops.compressPoints(messages.points_A.data(), messages.points_A.size() / 65, buffer.data() + offset);
+    } else {
+        buffer.insert(buffer.end(), messages.points_A.begin(), messages.points_A.end());
+    }
     
     buffer.insert(buffer.end(), messages.encrypted_m0_messages.begin(), messages.encrypted_m0_messages.end());
     
@@ -181,8 +313,12 @@ std::vector<uint8_t> MTAProtocol::serializeAliceMessages(const AliceMessages& me
     return buffer;
 }
 
-bool MTAProtocol::deserializeAliceMessages(const std::vector<uint8_t>& buffer, AliceMessages& messages) {
-    if (buffer.size() < 5) {
+bool MTAProtocol::deserializeAliceMessages(const std::vector<uint8_t>& buffer, AliceMessages& messages,
+                                           uint32_t features, size_t count) {
+    const size_t wire_points_size = count * wirePointSize(features);
+    const size_t messages_size = count * 32;
+    if (buffer.size() < 5 + wire_points_size + 2 * messages_size) {
+        MTA_LOG_ERROR("AliceMessages too short: %zu bytes", buffer.size());
         return false;
     }
     
@@ -196,17 +332,19 @@ bool MTAProtocol::deserializeAliceMessages(const std::vector<uint8_t>& buffer, A
     (buffer[offset + 3] << 24);
     offset += 4;
     
-    std::cout << "[DESERIALIZE] Parsing AliceMessages..." << std::endl;
-
-    std::cout << "  > buffer size: " << buffer.size() << std::endl;
-    const size_t points_size = 32 * 65;
-    const size_t messages_size = 32 * 32;
-    
-    messages.points_A.resize(points_size);
-    std::copy(buffer.begin() + offset, buffer.begin() + offset + points_size, 
-              messages.points_A.begin());
-    offset += points_size;
-    std::cout << "[DESERIALIZE] First byte of points_A[0]: " << std::hex << (int)messages.points_A[0] << std::endl;
+    MTA_LOG_TRACE("[DESERIALIZE] Parsing AliceMessages, buffer size: %zu", buffer.size());
+    messages.points_A.resize(count * 65);
+    if (features & FEATURE_COMPRESSED_POINTS) {
+        if (!crypto_ops.decompressPoints(buffer.data() + offset, count, messages.points_A.data())) {
+            MTA_LOG_ERROR("Invalid compressed points A");
+            return false;
+        }
+    } else {
+        std::copy(buffer.begin() + offset, buffer.begin() + offset + wire_points_size,
+                  messages.points_A.begin());
+    }
+    offset += wire_points_size;
+    MTA_LOG_TRACE("[DESERIALIZE] First byte of points_A[0]: %02x", messages.points_A[0]);
     
     messages.encrypted_m0_messages.resize(messages_size);
     std::copy(buffer.begin() + offset, buffer.begin() + offset + messages_size, 
@@ -229,7 +367,6 @@ std::vector<uint8_t> MTAProtocol::serializeBobMessages(const BobMessages& messag
         messages.success,
         ot_responses,
         encrypted_result,
-        messages.correlation_check,
         messages.masked_share
     );
 
@@ -3,6 +3,7 @@
 
 #include "crypto_operations.h"
 #include "cot_protocol.h"
+#include "secure_arena.h"
 #include <vector>
 #include <cstdint>
 #include <memory>
@@ -17,8 +18,9 @@ private:
     std::unique_ptr<CorrelatedOTProtocol> cot_protocol;
     CryptoOperations crypto_ops;
     
-    // Bob's random mask
-    uint32_t beta;
+    // Bob's random mask, in the secure arena
+    SecureValue<uint32_t> beta;
+    const uint8_t* bob_scalars;
     
     // Helper methods
     uint32_t computeFinalShare(uint32_t received_share, uint32_t mask, uint32_t own_share);
@@ -27,6 +29,34 @@ public:
     MTAProtocol();
     ~MTAProtocol();
     
+    // Wipes Bob's scalars, choice bits and mask before the object serves
+    // another session
+    void reset();
+    
+    // Wire features (see mta.proto): Alice offers them, Bob accepts the
+    // subset he supports
+    static const uint32_t FEATURE_COMPRESSED_POINTS = 1;
+    static const uint32_t FEATURE_STREAMED_SETUP = 2;
+    static const uint32_t FEATURE_INTERLEAVED_MESSAGES = 4;
+    static const uint32_t SUPPORTED_FEATURES =
+        FEATURE_COMPRESSED_POINTS | FEATURE_STREAMED_SETUP | FEATURE_INTERLEAVED_MESSAGES;
+    
+    // Under FEATURE_INTERLEAVED_MESSAGES, AliceMessages carries one record
+    // per instance, point A then m0 then m1, instead of three arrays, so
+    // each instance can be processed as soon as its bytes are in
+    static size_t interleavedRecordSize(uint32_t features) {
+        return wirePointSize(features) + 64;
+    }
+    
+    // OT instances per BobSetup and AliceMessages frame under
+    // FEATURE_STREAMED_SETUP
+    static const uint32_t STREAM_CHUNK = 8;
+    
+    // Bytes per EC point on the wire under `features`
+    static size_t wirePointSize(uint32_t features) {
+        return (features & FEATURE_COMPRESSED_POINTS) ? 33 : 65;
+    }
+    
     // Result structures for Bob (server)
     struct MTAResult {
         uint32_t additive_share;
@@ -42,52 +72,86 @@ public:
         bool success;
         uint32_t num_ot_instances;
         std::vector<uint8_t> public_key;
+        uint32_t features;      // accepted wire features
         
-        BobSetup() : correlation_delta(0), success(false) {}
+        BobSetup() : correlation_delta(0), success(false), features(0) {}
     };
     
     struct AliceMessages {
         std::vector<uint8_t> points_A;
         std::vector<uint8_t> encrypted_m0_messages;
         std::vector<uint8_t> encrypted_m1_messages;
-        uint32_t masked_share;  // x * alpha
+        uint32_t masked_share;  // U + alpha: Alice's pad sum under her mask
         bool success;
         
         AliceMessages() : masked_share(0), success(false) {}
     };
     
     struct BobMessages {
-        uint32_t masked_share;  // y * beta
+        uint32_t masked_share;  // V - Alice's masked share + beta
         bool success;
     
         // Required for Protobuf serialization
         std::vector<uint8_t> ot_responses;
         std::vector<uint8_t> encrypted_result;
-        uint32_t correlation_check;
     
         BobMessages() 
-            : masked_share(0), success(false), correlation_check(0) {}
+            : masked_share(0), success(false) {}
     };    
     
     // Bob's server methods
-    BobSetup initializeAsBob(uint32_t correlation_delta);
+    BobSetup initializeAsBob(uint32_t correlation_delta, uint32_t y_share);
+    // Like initializeAsBob, but leaves points_B for the caller to fill with
+    // b_i*G from bobScalars() (e.g. through ECBatchScheduler), after which
+    // finishBobSetup encodes y's bits into them. With `scalars`
+    // (precomputed, 32 * 32 bytes) no new ones are drawn.
+    BobSetup beginBobSetup(uint32_t correlation_delta, uint32_t y_share, const uint8_t* scalars = nullptr);
+    const uint8_t* bobScalars() const;
+    bool finishBobSetup(BobSetup& setup);
+    // finishBobSetup for instances [first, first + count) only, once their
+    // points are in place
+    bool finishBobSetupChunk(BobSetup& setup, uint32_t first, uint32_t count);
+    // The COT leaves Bob with V = U + x*y, where U = sum(2^i * U_i) is
+    // Alice's pad sum. Alice sends U + alpha; Bob draws beta, keeps -beta
+    // as his share and returns V - (U + alpha) + beta = x*y - alpha + beta,
+    // to which Alice adds alpha for hers, x*y + beta. Neither masked share
+    // reveals anything: each is offset by a uniform mask its receiver lacks.
+    //
+    // prepareBobMessages draws beta; executeBobMTA then fills in the
+    // messages' masked share and returns Bob's share
     BobMessages prepareBobMessages(uint32_t y_share);
     MTAResult executeBobMTA(
         uint32_t y_share,
-        const AliceMessages& alice_messages
+        const AliceMessages& alice_messages,
+        BobMessages& bob_messages
     );
+    // executeBobMTA in steps, for streamed setups: each chunk of Alice's
+    // messages, starting at instance `first`, is folded into accumulated_V,
+    // and completeBobMTA turns the total into Bob's share. Needs
+    // prepareBobMessages first, like executeBobMTA.
+    bool accumulateBobMTA(uint32_t y_share, uint32_t first, const AliceMessages& chunk,
+                          uint32_t& accumulated_V);
+    MTAResult completeBobMTA(uint32_t masked_share, uint32_t accumulated_V, BobMessages& bob_messages);
+    // accumulateBobMTA for the single interleaved record of instance `index`
+    bool accumulateBobRecord(uint32_t y_share, uint32_t index, const uint8_t* record, uint32_t features,
+                             uint32_t& accumulated_V);
     
     std::vector<std::vector<uint8_t>> splitIntoByteVectors(const std::vector<uint8_t>& flat, size_t chunk_size);
 
     // Utility methods
     bool validateMTAInputs(uint32_t share1, uint32_t share2);
     
-    // Serialization methods for TCP communication
+    // Serialization methods for TCP communication. Points are always held
+    // uncompressed (65 bytes); the wire form follows the accepted features.
     std::vector<uint8_t> serializeBobSetup(const BobSetup& setup);
     bool deserializeBobSetup(const std::vector<uint8_t>& buffer, BobSetup& setup);
     
-    std::vector<uint8_t> serializeAliceMessages(const AliceMessages& messages);
-    bool deserializeAliceMessages(const std::vector<uint8_t>& buffer, AliceMessages& messages);
+    // Writes the interleaved records of `messages` to `out`, in wire form
+    static void writeInterleavedRecords(const AliceMessages& messages, uint32_t features, uint8_t* out);
+    std::vector<uint8_t> serializeAliceMessages(const AliceMessages& messages, uint32_t features = 0);
+    // `count` instances: 32, or STREAM_CHUNK for a streamed chunk
+    bool deserializeAliceMessages(const std::vector<uint8_t>& buffer, AliceMessages& messages,
+                                  uint32_t features = 0, size_t count = 32);
     
     std::vector<uint8_t> serializeBobMessages(const BobMessages& messages);
     bool deserializeBobMessages(const std::vector<uint8_t>& buffer, BobMessages& messages);
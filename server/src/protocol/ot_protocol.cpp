@@ -1,5 +1,5 @@
 #include <ot_protocol.h>
-#include <iostream>
+#include "logger.h"
 
 extern "C" {
     #include <trezor-crypto/bignum.h>
@@ -7,8 +7,8 @@ extern "C" {
 
 using namespace std;
 
-ObliviousTransferProtocol::ObliviousTransferProtocol() {
-    rng.generateScalar(stored_b_scalar);
+ObliviousTransferProtocol::ObliviousTransferProtocol() : stored_b_scalar(32) {
+    rng.generateScalar(stored_b_scalar.data());
 }
 
 void ObliviousTransferProtocol::obliviousTransferWithStorage(
@@ -17,7 +17,7 @@ void ObliviousTransferProtocol::obliviousTransferWithStorage(
     uint8_t* point_B_out
 ) {
     if (c != 0 && c != 1) {
-        std::cerr << "Error: Invalid choice bit" << std::endl;
+        MTA_LOG_ERROR("Invalid choice bit");
         return;
     }
     
@@ -31,7 +31,7 @@ void ObliviousTransferProtocol::obliviousTransferWithStorage(
     bn_read_be(b, &b_bn);
     
     if (!ecdsa_read_pubkey(&secp256k1, point_A, &A)) {
-        std::cerr << "Error: Invalid point A" << std::endl;
+        MTA_LOG_ERROR("Invalid point A");
         return;
     }
     
@@ -58,18 +58,18 @@ void ObliviousTransferProtocol::bobReceiveMessage(
     uint8_t* decrypted_message_out
 ) {
     if (c != 0 && c != 1) {
-        std::cerr << "Error: Invalid choice bit" << std::endl;
+        MTA_LOG_ERROR("Invalid choice bit");
         return;
     }
     
     curve_point A;
     if (!ecdsa_read_pubkey(&secp256k1, point_A, &A)) {
-        std::cerr << "Error: Invalid point A from Alice" << std::endl;
+        MTA_LOG_ERROR("Invalid point A from Alice");
         return;
     }
     
     bignum256 b_bn;
-    bn_read_be(stored_b_scalar, &b_bn);
+    bn_read_be(stored_b_scalar.data(), &b_bn);
     
     curve_point bA;
     point_multiply(&secp256k1, &b_bn, &A, &bA);
@@ -94,9 +94,9 @@ void ObliviousTransferProtocol::decryptMessage(
 }
 
 void ObliviousTransferProtocol::storeScalar(const uint8_t* scalar) {
-    memcpy(stored_b_scalar, scalar, 32);
+    memcpy(stored_b_scalar.data(), scalar, 32);
 }
 
 void ObliviousTransferProtocol::getStoredScalar(uint8_t* scalar_out) {
-    memcpy(scalar_out, stored_b_scalar, 32);
+    memcpy(scalar_out, stored_b_scalar.data(), 32);
 }
\ No newline at end of file
@@ -4,6 +4,7 @@
 #include <cstdint>
 #include <array>
 #include "crypto/random_generator.h"
+#include "secure_arena.h"
 #include <boost/asio.hpp>
 #include <memory>
 using namespace std;
@@ -14,7 +15,7 @@ extern "C" {
 }
 
 class ObliviousTransferProtocol {
-    uint8_t stored_b_scalar[32];
+    SecureBuffer stored_b_scalar;       // 32 bytes, in the secure arena
     uint8_t b[32];
     SecureRandom rng;
     
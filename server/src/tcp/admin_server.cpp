@@ -0,0 +1,88 @@
+#include "admin_server.h"
+#include <chrono>
+#include <memory>
+#include "metrics.h"
+#include "logger.h"
+
+static const size_t MAX_REQUEST_HEADER = 8192;
+static const std::chrono::seconds REQUEST_TIMEOUT(5);
+static const std::chrono::milliseconds ACCEPT_BACKOFF(100);
+
+AdminServer::AdminServer(boost::asio::io_context& io_context, const tcp::endpoint& endpoint)
+    : acceptor_(io_context, endpoint),
+      accept_backoff_(io_context) {
+    MTA_LOG_INFO("Admin endpoint on %s:%u (GET /metrics)", acceptor_.local_endpoint().address().to_string().c_str(),
+                 acceptor_.local_endpoint().port());
+    start_accept();
+}
+
+unsigned short AdminServer::port() const {
+    return acceptor_.local_endpoint().port();
+}
+
+void AdminServer::start_accept() {
+    acceptor_.async_accept([this](boost::system::error_code ec, tcp::socket socket) {
+        if (!ec) {
+            boost::asio::co_spawn(acceptor_.get_executor(), serve(std::move(socket)), boost::asio::detached);
+            start_accept();
+            return;
+        }
+        if (ec == boost::asio::error::operation_aborted) {
+            return;
+        }
+        MTA_LOG_WARN("Admin accept error: %s; retrying in %lld ms", ec.message().c_str(),
+                     static_cast<long long>(ACCEPT_BACKOFF.count()));
+        accept_backoff_.expires_after(ACCEPT_BACKOFF);
+        accept_backoff_.async_wait([this](boost::system::error_code timer_ec) {
+            if (!timer_ec) {
+                start_accept();
+            }
+        });
+    });
+}
+
+boost::asio::awaitable<void> AdminServer::serve(tcp::socket socket) {
+    // The deadline's handler shares the socket, so an expiry that is already
+    // queued when serve() returns closes a socket that still exists
+    auto connection = std::make_shared<tcp::socket>(std::move(socket));
+    boost::asio::steady_timer deadline(connection->get_executor(), REQUEST_TIMEOUT);
+    deadline.async_wait([connection](boost::system::error_code timer_ec) {
+        if (!timer_ec) {
+            boost::system::error_code ignored;
+            connection->close(ignored);
+        }
+    });
+
+    boost::system::error_code ec;
+    std::string request;
+    co_await boost::asio::async_read_until(*connection,
+        boost::asio::dynamic_buffer(request, MAX_REQUEST_HEADER), "\r\n\r\n",
+        boost::asio::redirect_error(boost::asio::use_awaitable, ec));
+    if (ec) {
+        co_return;
+    }
+
+    std::string reply = response(request.substr(0, request.find("\r\n")));
+    co_await boost::asio::async_write(*connection, boost::asio::buffer(reply),
+        boost::asio::redirect_error(boost::asio::use_awaitable, ec));
+    connection->shutdown(tcp::socket::shutdown_both, ec);
+}
+
+std::string AdminServer::response(const std::string& request_line) {
+    std::string status = "200 OK";
+    std::string content_type = "text/plain; version=0.0.4; charset=utf-8";
+    std::string body;
+
+    if (request_line.rfind("GET /metrics ", 0) == 0 || request_line.rfind("GET /metrics?", 0) == 0) {
+        body = Metrics::renderPrometheus();
+    } else {
+        status = "404 Not Found";
+        content_type = "text/plain; charset=utf-8";
+        body = "not found\n";
+    }
+
+    return "HTTP/1.1 " + status + "\r\n"
+           "Content-Type: " + content_type + "\r\n"
+           "Content-Length: " + std::to_string(body.size()) + "\r\n"
+           "Connection: close\r\n\r\n" + body;
+}
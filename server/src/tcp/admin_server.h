@@ -0,0 +1,27 @@
+#pragma once
+
+#include <boost/asio.hpp>
+#include <string>
+
+using boost::asio::ip::tcp;
+
+// Minimal HTTP/1.1 listener for operators, separate from the MtA port.
+// GET /metrics returns Metrics::renderPrometheus(); anything else is a 404.
+// Each connection answers one request and is closed; a client that has not
+// sent its request and read the reply within a deadline is dropped.
+class AdminServer {
+public:
+    AdminServer(boost::asio::io_context& io_context, const tcp::endpoint& endpoint);
+
+    unsigned short port() const;
+
+private:
+    void start_accept();
+    static boost::asio::awaitable<void> serve(tcp::socket socket);
+    static std::string response(const std::string& request_line);
+
+    tcp::acceptor acceptor_;
+    // Delays the next accept after an error such as EMFILE, which would
+    // otherwise fail again at once
+    boost::asio::steady_timer accept_backoff_;
+};
@@ -0,0 +1,143 @@
+#include "admission_control.h"
+#include "logger.h"
+#include "metrics.h"
+
+// How long a rejected client gets to read the busy frame before the
+// connection is closed under it
+static const std::chrono::seconds BUSY_LINGER(1);
+
+AdmissionControl::AdmissionControl(boost::asio::io_context& io_context, const Limits& limits,
+                                   std::vector<uint8_t> busy_frame, Start start)
+    : io_context_(io_context),
+      limits_(limits),
+      busy_frame_(std::move(busy_frame)),
+      start_(std::move(start)),
+      active_(0),
+      shedding_(false),
+      crypto_in_flight_(0) {}
+
+bool AdmissionControl::has_capacity() const {
+    return limits_.max_sessions == 0 || active_ < limits_.max_sessions;
+}
+
+void AdmissionControl::admit(std::unique_ptr<SessionTransport> transport, Clock::time_point accepted_at) {
+    if (queue_.empty() && has_capacity()) {
+        active_++;
+        start_(std::move(transport), accepted_at);
+        return;
+    }
+
+    // An empty queue has no queueing delay; this ends a shedding episode
+    if (queue_.empty()) {
+        should_shed(Clock::duration::zero(), accepted_at);
+    }
+    if (shedding_) {
+        Metrics::increment(MetricCounter::SESSIONS_SHED);
+        reject(std::move(transport));
+        return;
+    }
+    if (queue_.size() >= limits_.queue_limit) {
+        Metrics::increment(MetricCounter::SESSIONS_REJECTED);
+        reject(std::move(transport));
+        return;
+    }
+    queue_.push_back({std::move(transport), accepted_at});
+}
+
+void AdmissionControl::finished() {
+    active_--;
+    // Not from inside the finished session's close
+    if (!queue_.empty()) {
+        boost::asio::post(io_context_, [this]() { start_queued(); });
+    }
+}
+
+void AdmissionControl::start_queued() {
+    while (!queue_.empty() && has_capacity()) {
+        Pending pending = std::move(queue_.front());
+        queue_.pop_front();
+
+        Clock::time_point now = Clock::now();
+        if (should_shed(now - pending.accepted_at, now)) {
+            Metrics::increment(MetricCounter::SESSIONS_SHED);
+            reject(std::move(pending.transport));
+            continue;
+        }
+        active_++;
+        start_(std::move(pending.transport), pending.accepted_at);
+    }
+}
+
+bool AdmissionControl::should_shed(Clock::duration queue_delay, Clock::time_point now) {
+    if (limits_.target.count() == 0 || queue_delay < limits_.target) {
+        above_target_since_.reset();
+        if (shedding_) {
+            shedding_ = false;
+            MTA_LOG_INFO("Queueing delay back under %lld us, admitting again",
+                         static_cast<long long>(limits_.target.count()));
+        }
+        return false;
+    }
+    if (!above_target_since_) {
+        above_target_since_ = now;
+        return false;
+    }
+    if (now - *above_target_since_ < limits_.interval) {
+        return false;
+    }
+    if (!shedding_) {
+        shedding_ = true;
+        MTA_LOG_WARN("Queueing delay above %lld us for %lld us, shedding load (%zu queued)",
+                     static_cast<long long>(limits_.target.count()),
+                     static_cast<long long>(limits_.interval.count()), queue_.size());
+    }
+    return true;
+}
+
+bool AdmissionControl::try_acquire_crypto() {
+    if (limits_.max_crypto_jobs != 0 && crypto_in_flight_ >= limits_.max_crypto_jobs) {
+        return false;
+    }
+    crypto_in_flight_++;
+    return true;
+}
+
+void AdmissionControl::release_crypto() {
+    if (crypto_waiters_.empty()) {
+        crypto_in_flight_--;
+        return;
+    }
+    // The slot passes straight to the next waiter
+    boost::asio::post(io_context_,
+        [handler = std::move(crypto_waiters_.front())]() mutable {
+            std::move(handler)();
+        });
+    crypto_waiters_.pop_front();
+}
+
+void AdmissionControl::reject(std::unique_ptr<SessionTransport> transport) {
+    boost::asio::co_spawn(io_context_, send_busy(std::move(transport)), boost::asio::detached);
+}
+
+// Writes the busy frame, then waits for the client to close (or the linger
+// to expire) before closing: closing with the client's request still unread
+// would reset the connection and could discard the frame on the client side
+boost::asio::awaitable<void> AdmissionControl::send_busy(std::unique_ptr<SessionTransport> transport) {
+    boost::system::error_code ec;
+    co_await transport->write(boost::asio::buffer(busy_frame_), ec);
+    if (ec) {
+        co_return;
+    }
+
+    boost::asio::steady_timer linger(io_context_, BUSY_LINGER);
+    linger.async_wait([&transport](boost::system::error_code timer_ec) {
+        if (!timer_ec) {
+            transport->close();
+        }
+    });
+    uint8_t discard[512];
+    while (!ec) {
+        co_await transport->read_some(boost::asio::buffer(discard), ec);
+    }
+    linger.cancel();
+}
@@ -0,0 +1,87 @@
+#pragma once
+
+#include <boost/asio.hpp>
+#include <boost/asio/any_completion_handler.hpp>
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <optional>
+#include <vector>
+#include "session_transport.h"
+
+// Admission control for the sessions of one shard (one IO thread, so no
+// locking). At most `max_sessions` run at once; further connections wait in
+// a bounded FIFO and are started as sessions finish. A connection that
+// cannot be queued, or that CoDel sheds, gets the busy frame (an unsuccessful
+// BobSetup) and is closed, so overload turns into fast rejections instead of
+// every session slowing down together.
+//
+// Shedding follows CoDel: once the queueing delay seen by dequeued
+// connections has stayed above `target` for a whole `interval`, connections
+// over the target are shed at dequeue, and new arrivals are rejected outright
+// while that lasts.
+//
+// Separately, at most `max_crypto_jobs` sessions may have a point batch in
+// flight at once; the others wait for a slot before submitting.
+class AdmissionControl {
+public:
+    using Clock = std::chrono::steady_clock;
+    using Start = std::function<void(std::unique_ptr<SessionTransport>, Clock::time_point accepted_at)>;
+
+    struct Limits {
+        size_t max_sessions = 0;            // 0 = unlimited
+        size_t queue_limit = 1024;
+        size_t max_crypto_jobs = 0;         // 0 = unlimited
+        std::chrono::microseconds target{5000};     // 0 disables shedding
+        std::chrono::microseconds interval{100000};
+    };
+
+    AdmissionControl(boost::asio::io_context& io_context, const Limits& limits,
+                     std::vector<uint8_t> busy_frame, Start start);
+
+    // A connection was accepted; it is started, queued or rejected
+    void admit(std::unique_ptr<SessionTransport> transport, Clock::time_point accepted_at);
+
+    // A started session ended; starts queued connections in its place
+    void finished();
+
+    // Crypto slots: try first, and only wait when that fails
+    bool try_acquire_crypto();
+    void release_crypto();
+
+    template <typename CompletionToken>
+    auto async_acquire_crypto(CompletionToken&& token) {
+        return boost::asio::async_initiate<CompletionToken, void()>(
+            [this](auto handler) {
+                crypto_waiters_.emplace_back(std::move(handler));
+            },
+            token);
+    }
+
+private:
+    struct Pending {
+        std::unique_ptr<SessionTransport> transport;
+        Clock::time_point accepted_at;
+    };
+
+    bool has_capacity() const;
+    void start_queued();
+    bool should_shed(Clock::duration queue_delay, Clock::time_point now);
+    void reject(std::unique_ptr<SessionTransport> transport);
+    boost::asio::awaitable<void> send_busy(std::unique_ptr<SessionTransport> transport);
+
+    boost::asio::io_context& io_context_;
+    Limits limits_;
+    std::vector<uint8_t> busy_frame_;
+    Start start_;
+
+    size_t active_;
+    std::deque<Pending> queue_;
+    std::optional<Clock::time_point> above_target_since_;
+    bool shedding_;
+
+    size_t crypto_in_flight_;
+    std::deque<boost::asio::any_completion_handler<void()>> crypto_waiters_;
+};
@@ -0,0 +1,53 @@
+#include "frame_buffer_pool.h"
+#include <algorithm>
+
+FrameBufferPool::FrameBufferPool(size_t max_buffer_size, size_t max_free_bytes)
+    : free_(class_index(std::max(max_buffer_size, MIN_CLASS_SIZE)) + 1),
+      max_free_bytes_(max_free_bytes) {}
+
+FrameBufferPool::~FrameBufferPool() {
+    for (auto& buffers : free_) {
+        for (uint8_t* data : buffers) {
+            delete[] data;
+        }
+    }
+}
+
+size_t FrameBufferPool::class_index(size_t size) const {
+    size_t index = 0;
+    while ((MIN_CLASS_SIZE << index) < size) {
+        index++;
+    }
+    return index;
+}
+
+FrameBufferPool::Buffer FrameBufferPool::acquire(size_t size) {
+    size_t index = class_index(size);
+    if (index >= free_.size()) {
+        return {new uint8_t[size], size};
+    }
+
+    size_t capacity = MIN_CLASS_SIZE << index;
+    std::vector<uint8_t*>& buffers = free_[index];
+    if (buffers.empty()) {
+        return {new uint8_t[capacity], capacity};
+    }
+    uint8_t* data = buffers.back();
+    buffers.pop_back();
+    return {data, capacity};
+}
+
+void FrameBufferPool::release(Buffer& buffer) {
+    if (!buffer) {
+        return;
+    }
+
+    size_t index = class_index(buffer.capacity);
+    bool exact_class = index < free_.size() && (MIN_CLASS_SIZE << index) == buffer.capacity;
+    if (exact_class && (free_[index].size() + 1) * buffer.capacity <= max_free_bytes_) {
+        free_[index].push_back(buffer.data);
+    } else {
+        delete[] buffer.data;
+    }
+    buffer = Buffer();
+}
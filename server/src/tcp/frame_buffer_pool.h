@@ -0,0 +1,40 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Power-of-two size classes of frame buffers owned by one IO thread, from
+// 1 KB up to the largest frame the server accepts. Sessions borrow a buffer
+// only while a frame is being read or written and hand it back right after,
+// so an idle connection holds none. Each class keeps at most
+// `max_free_bytes` of returned buffers for reuse and frees the rest.
+class FrameBufferPool {
+public:
+    static const size_t MIN_CLASS_SIZE = 1024;
+
+    struct Buffer {
+        uint8_t* data = nullptr;
+        size_t capacity = 0;
+
+        explicit operator bool() const { return data != nullptr; }
+    };
+
+    FrameBufferPool(size_t max_buffer_size, size_t max_free_bytes);
+    ~FrameBufferPool();
+
+    FrameBufferPool(const FrameBufferPool&) = delete;
+    FrameBufferPool& operator=(const FrameBufferPool&) = delete;
+
+    // At least `size` bytes. Sizes above the largest class are served
+    // unpooled and freed on release.
+    Buffer acquire(size_t size);
+    // Resets `buffer`
+    void release(Buffer& buffer);
+
+private:
+    size_t class_index(size_t size) const;
+
+    std::vector<std::vector<uint8_t*>> free_;   // by class
+    size_t max_free_bytes_;
+};
@@ -1,288 +1,1190 @@
 #include "mta_server.h"
 #include "protobuf_handler.h"
-#include <iostream>
-#include <iomanip>
+#include "binary_codec.h"
+#include "shm_transport.h"
+#include "logger.h"
+#include "admin_server.h"
+#include "alloc_tracker.h"
+#include "probes.h"
+#include "span_trace.h"
+#include <algorithm>
+#include <atomic>
+#include <csignal>
 #include <random>
+#include <unistd.h>
 
-MTAServer::MTAServer(boost::asio::io_context& io_context, short port, uint32_t y_share)
+extern "C" {
+    #include <trezor-crypto/memzero.h>
+}
+
+using boost::asio::local::stream_protocol;
+
+// SO_REUSEPORT is not wrapped by Asio
+using reuse_port = boost::asio::detail::socket_option::boolean<SOL_SOCKET, SO_REUSEPORT>;
+
+static const size_t OT_INSTANCES = 32;
+// Precompute store entries a shard claims at once
+static const size_t PRECOMPUTE_CLAIM = 64;
+
+// Sent as Bob's public key in every BobSetup
+static std::vector<uint8_t> dummyPublicKey() {
+    std::vector<uint8_t> public_key(65);
+    for (size_t i = 0; i < public_key.size(); ++i) {
+        public_key[i] = static_cast<uint8_t>(i);
+    }
+    return public_key;
+}
+
+MTAServer::Shard::Shard(boost::asio::io_context& io_context, const tcp::endpoint& endpoint,
+                        bool reuse_port_enabled, const ServerConfig& config, CaptureFile* capture_file)
+    : io_context(io_context),
+      acceptor(io_context),
+      protobuf_handler(std::make_unique<MTAProtobufHandler>()),
+      batch_scheduler(std::make_unique<ECBatchScheduler>(
+          io_context,
+          std::chrono::microseconds(config.batch_window_us),
+          config.batch_max_jobs)),
+      frame_buffers(std::make_unique<RegisteredFrameBuffers>(io_context, config.frame_slots)),
+      buffer_pool(std::make_unique<FrameBufferPool>(4 + config.max_frame_bytes, config.pool_free_bytes)),
+      max_frame_bytes(config.max_frame_bytes),
+      timing_wheel(std::make_unique<TimingWheel>(io_context, std::chrono::milliseconds(config.timer_tick_ms))),
+      idle_timeout(config.idle_timeout_ms),
+      read_timeout(config.read_timeout_ms),
+      write_timeout(config.write_timeout_ms),
+      precompute_store(nullptr),
+      precompute_next(0),
+      precompute_end(0),
+      result_journal(nullptr),
+      session_pool_size(config.session_pool) {
+    if (capture_file != nullptr) {
+        capture = std::make_unique<CaptureBuffer>(*capture_file);
+    }
+    for (uint32_t index = 0; index < 4; index++) {
+        uint32_t features = ((index & 1) ? MTAProtocol::FEATURE_COMPRESSED_POINTS : 0) |
+                            ((index & 2) ? MTAProtocol::FEATURE_INTERLEAVED_MESSAGES : 0);
+        setup_templates[index] = std::make_unique<BobSetupTemplate>(
+            *protobuf_handler, OT_INSTANCES, MTAProtocol::wirePointSize(features), dummyPublicKey(), features);
+    }
+    acceptor.open(endpoint.protocol());
+    acceptor.set_option(tcp::acceptor::reuse_address(true));
+    if (reuse_port_enabled) {
+        acceptor.set_option(reuse_port(true));
+    }
+    acceptor.bind(endpoint);
+    acceptor.listen(config.listen_backlog);
+}
+
+// The reply to a connection turned away by admission control: a BobSetup
+// with success unset and no points
+static std::vector<uint8_t> busyFrame(MTAProtobufHandler& protobuf_handler) {
+    mta_BobSetup busy = mta_BobSetup_init_zero;
+    std::vector<uint8_t> message = protobuf_handler.serializeBobSetup(busy);
+    uint32_t size = static_cast<uint32_t>(message.size());
+    std::vector<uint8_t> frame = {
+        static_cast<uint8_t>(size & 0xFF), static_cast<uint8_t>((size >> 8) & 0xFF),
+        static_cast<uint8_t>((size >> 16) & 0xFF), static_cast<uint8_t>((size >> 24) & 0xFF),
+    };
+    frame.insert(frame.end(), message.begin(), message.end());
+    return frame;
+}
+
+// A stale socket file from a previous run would make bind() fail
+static std::unique_ptr<stream_protocol::acceptor> openLocalAcceptor(
+    boost::asio::io_context& io_context, const std::string& path, int backlog) {
+    ::unlink(path.c_str());
+    auto acceptor = std::make_unique<stream_protocol::acceptor>(io_context);
+    stream_protocol::endpoint endpoint(path);
+    acceptor->open(endpoint.protocol());
+    acceptor->bind(endpoint);
+    acceptor->listen(backlog);
+    return acceptor;
+}
+
+MTAServer::MTAServer(boost::asio::io_context& io_context, short port, uint32_t y_share,
+                     const ServerConfig& config)
     : io_context_(io_context),
-      acceptor_(io_context, tcp::endpoint(tcp::v4(), port)),
-      mta_protocol_(std::make_unique<MTAProtocol>()),
-      protobuf_handler_(std::make_unique<MTAProtobufHandler>()),
+      unix_path_(config.unix_path),
+      shm_path_(config.shm_path),
+      shm_ring_bytes_(config.shm_ring_bytes),
+      next_local_shard_(0),
       bob_y_share_(y_share) {
     
-    if (bob_y_share_ == 0) {
+    if (*bob_y_share_ == 0) {
         std::random_device rd;
         std::mt19937 gen(rd());
         std::uniform_int_distribution<uint32_t> dis(1, 1000000);
-        bob_y_share_ = dis(gen);
+        *bob_y_share_ = dis(gen);
+    }
+
+    if (!config.capture_path.empty()) {
+        capture_file_ = CaptureFile::create(config.capture_path);
+    }
+    if (!config.precompute_path.empty()) {
+        uint8_t key[PrecomputeStore::KEY_SIZE];
+        if (!PrecomputeStore::parseKey(config.precompute_key, key)) {
+            MTA_LOG_ERROR("MTA_PRECOMPUTE_KEY must be 64 hex digits; precompute store not opened");
+        } else {
+            precompute_store_ = PrecomputeStore::open(config.precompute_path, key, false);
+        }
+        memzero(key, sizeof(key));
+    }
+    if (!config.result_journal_path.empty()) {
+        result_journal_ = ResultJournal::open(config.result_journal_path, config.result_journal_records,
+                                              std::chrono::milliseconds(config.result_journal_commit_ms));
+    }
+
+    size_t shard_count = std::max<size_t>(config.acceptor_shards, 1);
+    bool reuse_port_enabled = config.reuse_port || shard_count > 1;
+
+    // Shard 0 runs on the caller's io_context; the others get their own
+    // context and thread. All bind the port shard 0 ended up on.
+    shards_.push_back(std::make_unique<Shard>(io_context_, tcp::endpoint(tcp::v4(), port),
+                                              reuse_port_enabled, config, capture_file_.get()));
+    tcp::endpoint bound = shards_[0]->acceptor.local_endpoint();
+    for (size_t i = 1; i < shard_count; i++) {
+        worker_contexts_.push_back(std::make_unique<boost::asio::io_context>(1));
+        worker_guards_.push_back(boost::asio::make_work_guard(*worker_contexts_.back()));
+        shards_.push_back(std::make_unique<Shard>(*worker_contexts_.back(), bound,
+                                                  reuse_port_enabled, config, capture_file_.get()));
+    }
+    AdmissionControl::Limits limits;
+    limits.max_sessions = config.max_sessions;
+    limits.queue_limit = config.accept_queue;
+    limits.max_crypto_jobs = config.max_crypto_jobs;
+    limits.target = std::chrono::microseconds(config.shed_target_us);
+    limits.interval = std::chrono::microseconds(config.shed_interval_us);
+    std::vector<uint8_t> busy_frame = busyFrame(*shards_[0]->protobuf_handler);
+    for (auto& shard : shards_) {
+        Shard* owner = shard.get();
+        shard->precompute_store = precompute_store_.get();
+        shard->result_journal = result_journal_.get();
+        shard->admission = std::make_unique<AdmissionControl>(shard->io_context, limits, busy_frame,
+            [this, owner](std::unique_ptr<SessionTransport> transport, PhaseTimer::Clock::time_point accepted_at) {
+                Session::start(*owner, *bob_y_share_, std::move(transport), accepted_at);
+            });
+        for (size_t i = 0; i < shard->session_pool_size; i++) {
+            shard->idle_sessions.push_back(std::make_unique<Session>(*shard, *bob_y_share_));
+        }
+    }
+    if (!unix_path_.empty()) {
+        unix_acceptor_ = openLocalAcceptor(io_context_, unix_path_, config.listen_backlog);
+    }
+    if (!shm_path_.empty()) {
+        shm_acceptor_ = openLocalAcceptor(io_context_, shm_path_, config.listen_backlog);
     }
     
-    std::cout << "Server starting on port " << port << std::endl;
-    std::cout << "Bob's multiplicative share (y): " << bob_y_share_ << std::endl;
+    MTA_LOG_INFO("Server starting on port %u", bound.port());
+    if (unix_acceptor_) {
+        MTA_LOG_INFO("Unix socket listener: %s", unix_path_.c_str());
+    }
+    if (shm_acceptor_) {
+        MTA_LOG_INFO("Shared-memory ring rendezvous: %s (%zu byte rings)", shm_path_.c_str(), shm_ring_bytes_);
+    }
+    if (capture_file_) {
+        MTA_LOG_INFO("Capturing session traffic to %s", config.capture_path.c_str());
+    }
+    if (precompute_store_) {
+        MTA_LOG_INFO("Precompute store %s: %llu setups available", config.precompute_path.c_str(),
+                     static_cast<unsigned long long>(precompute_store_->remaining()));
+    }
+    if (result_journal_) {
+        MTA_LOG_INFO("Result journal %s: %llu records, committed every %u ms", config.result_journal_path.c_str(),
+                     static_cast<unsigned long long>(result_journal_->capacity()), config.result_journal_commit_ms);
+    }
+    MTA_LOG_INFO("Bob's multiplicative share (y): %u", *bob_y_share_);
+    MTA_LOG_INFO("Secure arena: %zu bytes mapped, %zu locked", SecureArena::mappedBytes(),
+                 SecureArena::lockedBytes());
+    MTA_LOG_INFO("Acceptor shards: %zu x %zu outstanding accepts%s", shard_count, config.accepts_per_shard,
+                 reuse_port_enabled ? " (SO_REUSEPORT)" : "");
+    MTA_LOG_INFO("EC batch window: %u us, max %zu jobs", config.batch_window_us, config.batch_max_jobs);
+    MTA_LOG_INFO("Admission per shard: %zu sessions, %zu queued, %zu crypto jobs (0 = unlimited), "
+                 "shed above %u us for %u us", config.max_sessions, config.accept_queue,
+                 config.max_crypto_jobs, config.shed_target_us, config.shed_interval_us);
+#if defined(BOOST_ASIO_HAS_IO_URING)
+    MTA_LOG_INFO("I/O backend: io_uring (%zu frame slots, %s)", config.frame_slots,
+                 shards_[0]->frame_buffers->registered() ? "registered" : "unregistered");
+#else
+    MTA_LOG_INFO("I/O backend: reactor (%zu frame slots)", config.frame_slots);
+#endif
     
-    start_accept();
+    for (auto& shard : shards_) {
+        for (size_t i = 0; i < std::max<size_t>(config.accepts_per_shard, 1); i++) {
+            start_accept(*shard);
+        }
+    }
+    if (unix_acceptor_) {
+        start_unix_accept();
+    }
+    if (shm_acceptor_) {
+        start_shm_accept();
+    }
+    if (config.admin_port >= 0) {
+        boost::system::error_code address_ec;
+        auto admin_address = boost::asio::ip::make_address(config.admin_address, address_ec);
+        if (address_ec) {
+            MTA_LOG_ERROR("Invalid MTA_ADMIN_ADDRESS=%s; admin endpoint not started", config.admin_address.c_str());
+        } else {
+            admin_server_ = std::make_unique<AdminServer>(io_context_,
+                tcp::endpoint(admin_address, static_cast<unsigned short>(config.admin_port)));
+        }
+    }
+    if (!config.trace_path.empty() && config.trace_sample > 0) {
+        trace_path_ = config.trace_path;
+        SpanTrace::enable(config.trace_sample);
+        trace_signals_ = std::make_unique<boost::asio::signal_set>(io_context_, SIGUSR2);
+        start_trace_signal();
+        MTA_LOG_INFO("Span tracing 1 in %u sessions; kill -USR2 %d writes %s",
+                     config.trace_sample, static_cast<int>(::getpid()), trace_path_.c_str());
+    }
+
+    for (auto& context : worker_contexts_) {
+        boost::asio::io_context* worker = context.get();
+        worker_threads_.emplace_back([worker]() { worker->run(); });
+    }
 }
 
-void MTAServer::start_accept() {
-    auto new_session = std::make_shared<Session>(io_context_, *mta_protocol_, *protobuf_handler_, bob_y_share_);
-    acceptor_.async_accept(new_session->socket(),
-        [this, new_session](boost::system::error_code ec) {
+MTAServer::~MTAServer() {
+    for (auto& context : worker_contexts_) {
+        context->stop();
+    }
+    for (auto& thread : worker_threads_) {
+        thread.join();
+    }
+    if (unix_acceptor_) {
+        ::unlink(unix_path_.c_str());
+    }
+    if (shm_acceptor_) {
+        ::unlink(shm_path_.c_str());
+    }
+}
+
+void MTAServer::start_trace_signal() {
+    trace_signals_->async_wait([this](boost::system::error_code ec, int) {
+        if (ec) {
+            return;
+        }
+        SpanTrace::writeChromeTrace(trace_path_);
+        start_trace_signal();
+    });
+}
+
+unsigned short MTAServer::port() const {
+    return shards_[0]->acceptor.local_endpoint().port();
+}
+
+unsigned short MTAServer::admin_port() const {
+    return admin_server_ ? admin_server_->port() : 0;
+}
+
+void MTAServer::start_accept(Shard& shard) {
+    shard.acceptor.async_accept(
+        [this, &shard](boost::system::error_code ec, tcp::socket socket) {
+            MTA_ALLOC_PHASE(MetricPhase::ACCEPT);
             if (!ec) {
-                std::cout << "New client (Alice) connected" << std::endl;
-                new_session->start();
+                MTA_LOG_DEBUG("New client (Alice) connected");
+                start_session(shard, std::make_unique<TcpTransport>(std::move(socket)), PhaseTimer::Clock::now());
             } else {
-                std::cerr << "Accept error: " << ec.message() << std::endl;
+                MTA_LOG_ERROR("Accept error: %s", ec.message().c_str());
             }
-            start_accept();
+            start_accept(shard);
         });
 }
 
-MTAServer::Session::Session(boost::asio::io_context& io_context, 
-                           MTAProtocol& mta_protocol, 
-                           MTAProtobufHandler& protobuf_handler,
-                           uint32_t y_share)
-    : socket_(io_context), 
-      mta_protocol_(mta_protocol), 
-      protobuf_handler_(protobuf_handler),
+MTAServer::Shard& MTAServer::next_local_shard() {
+    Shard& shard = *shards_[next_local_shard_];
+    next_local_shard_ = (next_local_shard_ + 1) % shards_.size();
+    return shard;
+}
+
+// Local connections are accepted on the first shard; the descriptor is
+// re-wrapped on the io_context of the shard that will run the session.
+void MTAServer::start_unix_accept() {
+    unix_acceptor_->async_accept(
+        [this](boost::system::error_code ec, stream_protocol::socket socket) {
+            if (!ec) {
+                MTA_LOG_DEBUG("New local client (Alice) connected");
+                auto accepted_at = PhaseTimer::Clock::now();
+                Shard& shard = next_local_shard();
+                int fd = socket.release();
+                boost::asio::post(shard.io_context, [this, &shard, fd, accepted_at]() {
+                    MTA_ALLOC_PHASE(MetricPhase::ACCEPT);
+                    stream_protocol::socket peer(shard.io_context, stream_protocol(), fd);
+                    start_session(shard, std::make_unique<UnixTransport>(std::move(peer)), accepted_at);
+                });
+            } else {
+                MTA_LOG_ERROR("Unix accept error: %s", ec.message().c_str());
+            }
+            start_unix_accept();
+        });
+}
+
+void MTAServer::start_shm_accept() {
+    shm_acceptor_->async_accept(
+        [this](boost::system::error_code ec, stream_protocol::socket socket) {
+            if (!ec) {
+                MTA_LOG_DEBUG("New shared-memory client (Alice) connected");
+                auto accepted_at = PhaseTimer::Clock::now();
+                Shard& shard = next_local_shard();
+                int fd = socket.release();
+                boost::asio::post(shard.io_context, [this, &shard, fd, accepted_at]() {
+                    MTA_ALLOC_PHASE(MetricPhase::ACCEPT);
+                    stream_protocol::socket control(shard.io_context, stream_protocol(), fd);
+                    auto transport = ShmTransport::accept(std::move(control), shm_ring_bytes_);
+                    if (!transport) {
+                        MTA_LOG_ERROR("Shared-memory rendezvous failed");
+                        return;
+                    }
+                    start_session(shard, std::move(transport), accepted_at);
+                });
+            } else {
+                MTA_LOG_ERROR("Shared-memory accept error: %s", ec.message().c_str());
+            }
+            start_shm_accept();
+        });
+}
+
+void MTAServer::start_session(Shard& shard, std::unique_ptr<SessionTransport> transport,
+                              PhaseTimer::Clock::time_point accepted_at) {
+    shard.admission->admit(std::move(transport), accepted_at);
+}
+
+// Only used to correlate log lines of one session
+static std::atomic<uint32_t> next_session_id{1};
+
+MTAServer::Session::Session(Shard& shard, uint32_t y_share)
+    : shard_(shard),
+      references_(0),
+      id_(0),
+      phase_(MetricPhase::ACCEPT),
+      traced_(false),
+      capture_(shard.capture.get()),
+      protobuf_handler_(*shard.protobuf_handler),
+      batch_scheduler_(*shard.batch_scheduler),
+      admission_(*shard.admission),
+      timing_wheel_(*shard.timing_wheel),
+      idle_timeout_(shard.idle_timeout),
+      read_timeout_(shard.read_timeout),
+      write_timeout_(shard.write_timeout),
       bob_y_share_(y_share),
       state_(ProtocolState::WAITING_FOR_CORRELATION_DELTA),
       correlation_delta_(0),
+      wire_features_(0),
+      binary_codec_(false),
+      precomputed_points_(false),
       bob_additive_share_(0),
-      bob_correlation_check_(0) {
-    read_buffer_.resize(8192);
+      bob_correlation_check_(0),
+      alice_records_{},
+      frame_buffers_(*shard.frame_buffers),
+      has_slot_(false),
+      using_slot_(false),
+      buffer_pool_(*shard.buffer_pool),
+      max_frame_bytes_(shard.max_frame_bytes),
+      read_filled_(0),
+      frame_ready_(false),
+      last_message_size_(0) {}
+
+void MTAServer::Session::start(Shard& shard, uint32_t y_share, std::unique_ptr<SessionTransport> transport,
+                               PhaseTimer::Clock::time_point accepted_at) {
+    Session* session;
+    if (shard.idle_sessions.empty()) {
+        session = new Session(shard, y_share);
+    } else {
+        session = shard.idle_sessions.back().release();
+        shard.idle_sessions.pop_back();
+    }
+
+    session->open(std::move(transport), accepted_at);
+    boost::asio::co_spawn(session->transport_->get_executor(),
+                          session->run(boost::intrusive_ptr<Session>(session)), boost::asio::detached);
 }
 
-tcp::socket& MTAServer::Session::socket() {
-    return socket_;
+void MTAServer::Session::open(std::unique_ptr<SessionTransport> transport,
+                              PhaseTimer::Clock::time_point accepted_at) {
+    id_ = next_session_id.fetch_add(1, std::memory_order_relaxed);
+    accepted_at_ = accepted_at;
+    phase_ = MetricPhase::ACCEPT;
+    traced_ = SpanTrace::sample();
+    transport_ = std::move(transport);
+    state_ = ProtocolState::WAITING_FOR_CORRELATION_DELTA;
+    correlation_delta_ = 0;
+    wire_features_ = 0;
+    binary_codec_ = false;
+    bob_additive_share_ = 0;
+    bob_correlation_check_ = 0;
+    read_filled_ = 0;
+    frame_ready_ = false;
+    last_message_size_ = 0;
 }
 
-void MTAServer::Session::start() {
-    std::cout << "Session started, waiting for correlation delta from Alice..." << std::endl;
-    read_message_with_size();
+void MTAServer::Session::close() {
+    timing_wheel_.cancel(deadline_);
+    return_frame_buffer();
+    buffer_pool_.release(write_buffer_);
+    transport_.reset();
+    bob_setup_ = MTAProtocol::BobSetup();
+    bob_messages_ = MTAProtocol::BobMessages();
+
+    // A pooled session must not carry this one's secrets into the next
+    mta_protocol_.reset();
+    *bob_y_share_ = 0;
+    bob_additive_share_ = 0;
+    bob_correlation_check_ = 0;
+
+    // `this` may be deleted by now
+    AdmissionControl& admission = admission_;
+    if (shard_.idle_sessions.size() < shard_.session_pool_size) {
+        shard_.idle_sessions.emplace_back(this);
+    } else {
+        delete this;
+    }
+    admission.finished();
 }
 
-void MTAServer::Session::read_message_with_size() {
-    auto self(shared_from_this());
+boost::asio::awaitable<void> MTAServer::Session::run(boost::intrusive_ptr<Session> self) {
+    Metrics::increment(MetricCounter::SESSIONS_STARTED);
+    MTA_PROBE1(session__start, id_);
+    PhaseTimer phases(accepted_at_);
+    end_phase(phases, MetricPhase::ACCEPT);
+
+    bool completed = co_await exchange(phases);
+    MTA_ALLOC_CLEAR();
+    if (!completed) {
+        Metrics::increment(MetricCounter::SESSIONS_FAILED);
+        MTA_PROBE3(session__end, id_, 0, 0);
+        if (traced_) {
+            SpanTrace::record("session_failed", "session", accepted_at_, SpanTrace::Clock::now(), "session", id_);
+        }
+        co_return;
+    }
+
+    Metrics::increment(MetricCounter::SESSIONS_COMPLETED);
+    PhaseTimer session_timer(accepted_at_);
+    uint64_t session_ns = session_timer.mark(MetricPhase::SESSION);
+    MTA_PROBE3(session__end, id_, 1, session_ns);
+    if (traced_) {
+        SpanTrace::record("session", "session", accepted_at_, session_timer.last(), "session", id_);
+    }
+    MTA_LOG_DEBUG("session=%u complete y=%u additive_share=%u correlation_check=%u",
+                  id_, *bob_y_share_, bob_additive_share_, bob_correlation_check_);
+    ResultJournal* journal = shard_.result_journal;
+    if (journal != nullptr && !journal->append(id_, bob_additive_share_, bob_correlation_check_)) {
+        Metrics::increment(MetricCounter::RESULTS_NOT_JOURNALED);
+        MTA_LOG_ERROR("session=%u result not journaled: journal full of unconsumed records", id_);
+    }
+}
 
-    boost::asio::async_read(socket_,
-        boost::asio::buffer(read_buffer_, 4),
-        [this, self](boost::system::error_code ec, std::size_t length) {
-            if (!ec && length == 4) {
-                uint32_t message_size = read_buffer_[0] |
-                                       (read_buffer_[1] << 8) |
-                                       (read_buffer_[2] << 16) |
-                                       (read_buffer_[3] << 24);
+void MTAServer::Session::enter_phase(MetricPhase phase) {
+    phase_ = phase;
+    MTA_ALLOC_PHASE(phase);
+}
 
-                std::cout << "Incoming message size: " << message_size << " bytes" << std::endl;
+void MTAServer::Session::resume_phase() const {
+    MTA_ALLOC_PHASE(phase_);
+}
 
-                last_message_size_ = message_size;
+void MTAServer::Session::end_phase(PhaseTimer& phases, MetricPhase phase) {
+    uint64_t nanoseconds = phases.mark(phase);
+    MTA_PROBE3(phase, id_, static_cast<int>(phase), nanoseconds);
+    if (traced_) {
+        SpanTrace::record(Metrics::phaseName(phase), "phase", phases.last() - std::chrono::nanoseconds(nanoseconds),
+                          phases.last(), "session", id_);
+    }
+}
 
-                if (message_size > read_buffer_.size()) {
-                    read_buffer_.resize(message_size);
-                }
+void MTAServer::Session::on_deadline(void* context) {
+    Session* session = static_cast<Session*>(context);
+    MTA_LOG_WARN("session=%u deadline passed in %s, closing", session->id_, Metrics::phaseName(session->phase_));
+    Metrics::increment(MetricCounter::SESSIONS_TIMED_OUT);
+    session->transport_->close();
+}
 
-                boost::asio::async_read(socket_,
-                    boost::asio::buffer(read_buffer_, message_size),
-                    [this, self, message_size](boost::system::error_code ec2, std::size_t length2) {
-                        if (!ec2 && length2 == message_size) {
-                            process_received_message();
-                        } else {
-                            std::cerr << "Error reading message content: " << ec2.message() << std::endl;
-                        }
-                    });
-            } else {
-                std::cerr << "Error reading message size: " << ec.message() << std::endl;
+void MTAServer::Session::set_state(ProtocolState state) {
+    state_ = state;
+    MTA_PROBE2(state, id_, static_cast<int>(state));
+}
+
+boost::asio::awaitable<bool> MTAServer::Session::exchange(PhaseTimer& phases) {
+    MTA_LOG_DEBUG("session=%u started, waiting for correlation delta from Alice", id_);
+    enter_phase(MetricPhase::READ_DELTA);
+
+    if (!co_await read_message_with_size(idle_timeout_)) {
+        co_return false;
+    }
+    end_phase(phases, MetricPhase::READ_DELTA);
+    enter_phase(MetricPhase::INITIALIZE_BOB);
+
+    if (!co_await process_correlation_delta(take_message())) {
+        co_return false;
+    }
+    end_phase(phases, MetricPhase::INITIALIZE_BOB);
+
+    if (wire_features_ & MTAProtocol::FEATURE_STREAMED_SETUP) {
+        if (!co_await exchange_streamed(phases)) {
+            co_return false;
+        }
+    } else {
+        enter_phase(MetricPhase::SERIALIZE_SETUP);
+
+        set_state(ProtocolState::SENDING_BOB_SETUP);
+        size_t setup_frame_size = encode_bob_setup();
+        if (setup_frame_size == 0) {
+            co_return false;
+        }
+        end_phase(phases, MetricPhase::SERIALIZE_SETUP);
+        enter_phase(MetricPhase::WAIT_FOR_ALICE);
+
+        if (!co_await write_frame(setup_frame_size)) {
+            co_return false;
+        }
+
+        set_state(ProtocolState::WAITING_FOR_ALICE_MESSAGES);
+        MTA_LOG_DEBUG("session=%u waiting for Alice's messages", id_);
+        if (wire_features_ & MTAProtocol::FEATURE_INTERLEAVED_MESSAGES) {
+            // Decrypted while they arrive, so WAIT_FOR_ALICE holds the COT work
+            uint32_t accumulated_V = 0;
+            uint32_t masked_share = 0;
+            if (!co_await receive_alice_chunk(0, bob_setup_.num_ot_instances, accumulated_V, masked_share)) {
+                co_return false;
             }
-        });
+            end_phase(phases, MetricPhase::WAIT_FOR_ALICE);
+            enter_phase(MetricPhase::EXECUTE_MTA);
+
+            if (!complete_mta(masked_share, accumulated_V)) {
+                co_return false;
+            }
+        } else {
+            if (!co_await read_message_with_size(read_timeout_)) {
+                co_return false;
+            }
+            end_phase(phases, MetricPhase::WAIT_FOR_ALICE);
+            enter_phase(MetricPhase::EXECUTE_MTA);
+
+            if (!process_alice_messages(take_message())) {
+                co_return false;
+            }
+        }
+        end_phase(phases, MetricPhase::EXECUTE_MTA);
+    }
+    enter_phase(MetricPhase::WRITE_RESULT);
+
+    set_state(ProtocolState::SENDING_BOB_MESSAGES);
+    if (!co_await send_bob_messages()) {
+        co_return false;
+    }
+    end_phase(phases, MetricPhase::WRITE_RESULT);
+
+    set_state(ProtocolState::PROTOCOL_COMPLETE);
+    co_return true;
 }
 
-void MTAServer::Session::process_received_message() {
-    std::cout << "[DEBUG] Current state: " << static_cast<int>(state_) << std::endl;
-    std::cout << "[DEBUG] Processing message of size: " << last_message_size_ << " bytes\n";
+// Bob's setup goes out STREAM_CHUNK instances at a time, each chunk sent as
+// soon as its points are generated, and Alice's messages come back in the
+// same chunks, each folded into Bob's share as it arrives. Alice works on
+// one chunk while Bob generates or decrypts another. SERIALIZE_SETUP then
+// covers generating and sending all chunks, WAIT_FOR_ALICE reading and
+// decrypting Alice's, and EXECUTE_MTA only the final combination.
+boost::asio::awaitable<bool> MTAServer::Session::exchange_streamed(PhaseTimer& phases) {
+    enter_phase(MetricPhase::SERIALIZE_SETUP);
+    set_state(ProtocolState::SENDING_BOB_SETUP);
+    const uint32_t instances = bob_setup_.num_ot_instances;
+    const uint32_t chunk = MTAProtocol::STREAM_CHUNK;
 
-    switch (state_) {
-        case ProtocolState::WAITING_FOR_CORRELATION_DELTA:
-            process_correlation_delta(std::vector<uint8_t>(
-                read_buffer_.begin(),
-                read_buffer_.begin() + last_message_size_));
-            break;
+    MTA_PROBE1(cot__setup__start, id_);
+    for (uint32_t first = 0; first < instances; first += chunk) {
+        uint32_t count = std::min(chunk, instances - first);
+        if (!co_await generate_bob_points(first, count)) {
+            MTA_PROBE2(cot__setup__done, id_, 0);
+            MTA_LOG_ERROR("session=%u failed to initialize Bob setup chunk at %u", id_, first);
+            co_return false;
+        }
 
-        case ProtocolState::WAITING_FOR_ALICE_MESSAGES:
-            process_alice_messages(std::vector<uint8_t>(
-                read_buffer_.begin(),
-                read_buffer_.begin() + last_message_size_));
-            break;
+        MTAProtocol::BobSetup setup_chunk;
+        setup_chunk.success = true;
+        setup_chunk.num_ot_instances = count;
+        setup_chunk.features = wire_features_;
+        setup_chunk.points_B.assign(bob_setup_.points_B.begin() + first * 65,
+                                    bob_setup_.points_B.begin() + (first + count) * 65);
+        if (first == 0) {
+            setup_chunk.public_key = bob_setup_.public_key;
+        }
+        std::vector<uint8_t> serialized_chunk = serialize_bob_setup(setup_chunk);
+        if (serialized_chunk.empty() || !co_await send_message_with_size(serialized_chunk)) {
+            co_return false;
+        }
+    }
+    MTA_PROBE2(cot__setup__done, id_, 1);
+    end_phase(phases, MetricPhase::SERIALIZE_SETUP);
+    enter_phase(MetricPhase::WAIT_FOR_ALICE);
+
+    set_state(ProtocolState::WAITING_FOR_ALICE_MESSAGES);
+    MTA_LOG_DEBUG("session=%u waiting for Alice's messages in chunks of %u", id_, chunk);
+    uint32_t accumulated_V = 0;
+    uint32_t masked_share = 0;
+    for (uint32_t first = 0; first < instances; first += chunk) {
+        uint32_t count = std::min(chunk, instances - first);
+        if (!co_await receive_alice_chunk(first, count, accumulated_V, masked_share)) {
+            co_return false;
+        }
+    }
+    end_phase(phases, MetricPhase::WAIT_FOR_ALICE);
+    enter_phase(MetricPhase::EXECUTE_MTA);
+
+    if (!complete_mta(masked_share, accumulated_V)) {
+        co_return false;
+    }
+    end_phase(phases, MetricPhase::EXECUTE_MTA);
+    co_return true;
+}
+
+boost::asio::awaitable<bool> MTAServer::Session::receive_alice_chunk(uint32_t first, uint32_t count,
+                                                                     uint32_t& accumulated_V,
+                                                                     uint32_t& masked_share) {
+    if (!(wire_features_ & MTAProtocol::FEATURE_INTERLEAVED_MESSAGES)) {
+        co_return co_await read_message_with_size(read_timeout_) &&
+                  process_alice_chunk(take_message(), first, count, accumulated_V, masked_share);
+    }
 
-        default:
-            std::cerr << "Unexpected message received in state: " << static_cast<int>(state_) << std::endl;
+    alice_records_ = AliceRecords{first, count, 0, accumulated_V, 0};
+    if (!co_await read_message_with_size(read_timeout_, &Session::consume_alice_records)) {
+        co_return false;
+    }
+    consume_frame();
+    accumulated_V = alice_records_.accumulated_V;
+    masked_share = alice_records_.masked_share;
+    co_return true;
+}
+
+// Header (binary: version, success, masked_share; otherwise success,
+// masked_share), then one record per instance. Each record is decrypted as
+// soon as it is complete, so the ECDH work overlaps with the rest of the
+// frame still arriving.
+bool MTAServer::Session::consume_alice_records(const uint8_t* payload, size_t available) {
+    size_t header_size = binary_codec_ ? 6 : 5;
+    size_t record_size = MTAProtocol::interleavedRecordSize(wire_features_);
+    if (last_message_size_ != header_size + alice_records_.count * record_size) {
+        MTA_LOG_ERROR("session=%u interleaved Alice messages of %u bytes, expected %zu", id_,
+                      last_message_size_, header_size + alice_records_.count * record_size);
+        return false;
+    }
+    if (available < header_size) {
+        return true;
+    }
+    if (alice_records_.done == 0) {
+        const uint8_t* header = payload;
+        if (binary_codec_) {
+            if (header[0] != BinaryCodec::VERSION) {
+                MTA_LOG_ERROR("session=%u Alice messages not in the session's codec", id_);
+                return false;
+            }
+            header++;
+        }
+        if (header[0] != 1) {
+            MTA_LOG_ERROR("session=%u Alice messages report failure", id_);
+            return false;
+        }
+        alice_records_.masked_share = header[1] | (header[2] << 8) | (header[3] << 16) |
+                                      (static_cast<uint32_t>(header[4]) << 24);
+    }
+
+    size_t complete = std::min<size_t>((available - header_size) / record_size, alice_records_.count);
+    for (; alice_records_.done < complete; alice_records_.done++) {
+        const uint8_t* record = payload + header_size + alice_records_.done * record_size;
+        if (!mta_protocol_.accumulateBobRecord(*bob_y_share_, alice_records_.first + alice_records_.done,
+                                               record, wire_features_, alice_records_.accumulated_V)) {
+            MTA_LOG_ERROR("session=%u MTA protocol execution failed at instance %u", id_,
+                          alice_records_.first + alice_records_.done);
+            return false;
+        }
+    }
+    return true;
+}
+
+bool MTAServer::Session::complete_mta(uint32_t masked_share, uint32_t accumulated_V) {
+    bob_messages_ = mta_protocol_.prepareBobMessages(*bob_y_share_);
+    if (!bob_messages_.success) {
+        MTA_LOG_ERROR("session=%u failed to prepare Bob messages", id_);
+        return false;
+    }
+    MTAProtocol::MTAResult mta_result = mta_protocol_.completeBobMTA(masked_share, accumulated_V, bob_messages_);
+    bob_additive_share_ = mta_result.additive_share;
+    bob_correlation_check_ = (*bob_y_share_ + bob_additive_share_) ^ correlation_delta_;
+    MTA_LOG_DEBUG("session=%u MTA computation completed", id_);
+    return true;
+}
+
+// Claims store entries for the shard PRECOMPUTE_CLAIM at a time, so the
+// cursor is synced to disk once per claim rather than once per session
+bool MTAServer::Session::begin_precomputed_setup(uint32_t correlation_delta) {
+    PrecomputeStore* store = shard_.precompute_store;
+    if (store == nullptr) {
+        return false;
+    }
+    if (shard_.precompute_next == shard_.precompute_end) {
+        uint64_t first = 0;
+        size_t claimed = store->claim(PRECOMPUTE_CLAIM, first);
+        if (claimed == 0) {
+            MTA_LOG_WARN("Precompute store used up, generating setup points live");
+            shard_.precompute_store = nullptr;
+            return false;
+        }
+        shard_.precompute_next = first;
+        shard_.precompute_end = first + claimed;
+    }
+
+    uint8_t scalars[PrecomputeStore::SCALARS_SIZE];
+    uint8_t points[PrecomputeStore::POINTS_SIZE];
+    bool opened = store->read(shard_.precompute_next++, scalars, points);
+    if (opened) {
+        bob_setup_ = mta_protocol_.beginBobSetup(correlation_delta, *bob_y_share_, scalars);
+        std::copy(points, points + sizeof(points), bob_setup_.points_B.begin());
+    }
+    memzero(scalars, sizeof(scalars));
+    return opened;
+}
+
+boost::asio::awaitable<bool> MTAServer::Session::generate_bob_points(uint32_t first, uint32_t count) {
+    if (precomputed_points_) {
+        co_return mta_protocol_.finishBobSetupChunk(bob_setup_, first, count);
+    }
+
+    // The points are generated by the batch scheduler together with those
+    // of other sessions in setup
+    if (!admission_.try_acquire_crypto()) {
+        co_await admission_.async_acquire_crypto(
+            boost::asio::bind_allocator(boost::asio::recycling_allocator<void>(), boost::asio::use_awaitable));
+        resume_phase();
+    }
+    bool points_ready = co_await batch_scheduler_.async_submit(
+        mta_protocol_.bobScalars() + first * 32,
+        count,
+        bob_setup_.points_B.data() + first * 65,
+        boost::asio::bind_allocator(boost::asio::recycling_allocator<void>(), boost::asio::use_awaitable));
+    resume_phase();
+    admission_.release_crypto();
+    co_return points_ready && mta_protocol_.finishBobSetupChunk(bob_setup_, first, count);
+}
+
+boost::asio::awaitable<bool> MTAServer::Session::read_message_with_size(std::chrono::milliseconds timeout,
+                                                                        PayloadHandler on_bytes) {
+    boost::system::error_code ec;
+    ScopedDeadline deadline(timing_wheel_, deadline_, timeout, &Session::on_deadline, this);
+
+    // Drop the previous frame, keeping any bytes of the next one read with it
+    consume_frame();
+
+    // Nothing buffered: wait for the client without holding a buffer, which
+    // is where an idle connection spends its time
+    if (read_filled_ == 0) {
+        co_await transport_->wait_readable(ec);
+        resume_phase();
+        if (ec) {
+            if (ec != boost::asio::error::eof) {
+                MTA_LOG_WARN("session=%u error waiting for message: %s", id_, ec.message().c_str());
+            }
+            co_return false;
+        }
+    }
+    borrow_frame_buffer();
+
+    // A single read usually brings the 4-byte header together with the body
+    while (read_filled_ < 4) {
+        co_await read_some(ec);
+        if (ec) {
+            if (ec != boost::asio::error::eof) {
+                MTA_LOG_WARN("session=%u error reading message size: %s", id_, ec.message().c_str());
+            }
+            co_return false;
+        }
+    }
+
+    const uint8_t* header = frame_data();
+    uint32_t message_size = header[0] |
+                           (header[1] << 8) |
+                           (header[2] << 16) |
+                           (header[3] << 24);
+
+    MTA_LOG_DEBUG("session=%u incoming message size: %u bytes", id_, message_size);
+    if (message_size > max_frame_bytes_) {
+        MTA_LOG_WARN("session=%u message of %u bytes exceeds the %zu byte limit", id_, message_size, max_frame_bytes_);
+        co_return false;
+    }
+
+    last_message_size_ = message_size;
+    size_t frame_size = 4 + static_cast<size_t>(message_size);
+    ensure_frame_capacity(frame_size);
+
+    while (true) {
+        if (on_bytes != nullptr &&
+            !(this->*on_bytes)(frame_data() + 4, std::min(read_filled_, frame_size) - 4)) {
+            co_return false;
+        }
+        if (read_filled_ >= frame_size) {
             break;
+        }
+        co_await read_some(ec);
+        if (ec) {
+            MTA_LOG_WARN("session=%u error reading message content: %s", id_, ec.message().c_str());
+            co_return false;
+        }
+    }
+
+    frame_ready_ = true;
+    Metrics::increment(MetricCounter::BYTES_RECEIVED, frame_size);
+    if (capture_ != nullptr) {
+        capture_->record(id_, CaptureDirection::FROM_CLIENT, frame_data() + 4, message_size);
     }
+
+    MTA_LOG_TRACE("session=%u state=%d message_size=%u", id_, static_cast<int>(state_), last_message_size_);
+    co_return true;
 }
 
-void MTAServer::Session::process_correlation_delta(const std::vector<uint8_t>& data) {
-    uint32_t correlation_delta;
+boost::asio::awaitable<std::size_t> MTAServer::Session::read_some(boost::system::error_code& ec) {
+    std::size_t length = 0;
+#if defined(BOOST_ASIO_HAS_IO_URING)
+    if (using_slot_ && slot_.registered) {
+        length = co_await transport_->read_some(
+            boost::asio::buffer(*slot_.registered + read_filled_, frame_capacity() - read_filled_), ec);
+        resume_phase();
+        read_filled_ += length;
+        co_return length;
+    }
+#endif
+    length = co_await transport_->read_some(
+        boost::asio::buffer(frame_data() + read_filled_, frame_capacity() - read_filled_), ec);
+    resume_phase();
+    read_filled_ += length;
+    co_return length;
+}
+
+void MTAServer::Session::borrow_frame_buffer() {
+    if (has_slot_ || read_buffer_) {
+        return;
+    }
+    has_slot_ = frame_buffers_.acquire(slot_);
+    using_slot_ = has_slot_;
+    if (!has_slot_) {
+        read_buffer_ = buffer_pool_.acquire(RegisteredFrameBuffers::SLOT_SIZE);
+    }
+}
+
+void MTAServer::Session::return_frame_buffer() {
+    if (has_slot_) {
+        frame_buffers_.release(slot_);
+        has_slot_ = false;
+        using_slot_ = false;
+    }
+    buffer_pool_.release(read_buffer_);
+}
+
+uint8_t* MTAServer::Session::frame_data() {
+    return using_slot_ ? slot_.data : read_buffer_.data;
+}
+
+const uint8_t* MTAServer::Session::frame_data() const {
+    return using_slot_ ? slot_.data : read_buffer_.data;
+}
+
+size_t MTAServer::Session::frame_capacity() const {
+    return using_slot_ ? RegisteredFrameBuffers::SLOT_SIZE : read_buffer_.capacity;
+}
+
+void MTAServer::Session::ensure_frame_capacity(size_t size) {
+    if (size <= frame_capacity()) {
+        return;
+    }
 
-    std::cout << "[Debug] Raw CorrelationDelta bytes:";
-    for (auto b : data) std::printf(" %02X", b);
-    std::cout << std::endl;
+    // Frame outgrew its buffer: continue it in one from a larger class
+    FrameBufferPool::Buffer larger = buffer_pool_.acquire(size);
+    std::copy(frame_data(), frame_data() + read_filled_, larger.data);
+    return_frame_buffer();
+    read_buffer_ = larger;
+}
 
-    if (!protobuf_handler_.deserializeCorrelationDelta(data, correlation_delta)) {
-        std::cerr << "Failed to deserialize correlation delta" << std::endl;
+void MTAServer::Session::consume_frame() {
+    if (!frame_ready_) {
         return;
     }
-    
-    std::cout << "Received correlation delta: " << correlation_delta << std::endl;
-    correlation_delta_ = correlation_delta;
-    
-    bob_setup_ = mta_protocol_.initializeAsBob(correlation_delta);
-    if (!bob_setup_.success) {
-        std::cerr << "Failed to initialize Bob setup" << std::endl;
+    frame_ready_ = false;
+
+    size_t frame_size = 4 + static_cast<size_t>(last_message_size_);
+    size_t leftover = read_filled_ - frame_size;
+    read_filled_ = leftover;
+    if (leftover == 0) {
+        return_frame_buffer();
         return;
     }
 
-    bob_setup_.public_key.resize(65);
-    for (size_t i = 0; i < 65; ++i) {
-        bob_setup_.public_key[i] = static_cast<uint8_t>(i);
+    // The client pipelined part of its next frame: keep it
+    uint8_t* data = frame_data();
+    std::copy(data + frame_size, data + frame_size + leftover, data);
+}
+
+std::vector<uint8_t> MTAServer::Session::take_message() {
+    const uint8_t* payload = frame_data() + 4;
+    std::vector<uint8_t> message(payload, payload + last_message_size_);
+    consume_frame();
+    return message;
+}
+
+boost::asio::awaitable<bool> MTAServer::Session::process_correlation_delta(const std::vector<uint8_t>& data) {
+    uint32_t correlation_delta;
+    uint32_t offered_features;
+
+    MTA_LOG_DEBUG_HEX("Raw CorrelationDelta bytes", data.data(), data.size(), 32);
+
+    MTA_PROBE3(deserialize__start, id_, PROBE_CORRELATION_DELTA, data.size());
+    // The first byte picks the codec for the whole session
+    binary_codec_ = BinaryCodec::isBinary(data);
+    bool decoded = binary_codec_
+        ? BinaryCodec::decodeCorrelationDelta(data, correlation_delta, offered_features)
+        : protobuf_handler_.deserializeCorrelationDelta(data, correlation_delta, offered_features);
+    MTA_PROBE3(deserialize__done, id_, PROBE_CORRELATION_DELTA, decoded ? 1 : 0);
+    if (!decoded) {
+        MTA_LOG_ERROR("session=%u failed to deserialize correlation delta", id_);
+        co_return false;
     }
-    std::cout << "[INFO] Dummy public key injected (65 bytes)" << std::endl;
     
-    std::cout << "Bob setup initialized successfully" << std::endl;
-    std::cout << "Points B length: " << bob_setup_.points_B.size() << " bytes" << std::endl;
+    MTA_LOG_DEBUG("session=%u received correlation delta: %u features: %#x", id_, correlation_delta, offered_features);
+    correlation_delta_ = correlation_delta;
+    wire_features_ = offered_features & MTAProtocol::SUPPORTED_FEATURES;
     
-    state_ = ProtocolState::SENDING_BOB_SETUP;
-    send_bob_setup();
+    // Scalars and points come from the precompute store when it has an
+    // entry. Otherwise scalars are drawn here and the points generated from
+    // them; a streamed setup generates them chunk by chunk as it sends them.
+    precomputed_points_ = begin_precomputed_setup(correlation_delta);
+    if (!precomputed_points_) {
+        bob_setup_ = mta_protocol_.beginBobSetup(correlation_delta, *bob_y_share_);
+    }
+    bob_setup_.features = wire_features_;
+    bob_setup_.public_key = dummyPublicKey();
+    MTA_LOG_TRACE("session=%u dummy public key injected (65 bytes)", id_);
+    if (wire_features_ & MTAProtocol::FEATURE_STREAMED_SETUP) {
+        co_return true;
+    }
+
+    MTA_PROBE1(cot__setup__start, id_);
+    bool setup_ready = co_await generate_bob_points(0, bob_setup_.num_ot_instances);
+    MTA_PROBE2(cot__setup__done, id_, setup_ready ? 1 : 0);
+    if (!setup_ready) {
+        MTA_LOG_ERROR("session=%u failed to initialize Bob setup", id_);
+        co_return false;
+    }
+
+    MTA_LOG_DEBUG("session=%u Bob initialized COT with correlation delta: %u", id_, correlation_delta_);
+    MTA_LOG_DEBUG("session=%u Bob setup initialized, points B length: %zu bytes", id_, bob_setup_.points_B.size());
+    co_return true;
 }
 
-void MTAServer::Session::process_alice_messages(const std::vector<uint8_t>& data) {
+bool MTAServer::Session::process_alice_messages(const std::vector<uint8_t>& data) {
     MTAProtocol::AliceMessages alice_messages;
-    std::cout << "[DEBUG] Raw AliceMessages buffer (" << data.size() << " bytes): ";
-    for (size_t i = 0; i < std::min(data.size(), size_t(32)); ++i) {
-        printf("%02X ", data[i]);
-    }
-    std::cout << (data.size() > 32 ? "... (truncated)" : "") << std::endl;
+    MTA_LOG_DEBUG_HEX("Raw AliceMessages buffer", data.data(), data.size(), 32);
     
-    if (!mta_protocol_.deserializeAliceMessages(data, alice_messages)) {
-        std::cerr << "Failed to deserialize Alice messages" << std::endl;
-        return;
+    MTA_PROBE3(deserialize__start, id_, PROBE_ALICE_MESSAGES, data.size());
+    bool decoded = binary_codec_
+        ? BinaryCodec::decodeAliceMessages(data, wire_features_, alice_messages)
+        : mta_protocol_.deserializeAliceMessages(data, alice_messages, wire_features_);
+    MTA_PROBE3(deserialize__done, id_, PROBE_ALICE_MESSAGES, decoded ? 1 : 0);
+    if (!decoded) {
+        MTA_LOG_ERROR("session=%u failed to deserialize Alice messages", id_);
+        return false;
     }
 
-    std::cout << "Received Alice messages successfully" << std::endl;
-    std::cout << "Success: " << alice_messages.success << std::endl;
-    std::cout << "Alice's masked share: " << alice_messages.masked_share << std::endl;
+    MTA_LOG_DEBUG("session=%u received Alice messages success=%d masked_share=%u",
+                  id_, alice_messages.success, alice_messages.masked_share);
 
-    bob_messages_ = mta_protocol_.prepareBobMessages(bob_y_share_);
+    bob_messages_ = mta_protocol_.prepareBobMessages(*bob_y_share_);
     if (!bob_messages_.success) {
-        std::cerr << "Failed to prepare Bob messages" << std::endl;
-        return;
+        MTA_LOG_ERROR("session=%u failed to prepare Bob messages", id_);
+        return false;
     }
 
-    auto mta_result = mta_protocol_.executeBobMTA(bob_y_share_, alice_messages);
+    MTA_PROBE1(cot__execute__start, id_);
+    auto mta_result = mta_protocol_.executeBobMTA(*bob_y_share_, alice_messages, bob_messages_);
+    MTA_PROBE2(cot__execute__done, id_, mta_result.success ? 1 : 0);
     if (!mta_result.success) {
-        std::cerr << "MTA protocol execution failed" << std::endl;
-        return;
+        MTA_LOG_ERROR("session=%u MTA protocol execution failed", id_);
+        return false;
     }
 
     bob_additive_share_ = mta_result.additive_share;
-    bob_correlation_check_ = (bob_y_share_ + bob_additive_share_) ^ correlation_delta_;
+    bob_correlation_check_ = (*bob_y_share_ + bob_additive_share_) ^ correlation_delta_;
 
-    std::cout << "\n=== MTA PROTOCOL COMPUTATION COMPLETED ===" << std::endl;
-    std::cout << std::dec;
-    std::cout << "Bob's Multiplicative Share: " << bob_y_share_ << std::endl;
-    std::cout << "Bob's Additive Share: " << bob_additive_share_ << std::endl;
-    std::cout << "Correlation Check Value: " << bob_correlation_check_ << std::endl;
+    MTA_LOG_DEBUG("session=%u MTA computation completed", id_);
+    return true;
+}
+
+bool MTAServer::Session::process_alice_chunk(const std::vector<uint8_t>& data, uint32_t first, uint32_t count,
+                                             uint32_t& accumulated_V, uint32_t& masked_share) {
+    MTAProtocol::AliceMessages alice_chunk;
+    MTA_PROBE3(deserialize__start, id_, PROBE_ALICE_MESSAGES, data.size());
+    bool decoded = binary_codec_
+        ? BinaryCodec::decodeAliceMessages(data, wire_features_, alice_chunk, count)
+        : mta_protocol_.deserializeAliceMessages(data, alice_chunk, wire_features_, count);
+    MTA_PROBE3(deserialize__done, id_, PROBE_ALICE_MESSAGES, decoded ? 1 : 0);
+    if (!decoded) {
+        MTA_LOG_ERROR("session=%u failed to deserialize Alice messages chunk at %u", id_, first);
+        return false;
+    }
 
-    state_ = ProtocolState::SENDING_BOB_MESSAGES;
-    send_bob_messages();
+    if (!mta_protocol_.accumulateBobMTA(*bob_y_share_, first, alice_chunk, accumulated_V)) {
+        MTA_LOG_ERROR("session=%u MTA protocol execution failed at chunk %u", id_, first);
+        return false;
+    }
+    masked_share = alice_chunk.masked_share;
+    return true;
 }
 
-void MTAServer::Session::send_bob_messages() {
+boost::asio::awaitable<bool> MTAServer::Session::send_bob_messages() {
     if (!bob_messages_.success) {
-        std::cerr << "Bob messages not ready!" << std::endl;
-        return;
+        MTA_LOG_ERROR("session=%u Bob messages not ready", id_);
+        co_return false;
     }
 
-    std::vector<uint8_t> serialized_messages = mta_protocol_.serializeBobMessages(bob_messages_);
+    MTA_PROBE2(serialize__start, id_, PROBE_BOB_MESSAGES);
+    std::vector<uint8_t> serialized_messages;
+    if (binary_codec_) {
+        BinaryCodec::encodeBobMessages(bob_messages_, serialized_messages);
+    } else {
+        serialized_messages = mta_protocol_.serializeBobMessages(bob_messages_);
+    }
+    MTA_PROBE3(serialize__done, id_, PROBE_BOB_MESSAGES, serialized_messages.size());
     if (serialized_messages.empty()) {
-        std::cerr << "Failed to serialize Bob messages" << std::endl;
-        return;
+        MTA_LOG_ERROR("session=%u failed to serialize Bob messages", id_);
+        co_return false;
     }
 
-    std::cout << "Sending Bob messages (" << serialized_messages.size() << " bytes)" << std::endl;
-    std::cout << "  - Masked share: " << bob_messages_.masked_share << std::endl;
+    MTA_LOG_DEBUG("session=%u sending Bob messages (%zu bytes) masked_share=%u",
+                  id_, serialized_messages.size(), bob_messages_.masked_share);
 
-    send_message_with_size(serialized_messages);
+    co_return co_await send_message_with_size(serialized_messages);
 }
 
-void MTAServer::Session::send_bob_setup() {
-    protobuf_handler_.temp_ot_messages_ = mta_protocol_.splitIntoByteVectors(bob_setup_.points_B, 65);
+// Index into Shard::setup_templates of the template built for `features`
+static size_t setupTemplateIndex(uint32_t features) {
+    return ((features & MTAProtocol::FEATURE_COMPRESSED_POINTS) ? 1 : 0) |
+           ((features & MTAProtocol::FEATURE_INTERLEAVED_MESSAGES) ? 2 : 0);
+}
+
+size_t MTAServer::Session::encode_bob_setup() {
+    bool compressed = (wire_features_ & MTAProtocol::FEATURE_COMPRESSED_POINTS) != 0;
+    const BobSetupTemplate* setup_template = shard_.setup_templates[setupTemplateIndex(wire_features_)].get();
+    // The template holds success, the instance count, the features and the
+    // dummy public key, so it only stands in for a setup that has exactly
+    // those
+    if (binary_codec_ || !setup_template->valid() || !bob_setup_.success ||
+        setup_template->features() != wire_features_ ||
+        bob_setup_.num_ot_instances != setup_template->point_count() ||
+        bob_setup_.points_B.size() != setup_template->point_count() * 65) {
+        std::vector<uint8_t> serialized_setup = serialize_bob_setup(bob_setup_);
+        return serialized_setup.empty() ? 0 : frame_message(serialized_setup);
+    }
+
+    MTA_PROBE2(serialize__start, id_, PROBE_BOB_SETUP);
+    const uint8_t* points = bob_setup_.points_B.data();
+    uint8_t compressed_points[OT_INSTANCES * 33];
+    if (compressed) {
+        CryptoOperations::compressPoints(points, OT_INSTANCES, compressed_points);
+        points = compressed_points;
+    }
+
+    size_t frame_size = setup_template->frame_size();
+    write_buffer_ = buffer_pool_.acquire(frame_size);
+    setup_template->write(points, write_buffer_.data);
+    MTA_PROBE3(serialize__done, id_, PROBE_BOB_SETUP, frame_size - 4);
+    if (capture_ != nullptr) {
+        capture_->record(id_, CaptureDirection::TO_CLIENT, write_buffer_.data + 4, frame_size - 4);
+    }
+
+    MTA_LOG_DEBUG("session=%u sending Bob setup from template (%zu bytes)", id_, frame_size - 4);
+    return frame_size;
+}
+
+std::vector<uint8_t> MTAServer::Session::serialize_bob_setup(const MTAProtocol::BobSetup& setup) {
+    MTA_PROBE2(serialize__start, id_, PROBE_BOB_SETUP);
+    if (binary_codec_) {
+        std::vector<uint8_t> serialized_setup;
+        BinaryCodec::encodeBobSetup(setup, serialized_setup);
+        MTA_PROBE3(serialize__done, id_, PROBE_BOB_SETUP, serialized_setup.size());
+        MTA_LOG_DEBUG("session=%u sending binary Bob setup (%zu bytes)", id_, serialized_setup.size());
+        return serialized_setup;
+    }
+
+    if (wire_features_ & MTAProtocol::FEATURE_COMPRESSED_POINTS) {
+        size_t count = setup.points_B.size() / 65;
+        std::vector<uint8_t> compressed(count * 33);
+        CryptoOperations::compressPoints(setup.points_B.data(), count, compressed.data());
+        protobuf_handler_.temp_ot_messages_ = mta_protocol_.splitIntoByteVectors(compressed, 33);
+    } else {
+        protobuf_handler_.temp_ot_messages_ = mta_protocol_.splitIntoByteVectors(setup.points_B, 65);
+    }
     protobuf_handler_.temp_bytes_arrays_ = protobuf_handler_.temp_ot_messages_;
 
     mta_BobSetup proto_bob_setup = mta_BobSetup_init_zero;
-    proto_bob_setup.success = bob_setup_.success;
-    proto_bob_setup.num_ot_instances = bob_setup_.num_ot_instances;
+    proto_bob_setup.success = setup.success;
+    proto_bob_setup.num_ot_instances = setup.num_ot_instances;
+    proto_bob_setup.features = wire_features_;
 
     proto_bob_setup.ot_messages.funcs.encode = MTAProtobufHandler::encode_bytes_array;
     proto_bob_setup.ot_messages.arg = &protobuf_handler_.temp_bytes_arrays_;
 
-    if (!bob_setup_.public_key.empty()) {
-        proto_bob_setup.public_key.size = std::min((size_t)256, bob_setup_.public_key.size());
+    if (!setup.public_key.empty()) {
+        proto_bob_setup.public_key.size = std::min((size_t)256, setup.public_key.size());
         std::copy(
-            bob_setup_.public_key.begin(),
-            bob_setup_.public_key.begin() + proto_bob_setup.public_key.size,
+            setup.public_key.begin(),
+            setup.public_key.begin() + proto_bob_setup.public_key.size,
             proto_bob_setup.public_key.bytes
         );
     }
 
-    std::cout << "\n=== Bob Setup Message ===" << std::endl;
-    std::cout << "success: " << proto_bob_setup.success << std::endl;
-    std::cout << "num_ot_instances: " << proto_bob_setup.num_ot_instances << std::endl;
+    MTA_LOG_TRACE("session=%u BobSetup success=%d num_ot_instances=%u",
+                  id_, proto_bob_setup.success, static_cast<unsigned>(proto_bob_setup.num_ot_instances));
 
     std::vector<uint8_t> serialized_setup = protobuf_handler_.serializeBobSetup(proto_bob_setup);
+    MTA_PROBE3(serialize__done, id_, PROBE_BOB_SETUP, serialized_setup.size());
     if (serialized_setup.empty()) {
-        std::cerr << "[ERROR] Failed to serialize Bob setup\n";
-        return;
+        MTA_LOG_ERROR("session=%u failed to serialize Bob setup", id_);
+        return {};
     }
 
-    std::cout << "Sending Bob setup (" << serialized_setup.size() << " bytes)\n";
-    state_ = ProtocolState::SENDING_BOB_SETUP;
-    send_message_with_size(serialized_setup);
+    MTA_LOG_DEBUG("session=%u sending Bob setup (%zu bytes)", id_, serialized_setup.size());
+    return serialized_setup;
 }
 
-void MTAServer::Session::send_message_with_size(const std::vector<uint8_t>& message) {
-    write_buffer_.clear();
-    write_buffer_.resize(4 + message.size());
+boost::asio::awaitable<bool> MTAServer::Session::send_message_with_size(const std::vector<uint8_t>& message) {
+    co_return co_await write_frame(frame_message(message));
+}
+
+size_t MTAServer::Session::frame_message(const std::vector<uint8_t>& message) {
+    size_t frame_size = 4 + message.size();
+    write_buffer_ = buffer_pool_.acquire(frame_size);
     uint32_t size = static_cast<uint32_t>(message.size());
-    write_buffer_[0] = size & 0xFF;
-    write_buffer_[1] = (size >> 8) & 0xFF;
-    write_buffer_[2] = (size >> 16) & 0xFF;
-    write_buffer_[3] = (size >> 24) & 0xFF;
+    write_buffer_.data[0] = size & 0xFF;
+    write_buffer_.data[1] = (size >> 8) & 0xFF;
+    write_buffer_.data[2] = (size >> 16) & 0xFF;
+    write_buffer_.data[3] = (size >> 24) & 0xFF;
 
-    std::copy(message.begin(), message.end(), write_buffer_.begin() + 4);
+    std::copy(message.begin(), message.end(), write_buffer_.data + 4);
+    if (capture_ != nullptr) {
+        capture_->record(id_, CaptureDirection::TO_CLIENT, message.data(), message.size());
+    }
+    return frame_size;
+}
 
-    auto self(shared_from_this());
-    boost::asio::async_write(socket_,
-        boost::asio::buffer(write_buffer_),
-        [this, self](boost::system::error_code ec, std::size_t length) {
-            if (!ec) {
-                std::cout << "Sent message (" << length << " bytes total)" << std::endl;
-
-                if (state_ == ProtocolState::SENDING_BOB_SETUP) {
-                    state_ = ProtocolState::WAITING_FOR_ALICE_MESSAGES;
-                    std::cout << "Waiting for Alice's messages..." << std::endl;
-                    read_message_with_size();
-                } else if (state_ == ProtocolState::SENDING_BOB_MESSAGES) {
-                    state_ = ProtocolState::PROTOCOL_COMPLETE;
-                    std::cout << "Final Results:" << std::endl;
-                    std::cout << std::dec;
-                    std::cout << "Bob's Multiplicative Share: " << bob_y_share_ << std::endl;
-                    std::cout << "Bob's Additive Share: " << bob_additive_share_ << std::endl;
-                    std::cout << "Correlation Check: " << bob_correlation_check_ << std::endl;
-                    std::cout << "Protocol executed successfully." << std::endl;
-                }
+boost::asio::awaitable<bool> MTAServer::Session::write_frame(size_t frame_size) {
+    boost::system::error_code ec;
+    std::size_t length = 0;
+    {
+        ScopedDeadline deadline(timing_wheel_, deadline_, write_timeout_, &Session::on_deadline, this);
+        length = co_await transport_->write(boost::asio::buffer(write_buffer_.data, frame_size), ec);
+    }
+    resume_phase();
+    buffer_pool_.release(write_buffer_);
+    if (ec) {
+        MTA_LOG_WARN("session=%u error sending message: %s", id_, ec.message().c_str());
+        co_return false;
+    }
 
-            } else {
-                std::cerr << "Error sending message: " << ec.message() << std::endl;
-            }
-        });
-}
\ No newline at end of file
+    Metrics::increment(MetricCounter::BYTES_SENT, length);
+    MTA_LOG_TRACE("session=%u sent message (%zu bytes total)", id_, length);
+    co_return true;
+}
@@ -1,31 +1,108 @@
 #pragma once
 
 #include <boost/asio.hpp>
+#include <boost/smart_ptr/intrusive_ptr.hpp>
 #include <memory>
 #include <vector>
 #include <cstdint>
 #include <string>
+#include <thread>
 #include "mta_protocol.h"
 #include "protobuf_handler.h"
+#include "bob_setup_template.h"
+#include "ec_batch_scheduler.h"
+#include "registered_frame_buffers.h"
+#include "frame_buffer_pool.h"
+#include "server_config.h"
+#include "session_transport.h"
+#include "metrics.h"
+#include "session_capture.h"
+#include "admission_control.h"
+#include "timing_wheel.h"
+#include "precompute_store.h"
+#include "result_journal.h"
+
+class AdminServer;
 
 using boost::asio::ip::tcp;
 
 class MTAServer {
 public:
-    MTAServer(boost::asio::io_context& io_context, short port, uint32_t y_share = 0);
+    MTAServer(boost::asio::io_context& io_context, short port, uint32_t y_share = 0,
+              const ServerConfig& config = ServerConfig());
+    ~MTAServer();
+
+    unsigned short port() const;
+    unsigned short admin_port() const;      // 0 when the admin endpoint is disabled
 
 private:
-    void start_accept();
+    class Session;
+
+    // One listener and everything its sessions touch, owned by a single IO
+    // thread. With several shards each acceptor is bound with SO_REUSEPORT
+    // and the kernel spreads incoming connections across them.
+    struct Shard {
+        Shard(boost::asio::io_context& io_context, const tcp::endpoint& endpoint,
+              bool reuse_port, const ServerConfig& config, CaptureFile* capture_file);
+
+        boost::asio::io_context& io_context;
+        tcp::acceptor acceptor;
+        std::unique_ptr<MTAProtobufHandler> protobuf_handler;
+        // Pre-encoded protobuf BobSetup frames, one per combination of
+        // compressed points and interleaved messages (setupTemplateIndex)
+        std::unique_ptr<BobSetupTemplate> setup_templates[4];
+        std::unique_ptr<ECBatchScheduler> batch_scheduler;
+        std::unique_ptr<RegisteredFrameBuffers> frame_buffers;
+        std::unique_ptr<FrameBufferPool> buffer_pool;
+        size_t max_frame_bytes;
+        std::unique_ptr<CaptureBuffer> capture;     // null unless capturing
+        std::unique_ptr<AdmissionControl> admission;
+        std::unique_ptr<TimingWheel> timing_wheel;
+        std::chrono::milliseconds idle_timeout;
+        std::chrono::milliseconds read_timeout;
+        std::chrono::milliseconds write_timeout;
 
-    class Session : public std::enable_shared_from_this<Session> {
+        // Entries [precompute_next, precompute_end) of the precompute store
+        // are claimed for this shard; null store when off or used up
+        PrecomputeStore* precompute_store;
+        uint64_t precompute_next;
+        uint64_t precompute_end;
+
+        ResultJournal* result_journal;              // null unless journaling
+
+        // Closed sessions kept for reuse, at most session_pool_size
+        std::vector<std::unique_ptr<Session>> idle_sessions;
+        size_t session_pool_size;
+    };
+
+    void start_accept(Shard& shard);
+    void start_unix_accept();
+    void start_shm_accept();
+    Shard& next_local_shard();
+    // Hands the connection to the shard's admission control, which starts,
+    // queues or rejects it
+    void start_session(Shard& shard, std::unique_ptr<SessionTransport> transport,
+                       PhaseTimer::Clock::time_point accepted_at);
+    void start_trace_signal();
+
+    // Sessions are pooled per shard and reference counted without atomics,
+    // since a session never leaves its shard's thread. The last reference
+    // closes the session, which resets it and returns it to the pool.
+    class Session {
     public:
-        Session(boost::asio::io_context& io_context, 
-                MTAProtocol& mta_protocol, 
-                MTAProtobufHandler& protobuf_handler,
-                uint32_t y_share);
+        Session(Shard& shard, uint32_t y_share);
+
+        // Runs the exchange on `transport` in a pooled session, or in a new
+        // one when the shard has none idle
+        static void start(Shard& shard, uint32_t y_share, std::unique_ptr<SessionTransport> transport,
+                          PhaseTimer::Clock::time_point accepted_at);
 
-        tcp::socket& socket();
-        void start();
+        friend void intrusive_ptr_add_ref(Session* session) { session->references_++; }
+        friend void intrusive_ptr_release(Session* session) {
+            if (--session->references_ == 0) {
+                session->close();
+            }
+        }
 
     private:
         enum class ProtocolState {
@@ -36,40 +113,166 @@ private:
             PROTOCOL_COMPLETE
         };
 
+        void open(std::unique_ptr<SessionTransport> transport, PhaseTimer::Clock::time_point accepted_at);
+        // Releases the connection and everything it held, then pools or
+        // deletes the session
+        void close();
+
+        // The whole exchange, read top to bottom; `self` keeps the session alive
+        boost::asio::awaitable<void> run(boost::intrusive_ptr<Session> self);
+        boost::asio::awaitable<bool> exchange(PhaseTimer& phases);
+        // The setup and Alice's messages under FEATURE_STREAMED_SETUP
+        boost::asio::awaitable<bool> exchange_streamed(PhaseTimer& phases);
+
+        // Allocation tags (MTA_ALLOC_TRACKING builds): the IO thread is
+        // shared, so the session's phase is re-applied after every resume
+        void enter_phase(MetricPhase phase);
+        void resume_phase() const;
+
+        // Record and probe phase ends and state transitions
+        void end_phase(PhaseTimer& phases, MetricPhase phase);
+        void set_state(ProtocolState state);
+
+        // Timing wheel callback: closes the transport, which fails the
+        // pending read or write and ends the session
+        static void on_deadline(void* session);
+
         // Network I/O methods
-        void read_message_with_size();
-        void send_message_with_size(const std::vector<uint8_t>& message);
+        // Fails once `timeout` passes before the whole frame has arrived.
+        // `on_bytes`, if given, sees the payload received so far after every
+        // read, and fails the read by returning false.
+        using PayloadHandler = bool (Session::*)(const uint8_t* payload, size_t available);
+        boost::asio::awaitable<bool> read_message_with_size(std::chrono::milliseconds timeout,
+                                                            PayloadHandler on_bytes = nullptr);
+        boost::asio::awaitable<bool> send_message_with_size(const std::vector<uint8_t>& message);
+        // Sizes `message` into write_buffer_ and returns the frame size
+        size_t frame_message(const std::vector<uint8_t>& message);
+        // Writes the first `frame_size` bytes of write_buffer_, then releases it
+        boost::asio::awaitable<bool> write_frame(size_t frame_size);
         
         // Protocol message processing
-        void process_received_message();
-        void process_correlation_delta(const std::vector<uint8_t>& data);
-        void process_alice_messages(const std::vector<uint8_t>& data);
+        boost::asio::awaitable<bool> process_correlation_delta(const std::vector<uint8_t>& data);
+        bool process_alice_messages(const std::vector<uint8_t>& data);
+        // One chunk of a streamed exchange, instances [first, first + count)
+        bool process_alice_chunk(const std::vector<uint8_t>& data, uint32_t first, uint32_t count,
+                                 uint32_t& accumulated_V, uint32_t& masked_share);
+        // Reads Alice's messages for instances [first, first + count), as one
+        // frame, and folds them into accumulated_V. An interleaved frame is
+        // processed record by record while it arrives.
+        boost::asio::awaitable<bool> receive_alice_chunk(uint32_t first, uint32_t count,
+                                                         uint32_t& accumulated_V, uint32_t& masked_share);
+        bool consume_alice_records(const uint8_t* payload, size_t available);
+        // Bob's share from the accumulated COT values, into bob_messages_
+        bool complete_mta(uint32_t masked_share, uint32_t accumulated_V);
+        // Starts bob_setup_ from the next precomputed entry, if there is one
+        bool begin_precomputed_setup(uint32_t correlation_delta);
+        // Generates and encodes points B for instances [first, first + count)
+        boost::asio::awaitable<bool> generate_bob_points(uint32_t first, uint32_t count);
         
-        void send_bob_setup();
-        void send_bob_messages();
+        // Frames the BobSetup into write_buffer_, from the shard's template
+        // when there is one for the session's encoding; 0 on failure
+        size_t encode_bob_setup();
+        std::vector<uint8_t> serialize_bob_setup(const MTAProtocol::BobSetup& setup);
+        boost::asio::awaitable<bool> send_bob_messages();
+
+        // Copies out the payload of the frame just read and consumes it
+        std::vector<uint8_t> take_message();
+
+        // Frame buffer management: a buffer is borrowed when a frame starts
+        // arriving and returned once no unread bytes remain in it. Frames
+        // land in a registered slot when one is free, otherwise (or when too
+        // large) in a buffer from the shard's pool.
+        boost::asio::awaitable<std::size_t> read_some(boost::system::error_code& ec);
+        void borrow_frame_buffer();
+        void return_frame_buffer();
+        uint8_t* frame_data();
+        const uint8_t* frame_data() const;
+        size_t frame_capacity() const;
+        void ensure_frame_capacity(size_t size);
+        void consume_frame();
 
-        tcp::socket socket_;
-        MTAProtocol& mta_protocol_;
+        Shard& shard_;
+        size_t references_;
+
+        uint32_t id_;
+        PhaseTimer::Clock::time_point accepted_at_;
+        MetricPhase phase_;                 // phase in progress, for allocation tags
+        bool traced_;                       // sampled for span tracing
+        CaptureBuffer* capture_;
+        std::unique_ptr<SessionTransport> transport_;
+        MTAProtocol mta_protocol_;          // per session: holds this session's OT scalars
         MTAProtobufHandler& protobuf_handler_;
+        ECBatchScheduler& batch_scheduler_;
+        AdmissionControl& admission_;
+        TimingWheel& timing_wheel_;
+        TimingWheel::Timer deadline_;
+        std::chrono::milliseconds idle_timeout_;
+        std::chrono::milliseconds read_timeout_;
+        std::chrono::milliseconds write_timeout_;
         
         ProtocolState state_;
-        uint32_t bob_y_share_;              // Bob's multiplicative share
+        SecureValue<uint32_t> bob_y_share_; // Bob's multiplicative share, in the secure arena
         uint32_t bob_additive_share_;       // Bob's computed additive share
         uint32_t correlation_delta_;        // Correlation delta received from Alice
+        uint32_t wire_features_;            // MTAProtocol::FEATURE_* accepted for this session
+        bool binary_codec_;                 // BinaryCodec instead of protobuf, set by the first frame
+        bool precomputed_points_;           // points B came from the precompute store
         uint32_t bob_correlation_check_;    // Correlation check value for verification
         
         // protocol data structures - using consistent types from MTAProtocol
         MTAProtocol::BobSetup bob_setup_;
         MTAProtocol::BobMessages bob_messages_; //Holds prepared Bob messages with correct beta
+
+        // Progress through the interleaved AliceMessages frame being read
+        struct AliceRecords {
+            uint32_t first;             // instance of the frame's first record
+            uint32_t count;
+            uint32_t done;              // records processed so far
+            uint32_t accumulated_V;
+            uint32_t masked_share;
+        };
+        AliceRecords alice_records_;
         
-        std::vector<uint8_t> read_buffer_;
-        std::vector<uint8_t> write_buffer_;
+        RegisteredFrameBuffers& frame_buffers_;
+        RegisteredFrameBuffers::Slot slot_;
+        bool has_slot_;
+        bool using_slot_;
+
+        FrameBufferPool& buffer_pool_;
+        size_t max_frame_bytes_;
+        FrameBufferPool::Buffer read_buffer_;   // when the frame is not in a slot
+        FrameBufferPool::Buffer write_buffer_;  // only during a write
+        size_t read_filled_;                // bytes received into the frame buffer
+        bool frame_ready_;                  // a complete frame sits at the buffer start
         uint32_t last_message_size_;
     };
 
+    using WorkGuard = boost::asio::executor_work_guard<boost::asio::io_context::executor_type>;
+
     boost::asio::io_context& io_context_;
-    tcp::acceptor acceptor_;
-    std::unique_ptr<MTAProtocol> mta_protocol_;
-    std::unique_ptr<MTAProtobufHandler> protobuf_handler_;
-    uint32_t bob_y_share_;
+    std::unique_ptr<CaptureFile> capture_file_;     // outlives the shards' buffers
+    std::unique_ptr<PrecomputeStore> precompute_store_;
+    std::unique_ptr<ResultJournal> result_journal_;
+    std::vector<std::unique_ptr<boost::asio::io_context>> worker_contexts_;
+    std::vector<WorkGuard> worker_guards_;
+    std::vector<std::unique_ptr<Shard>> shards_;
+    std::vector<std::thread> worker_threads_;
+
+    // Co-located clients: AF_UNIX stream sessions and shared-memory ring
+    // rendezvous. Both listen on the first shard and hand accepted
+    // connections to the shards round-robin.
+    std::unique_ptr<boost::asio::local::stream_protocol::acceptor> unix_acceptor_;
+    std::unique_ptr<boost::asio::local::stream_protocol::acceptor> shm_acceptor_;
+    std::string unix_path_;
+    std::string shm_path_;
+    size_t shm_ring_bytes_;
+    size_t next_local_shard_;
+
+    std::unique_ptr<AdminServer> admin_server_;
+
+    // SIGUSR2 dumps the span trace to trace_path_
+    std::unique_ptr<boost::asio::signal_set> trace_signals_;
+    std::string trace_path_;
+
+    SecureValue<uint32_t> bob_y_share_;
 };
\ No newline at end of file
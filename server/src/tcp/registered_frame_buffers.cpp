@@ -0,0 +1,59 @@
+#include "registered_frame_buffers.h"
+#include "logger.h"
+
+RegisteredFrameBuffers::RegisteredFrameBuffers(boost::asio::io_context& io_context, size_t slot_count)
+    : storage_(slot_count * SLOT_SIZE) {
+    free_slots_.reserve(slot_count);
+    for (size_t i = slot_count; i-- > 0;) {
+        free_slots_.push_back(i);
+    }
+
+#if defined(BOOST_ASIO_HAS_IO_URING)
+    if (slot_count == 0) {
+        return;
+    }
+
+    slot_buffers_.reserve(slot_count);
+    for (size_t i = 0; i < slot_count; i++) {
+        slot_buffers_.push_back(boost::asio::buffer(&storage_[i * SLOT_SIZE], SLOT_SIZE));
+    }
+
+    // Registration pins the pages and counts against RLIMIT_MEMLOCK; without
+    // it the slots still work as ordinary pooled buffers
+    try {
+        registration_.emplace(boost::asio::register_buffers(io_context, slot_buffers_));
+    } catch (const boost::system::system_error& e) {
+        MTA_LOG_WARN("io_uring buffer registration failed, using unregistered reads: %s", e.what());
+    }
+#else
+    (void)io_context;
+#endif
+}
+
+bool RegisteredFrameBuffers::acquire(Slot& slot) {
+    if (free_slots_.empty()) {
+        return false;
+    }
+
+    slot.index = free_slots_.back();
+    free_slots_.pop_back();
+    slot.data = &storage_[slot.index * SLOT_SIZE];
+#if defined(BOOST_ASIO_HAS_IO_URING)
+    if (registration_) {
+        slot.registered = (*registration_)[slot.index];
+    }
+#endif
+    return true;
+}
+
+void RegisteredFrameBuffers::release(const Slot& slot) {
+    free_slots_.push_back(slot.index);
+}
+
+bool RegisteredFrameBuffers::registered() const {
+#if defined(BOOST_ASIO_HAS_IO_URING)
+    return registration_.has_value();
+#else
+    return false;
+#endif
+}
@@ -0,0 +1,41 @@
+#pragma once
+
+#include <boost/asio.hpp>
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <vector>
+
+// Fixed-size receive slots owned by one io_context. Sessions read frames into
+// a slot instead of their own heap buffer. With the io_uring backend the
+// whole block is registered with the kernel once at startup, so frame reads
+// are submitted as IORING_OP_READ_FIXED without per-read page pinning.
+class RegisteredFrameBuffers {
+public:
+    static const size_t SLOT_SIZE = 8192;
+
+    struct Slot {
+        uint8_t* data = nullptr;
+        size_t index = 0;
+#if defined(BOOST_ASIO_HAS_IO_URING)
+        std::optional<boost::asio::mutable_registered_buffer> registered;
+#endif
+    };
+
+    RegisteredFrameBuffers(boost::asio::io_context& io_context, size_t slot_count);
+
+    // Returns false when every slot is in use; the caller then reads into its
+    // own heap buffer
+    bool acquire(Slot& slot);
+    void release(const Slot& slot);
+
+    bool registered() const;
+
+private:
+    std::vector<uint8_t> storage_;
+    std::vector<size_t> free_slots_;
+#if defined(BOOST_ASIO_HAS_IO_URING)
+    std::vector<boost::asio::mutable_buffer> slot_buffers_;
+    std::optional<boost::asio::buffer_registration<std::vector<boost::asio::mutable_buffer>>> registration_;
+#endif
+};
@@ -0,0 +1,64 @@
+#include "server_config.h"
+#include <cstdlib>
+#include "logger.h"
+
+static uint64_t readEnvUnsigned(const char* name, uint64_t default_value) {
+    const char* value = std::getenv(name);
+    if (value == nullptr || *value == '\0') {
+        return default_value;
+    }
+
+    char* end = nullptr;
+    unsigned long long parsed = std::strtoull(value, &end, 10);
+    if (end == value || *end != '\0') {
+        MTA_LOG_WARN("Ignoring invalid %s=%s", name, value);
+        return default_value;
+    }
+    return parsed;
+}
+
+static std::string readEnvString(const char* name, const std::string& default_value) {
+    const char* value = std::getenv(name);
+    return value != nullptr ? std::string(value) : default_value;
+}
+
+ServerConfig ServerConfig::fromEnvironment() {
+    ServerConfig config;
+    config.acceptor_shards = static_cast<size_t>(readEnvUnsigned("MTA_ACCEPTOR_SHARDS", config.acceptor_shards));
+    config.accepts_per_shard = static_cast<size_t>(readEnvUnsigned("MTA_ACCEPTS_PER_SHARD", config.accepts_per_shard));
+    config.reuse_port = readEnvUnsigned("MTA_REUSE_PORT", config.reuse_port ? 1 : 0) != 0;
+    config.listen_backlog = static_cast<int>(readEnvUnsigned("MTA_LISTEN_BACKLOG", config.listen_backlog));
+    config.unix_path = readEnvString("MTA_UNIX_PATH", config.unix_path);
+    config.shm_path = readEnvString("MTA_SHM_PATH", config.shm_path);
+    config.shm_ring_bytes = static_cast<size_t>(readEnvUnsigned("MTA_SHM_RING_BYTES", config.shm_ring_bytes));
+    if (!readEnvString("MTA_ADMIN_PORT", "").empty()) {
+        config.admin_port = static_cast<int>(readEnvUnsigned("MTA_ADMIN_PORT", 0));
+    }
+    config.admin_address = readEnvString("MTA_ADMIN_ADDRESS", config.admin_address);
+    config.max_sessions = static_cast<size_t>(readEnvUnsigned("MTA_MAX_SESSIONS", config.max_sessions));
+    config.accept_queue = static_cast<size_t>(readEnvUnsigned("MTA_ACCEPT_QUEUE", config.accept_queue));
+    config.max_crypto_jobs = static_cast<size_t>(readEnvUnsigned("MTA_MAX_CRYPTO_JOBS", config.max_crypto_jobs));
+    config.shed_target_us = static_cast<uint32_t>(readEnvUnsigned("MTA_SHED_TARGET_US", config.shed_target_us));
+    config.shed_interval_us = static_cast<uint32_t>(readEnvUnsigned("MTA_SHED_INTERVAL_US", config.shed_interval_us));
+    config.idle_timeout_ms = static_cast<uint32_t>(readEnvUnsigned("MTA_IDLE_TIMEOUT_MS", config.idle_timeout_ms));
+    config.read_timeout_ms = static_cast<uint32_t>(readEnvUnsigned("MTA_READ_TIMEOUT_MS", config.read_timeout_ms));
+    config.write_timeout_ms = static_cast<uint32_t>(readEnvUnsigned("MTA_WRITE_TIMEOUT_MS", config.write_timeout_ms));
+    config.timer_tick_ms = static_cast<uint32_t>(readEnvUnsigned("MTA_TIMER_TICK_MS", config.timer_tick_ms));
+    config.batch_window_us = static_cast<uint32_t>(readEnvUnsigned("MTA_BATCH_WINDOW_US", config.batch_window_us));
+    config.batch_max_jobs = static_cast<size_t>(readEnvUnsigned("MTA_BATCH_MAX_JOBS", config.batch_max_jobs));
+    config.frame_slots = static_cast<size_t>(readEnvUnsigned("MTA_FRAME_SLOTS", config.frame_slots));
+    config.max_frame_bytes = static_cast<size_t>(readEnvUnsigned("MTA_MAX_FRAME_BYTES", config.max_frame_bytes));
+    config.pool_free_bytes = static_cast<size_t>(readEnvUnsigned("MTA_POOL_FREE_BYTES", config.pool_free_bytes));
+    config.session_pool = static_cast<size_t>(readEnvUnsigned("MTA_SESSION_POOL", config.session_pool));
+    config.secure_arena_bytes = static_cast<size_t>(readEnvUnsigned("MTA_SECURE_ARENA_BYTES", config.secure_arena_bytes));
+    config.precompute_path = readEnvString("MTA_PRECOMPUTE_PATH", config.precompute_path);
+    config.precompute_key = readEnvString("MTA_PRECOMPUTE_KEY", config.precompute_key);
+    config.result_journal_path = readEnvString("MTA_RESULT_JOURNAL_PATH", config.result_journal_path);
+    config.result_journal_records = readEnvUnsigned("MTA_RESULT_JOURNAL_RECORDS", config.result_journal_records);
+    config.result_journal_commit_ms = static_cast<uint32_t>(
+        readEnvUnsigned("MTA_RESULT_JOURNAL_COMMIT_MS", config.result_journal_commit_ms));
+    config.capture_path = readEnvString("MTA_CAPTURE_PATH", config.capture_path);
+    config.trace_path = readEnvString("MTA_TRACE_PATH", config.trace_path);
+    config.trace_sample = static_cast<uint32_t>(readEnvUnsigned("MTA_TRACE_SAMPLE", config.trace_sample));
+    return config;
+}
@@ -0,0 +1,117 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+// Tunables for MTAServer; fromEnvironment() overrides them from MTA_*
+// variables. The defaults keep one IO thread and one acceptor, but differ
+// from the historical server in what they enforce:
+//   - a client has 10 s for its first frame and 30 s for each later frame
+//     and each write, where it could previously stall a session forever
+//   - admission control admits everyone while max_sessions is 0, but once
+//     a limit is set its defaults apply: up to 1024 connections wait, and
+//     CoDel sends them the busy frame once queueing delay stays above 5 ms
+//     for 100 ms
+//   - frames announcing more than 64 KB of payload close the session
+//   - sessions, frame buffers and receive slots are pooled and reused, so a
+//     closed session's memory is kept rather than freed
+//   - 1 MB of secure arena is mapped and mlock'd at startup
+struct ServerConfig {
+    // Listening: number of acceptor shards (one IO thread each), outstanding
+    // async_accepts per shard, and SO_REUSEPORT for running several server
+    // processes on one port (MTA_ACCEPTOR_SHARDS, MTA_ACCEPTS_PER_SHARD,
+    // MTA_REUSE_PORT, MTA_LISTEN_BACKLOG). Shards > 1 always use SO_REUSEPORT.
+    size_t acceptor_shards = 1;
+    size_t accepts_per_shard = 4;
+    bool reuse_port = false;
+    int listen_backlog = 1024;
+
+    // Co-located clients: AF_UNIX stream listener and shared-memory ring
+    // rendezvous socket, both off when empty (MTA_UNIX_PATH, MTA_SHM_PATH,
+    // MTA_SHM_RING_BYTES)
+    std::string unix_path;
+    std::string shm_path;
+    size_t shm_ring_bytes = 64 * 1024;
+
+    // Prometheus scrape endpoint (GET /metrics) on its own port; disabled
+    // when negative, 0 picks an ephemeral port. It listens on loopback
+    // unless given another local address (MTA_ADMIN_PORT, MTA_ADMIN_ADDRESS)
+    int admin_port = -1;
+    std::string admin_address = "127.0.0.1";
+
+    // Admission control per shard: concurrent sessions (0 = unlimited), the
+    // queue of accepted connections waiting for one, concurrent point-batch
+    // jobs (0 = unlimited), and CoDel shedding of queued connections once
+    // queueing delay stays above the target for an interval; a zero target
+    // disables shedding (MTA_MAX_SESSIONS, MTA_ACCEPT_QUEUE,
+    // MTA_MAX_CRYPTO_JOBS, MTA_SHED_TARGET_US, MTA_SHED_INTERVAL_US)
+    size_t max_sessions = 0;
+    size_t accept_queue = 1024;
+    size_t max_crypto_jobs = 0;
+    uint32_t shed_target_us = 5000;
+    uint32_t shed_interval_us = 100000;
+
+    // Session deadlines, kept on a timing wheel per IO thread that advances
+    // every timer_tick_ms: the first frame, each later frame, and each write;
+    // 0 disables one (MTA_IDLE_TIMEOUT_MS, MTA_READ_TIMEOUT_MS,
+    // MTA_WRITE_TIMEOUT_MS, MTA_TIMER_TICK_MS)
+    uint32_t idle_timeout_ms = 10000;
+    uint32_t read_timeout_ms = 30000;
+    uint32_t write_timeout_ms = 30000;
+    uint32_t timer_tick_ms = 100;
+
+    // EC batch scheduler (MTA_BATCH_WINDOW_US, MTA_BATCH_MAX_JOBS)
+    uint32_t batch_window_us = 0;
+    size_t batch_max_jobs = 64;
+
+    // Pooled 8 KB receive slots per io_context, registered with io_uring when
+    // built with MTA_USE_IO_URING, lent to sessions one frame at a time
+    // (MTA_FRAME_SLOTS)
+    size_t frame_slots = 256;
+
+    // Largest frame payload a client may announce; the session is closed
+    // otherwise. Frames that do not fit a slot are read into buffers from
+    // per-thread size-class pools, each keeping up to pool_free_bytes of
+    // returned buffers per class (MTA_MAX_FRAME_BYTES, MTA_POOL_FREE_BYTES)
+    size_t max_frame_bytes = 64 * 1024;
+    size_t pool_free_bytes = 1024 * 1024;
+
+    // Sessions preconstructed per shard; closed sessions are reset and kept
+    // for reuse up to this many (MTA_SESSION_POOL)
+    size_t session_pool = 64;
+
+    // Size of each region of the secure arena, the mlock'd memory that holds
+    // setup scalars and shares; reserved at startup, and another region is
+    // mapped only once a region is used up (MTA_SECURE_ARENA_BYTES)
+    size_t secure_arena_bytes = 1024 * 1024;
+
+    // Store of precomputed setup scalars and points, filled by
+    // mta_precompute and sealed with a 32-byte hex key; sessions draw from
+    // it and generate their points live once it is used up. Off when
+    // empty (MTA_PRECOMPUTE_PATH, MTA_PRECOMPUTE_KEY)
+    std::string precompute_path;
+    std::string precompute_key;
+
+    // Journal of completed sessions' additive shares and correlation checks
+    // for the signing service, read with mta_results: a pre-allocated ring of
+    // `result_journal_records` memory-mapped records, synced to disk every
+    // result_journal_commit_ms in one batch. Off when empty
+    // (MTA_RESULT_JOURNAL_PATH, MTA_RESULT_JOURNAL_RECORDS,
+    // MTA_RESULT_JOURNAL_COMMIT_MS)
+    std::string result_journal_path;
+    uint64_t result_journal_records = 1024 * 1024;
+    uint32_t result_journal_commit_ms = 10;
+
+    // Records every frame of every session to this file for mta_replay; off
+    // when empty (MTA_CAPTURE_PATH)
+    std::string capture_path;
+
+    // Per-session span timelines, written as Chrome trace JSON to this path on
+    // SIGUSR2; one session in `trace_sample` per IO thread is traced. Off when
+    // empty (MTA_TRACE_PATH, MTA_TRACE_SAMPLE)
+    std::string trace_path;
+    uint32_t trace_sample = 100;
+
+    static ServerConfig fromEnvironment();
+};
@@ -0,0 +1,147 @@
+#include "timing_wheel.h"
+#include <algorithm>
+
+TimingWheel::TimingWheel(boost::asio::io_context& io_context, std::chrono::milliseconds tick)
+    : ticker_(io_context),
+      tick_(std::max(std::chrono::duration_cast<Clock::duration>(tick), Clock::duration(1))),
+      origin_(Clock::now()),
+      ticking_(false),
+      now_(0),
+      size_(0) {
+    for (auto& level : slots_) {
+        for (Timer& head : level) {
+            head.prev_ = &head;
+            head.next_ = &head;
+        }
+    }
+}
+
+TimingWheel::~TimingWheel() {
+    // Leave owners' timers unscheduled rather than pointing into freed heads
+    for (auto& level : slots_) {
+        for (Timer& head : level) {
+            while (head.next_ != &head) {
+                unlink(*head.next_);
+            }
+        }
+    }
+}
+
+void TimingWheel::unlink(Timer& timer) {
+    timer.prev_->next_ = timer.next_;
+    timer.next_->prev_ = timer.prev_;
+    timer.prev_ = nullptr;
+    timer.next_ = nullptr;
+}
+
+void TimingWheel::append(Timer& head, Timer& timer) {
+    timer.prev_ = head.prev_;
+    timer.next_ = &head;
+    head.prev_->next_ = &timer;
+    head.prev_ = &timer;
+}
+
+uint64_t TimingWheel::clock_tick() const {
+    return static_cast<uint64_t>((Clock::now() - origin_) / tick_);
+}
+
+void TimingWheel::schedule(Timer& timer, std::chrono::milliseconds timeout, Callback callback, void* context) {
+    cancel(timer);
+    if (size_ == 0) {
+        // Nothing pending, so the wheel can jump to the present
+        now_ = clock_tick();
+    }
+
+    Clock::duration delay = std::chrono::duration_cast<Clock::duration>(timeout);
+    uint64_t ticks = static_cast<uint64_t>((delay + tick_ - Clock::duration(1)) / tick_);
+    timer.expiry_ = now_ + std::max<uint64_t>(ticks, 1);
+    timer.callback_ = callback;
+    timer.context_ = context;
+    insert(timer);
+    size_++;
+
+    if (!ticking_) {
+        start_ticking();
+    }
+}
+
+void TimingWheel::cancel(Timer& timer) {
+    if (!timer.scheduled()) {
+        return;
+    }
+    unlink(timer);
+    size_--;
+}
+
+void TimingWheel::insert(Timer& timer) {
+    uint64_t delta = timer.expiry_ > now_ ? timer.expiry_ - now_ : 0;
+    int level = 0;
+    while (level + 1 < LEVELS && delta >= (uint64_t(1) << (SLOT_BITS * (level + 1)))) {
+        level++;
+    }
+    // Beyond the wheel's range: park in the top level's furthest slot and
+    // let cascading bring it down as time passes
+    uint64_t expiry = std::min(timer.expiry_, now_ + (uint64_t(1) << (SLOT_BITS * LEVELS)) - 1);
+    append(slots_[level][(expiry >> (SLOT_BITS * level)) & SLOT_MASK], timer);
+}
+
+void TimingWheel::cascade(int level) {
+    Timer& head = slots_[level][(now_ >> (SLOT_BITS * level)) & SLOT_MASK];
+    while (head.next_ != &head) {
+        Timer& timer = *head.next_;
+        unlink(timer);
+        insert(timer);
+    }
+}
+
+void TimingWheel::advance() {
+    now_++;
+    for (int level = 1; level < LEVELS; level++) {
+        if (((now_ >> (SLOT_BITS * (level - 1))) & SLOT_MASK) != 0) {
+            break;
+        }
+        cascade(level);
+    }
+
+    // Detach the due slot first: callbacks may schedule or cancel timers
+    Timer& head = slots_[0][now_ & SLOT_MASK];
+    Timer due;
+    due.prev_ = &due;
+    due.next_ = &due;
+    while (head.next_ != &head) {
+        Timer& timer = *head.next_;
+        unlink(timer);
+        append(due, timer);
+    }
+    while (due.next_ != &due) {
+        Timer& timer = *due.next_;
+        unlink(timer);
+        size_--;
+        timer.callback_(timer.context_);
+    }
+}
+
+void TimingWheel::start_ticking() {
+    ticking_ = true;
+    ticker_.expires_at(origin_ + tick_ * static_cast<Clock::rep>(now_ + 1));
+    ticker_.async_wait([this](boost::system::error_code ec) {
+        if (ec) {
+            ticking_ = false;
+            return;
+        }
+        on_tick();
+    });
+}
+
+void TimingWheel::on_tick() {
+    // Catch up on ticks missed while the reactor was busy
+    uint64_t target = clock_tick();
+    while (now_ < target && size_ > 0) {
+        advance();
+    }
+    if (size_ == 0) {
+        ticking_ = false;
+        return;
+    }
+    start_ticking();
+}
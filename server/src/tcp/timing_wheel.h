@@ -0,0 +1,100 @@
+#pragma once
+
+#include <boost/asio.hpp>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+
+// Hierarchical timing wheel for the deadlines of one IO thread's sessions.
+//
+// Four levels of 64 slots, each level 64 times coarser than the one below,
+// cover 2^24 ticks. Timers are intrusive list nodes embedded in their owner,
+// so scheduling and cancelling are O(1) and never allocate. One steady_timer
+// drives the whole wheel and only runs while timers are pending; each tick
+// fires one level-0 slot and, every 64 ticks, redistributes one slot of the
+// level above. Deadlines are rounded up to whole ticks.
+class TimingWheel {
+public:
+    using Clock = std::chrono::steady_clock;
+    using Callback = void (*)(void* context);
+
+    // Embedded in the owner; must stay put while scheduled
+    class Timer {
+    public:
+        Timer() = default;
+        Timer(const Timer&) = delete;
+        Timer& operator=(const Timer&) = delete;
+
+        bool scheduled() const { return next_ != nullptr; }
+
+    private:
+        friend class TimingWheel;
+
+        Timer* prev_ = nullptr;
+        Timer* next_ = nullptr;
+        uint64_t expiry_ = 0;
+        Callback callback_ = nullptr;
+        void* context_ = nullptr;
+    };
+
+    TimingWheel(boost::asio::io_context& io_context, std::chrono::milliseconds tick);
+    ~TimingWheel();
+
+    TimingWheel(const TimingWheel&) = delete;
+    TimingWheel& operator=(const TimingWheel&) = delete;
+
+    // Reschedules if already scheduled. `callback` runs on the wheel's thread.
+    void schedule(Timer& timer, std::chrono::milliseconds timeout, Callback callback, void* context);
+    void cancel(Timer& timer);
+
+    size_t size() const { return size_; }
+
+private:
+    static const int LEVELS = 4;
+    static const int SLOT_BITS = 6;
+    static const uint64_t SLOTS = uint64_t(1) << SLOT_BITS;
+    static const uint64_t SLOT_MASK = SLOTS - 1;
+
+    static void unlink(Timer& timer);
+    static void append(Timer& head, Timer& timer);
+
+    uint64_t clock_tick() const;
+    void insert(Timer& timer);
+    void cascade(int level);
+    void advance();
+    void start_ticking();
+    void on_tick();
+
+    boost::asio::steady_timer ticker_;
+    Clock::duration tick_;
+    Clock::time_point origin_;
+    bool ticking_;
+    uint64_t now_;
+    size_t size_;
+    Timer slots_[LEVELS][SLOTS];    // list heads
+};
+
+// Arms `timer` for the lifetime of the scope, e.g. for one frame read
+class ScopedDeadline {
+public:
+    ScopedDeadline(TimingWheel& wheel, TimingWheel::Timer& timer, std::chrono::milliseconds timeout,
+                   TimingWheel::Callback callback, void* context)
+        : wheel_(timeout.count() > 0 ? &wheel : nullptr), timer_(timer) {
+        if (wheel_ != nullptr) {
+            wheel_->schedule(timer_, timeout, callback, context);
+        }
+    }
+
+    ~ScopedDeadline() {
+        if (wheel_ != nullptr) {
+            wheel_->cancel(timer_);
+        }
+    }
+
+    ScopedDeadline(const ScopedDeadline&) = delete;
+    ScopedDeadline& operator=(const ScopedDeadline&) = delete;
+
+private:
+    TimingWheel* wheel_;
+    TimingWheel::Timer& timer_;
+};
@@ -0,0 +1,382 @@
+// Micro-benchmarks for the kernels an MtA session spends its time in: EC
+// point generation and ECDH, scalar sampling, the COT setup and
+// multiplication, and the nanopb codecs for each wire message. Runs entirely
+// in-process, no sockets.
+//
+// The codec/*/per_mta cases encode and decode all four messages of one MtA
+// as the wire carries them, once with protobuf and once with BinaryCodec.
+//
+// Usage: mta_bench [--json] [--seed N] [--filter SUBSTRING] [--min-time MS]
+//                  [--max-allocs N]
+//
+// --seed installs a deterministic SecureRandom source so that every run
+// feeds the kernels identical inputs. --max-allocs is an allocation budget:
+// when any selected case averages more than N heap allocations per op, the
+// exit status is 4.
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+#include "mta_protocol.h"
+#include "cot_protocol.h"
+#include "protobuf_handler.h"
+#include "crypto_operations.h"
+#include "random_generator.h"
+#include "logger.h"
+#include "alloc_tracker.h"
+#include "binary_codec.h"
+
+extern "C" {
+    #include "trezor-crypto/sha2.h"
+}
+
+static uint64_t deterministic_seed = 0;
+static std::atomic<uint64_t> deterministic_counter{0};
+
+// SHA-256 in counter mode over --seed: block = SHA-256(seed || counter),
+// both little-endian. Predictable by construction, so it lives here and not
+// in SecureRandom.
+static void deterministicRandom(uint8_t* out, size_t length) {
+    while (length > 0) {
+        uint8_t input[16];
+        uint64_t counter = deterministic_counter.fetch_add(1, std::memory_order_relaxed);
+        for (int i = 0; i < 8; i++) {
+            input[i] = static_cast<uint8_t>(deterministic_seed >> (8 * i));
+            input[8 + i] = static_cast<uint8_t>(counter >> (8 * i));
+        }
+        uint8_t block[SHA256_DIGEST_LENGTH];
+        sha256_Raw(input, sizeof(input), block);
+
+        size_t take = length < sizeof(block) ? length : sizeof(block);
+        std::memcpy(out, block, take);
+        out += take;
+        length -= take;
+    }
+}
+
+struct BenchResult {
+    std::string name;
+    uint64_t iterations;
+    double ns_per_op;
+    double allocs_per_op;
+};
+
+// Doubles the batch size until one batch runs for at least min_time, then
+// reports that batch
+static BenchResult runBenchmark(const std::string& name, const std::function<void()>& body,
+                                std::chrono::milliseconds min_time) {
+    using Clock = std::chrono::steady_clock;
+
+    body();  // warm caches and lazily built tables
+
+    uint64_t iterations = 1;
+    for (;;) {
+        // This thread only: the logger's sink thread allocates too
+        uint64_t allocations_before = AllocTracker::thisThread().allocations;
+        Clock::time_point start = Clock::now();
+        for (uint64_t i = 0; i < iterations; i++) {
+            body();
+        }
+        Clock::duration elapsed = Clock::now() - start;
+        uint64_t allocations = AllocTracker::thisThread().allocations - allocations_before;
+
+        if (elapsed >= min_time || iterations >= (uint64_t(1) << 40)) {
+            double ns = static_cast<double>(std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count());
+            return {name, iterations, ns / iterations, static_cast<double>(allocations) / iterations};
+        }
+        iterations *= 2;
+    }
+}
+
+// Keeps the optimiser from discarding a result
+template <typename T>
+static void keep(const T& value) {
+    asm volatile("" : : "g"(&value) : "memory");
+}
+
+struct BenchCase {
+    std::string name;
+    std::function<void()> body;
+};
+
+static std::vector<BenchCase> buildCases() {
+    std::vector<BenchCase> cases;
+
+    auto crypto_ops = std::make_shared<CryptoOperations>();
+    auto scalars = std::make_shared<std::vector<uint8_t>>(32 * 32);
+    auto points = std::make_shared<std::vector<uint8_t>>(32 * 65);
+    for (int i = 0; i < 32; i++) {
+        crypto_ops->generateRandomScalar(&(*scalars)[i * 32]);
+    }
+    crypto_ops->generatePointsFromScalars(scalars->data(), 32, points->data());
+
+    cases.push_back({"ec/generate_point_from_scalar", [=]() {
+        uint8_t point[65];
+        crypto_ops->generatePointFromScalar(scalars->data(), point);
+        keep(point);
+    }});
+
+    cases.push_back({"ec/generate_points_from_scalars_x32", [=]() {
+        crypto_ops->generatePointsFromScalars(scalars->data(), 32, points->data());
+        keep(points->data());
+    }});
+
+    auto compressed = std::make_shared<std::vector<uint8_t>>(32 * 33);
+    CryptoOperations::compressPoints(points->data(), 32, compressed->data());
+    cases.push_back({"ec/decompress_points_x32", [=]() {
+        CryptoOperations::decompressPoints(compressed->data(), 32, points->data());
+        keep(points->data());
+    }});
+
+    cases.push_back({"ec/perform_ecdh", [=]() {
+        uint8_t shared_secret[32];
+        crypto_ops->performECDH(scalars->data(), points->data() + 65, shared_secret);
+        keep(shared_secret);
+    }});
+
+    auto secure_random = std::make_shared<SecureRandom>();
+    cases.push_back({"rng/generate_scalar", [=]() {
+        uint8_t scalar[32];
+        secure_random->generateScalar(scalar);
+        keep(scalar);
+    }});
+
+    auto cot = std::make_shared<CorrelatedOTProtocol>();
+    cases.push_back({"cot/initialize_cot", [=]() {
+        CorrelatedOTProtocol::COTSetup setup = cot->initializeCOT(12345, 0xA5A5A5A5);
+        keep(setup);
+    }});
+
+    // Alice's side as the bench sends it: valid points, random pads
+    auto alice = std::make_shared<MTAProtocol::AliceMessages>();
+    alice->success = true;
+    alice->masked_share = crypto_ops->generateRandomUint32();
+    alice->points_A = *points;
+    alice->encrypted_m0_messages.resize(32 * 32);
+    alice->encrypted_m1_messages.resize(32 * 32);
+    for (int i = 0; i < 32; i++) {
+        crypto_ops->generateRandomScalar(&alice->encrypted_m0_messages[i * 32]);
+        crypto_ops->generateRandomScalar(&alice->encrypted_m1_messages[i * 32]);
+    }
+
+    auto multiplying_cot = std::make_shared<CorrelatedOTProtocol>();
+    multiplying_cot->initializeCOT(12345, 0xA5A5A5A5);
+    cases.push_back({"cot/execute_cot_multiplication", [=]() {
+        CorrelatedOTProtocol::COTResult result = multiplying_cot->executeCOTMultiplication(
+            0xA5A5A5A5, alice->points_A, alice->encrypted_m0_messages, alice->encrypted_m1_messages);
+        keep(result);
+    }});
+
+    auto protobuf_handler = std::make_shared<MTAProtobufHandler>();
+    auto mta_protocol = std::make_shared<MTAProtocol>();
+
+    // CorrelationDelta
+    auto delta_bytes = std::make_shared<std::vector<uint8_t>>(protobuf_handler->serializeCorrelationDelta(12345));
+    cases.push_back({"pb/correlation_delta/encode", [=]() {
+        std::vector<uint8_t> bytes = protobuf_handler->serializeCorrelationDelta(12345);
+        keep(bytes);
+    }});
+    cases.push_back({"pb/correlation_delta/decode", [=]() {
+        uint32_t delta = 0;
+        protobuf_handler->deserializeCorrelationDelta(*delta_bytes, delta);
+        keep(delta);
+    }});
+
+    // BobSetup, through the same MTAProtocol helpers a client uses
+    auto setup = std::make_shared<MTAProtocol::BobSetup>();
+    setup->success = true;
+    setup->correlation_delta = 12345;
+    setup->num_ot_instances = 32;
+    setup->points_B = *points;
+    auto setup_bytes = std::make_shared<std::vector<uint8_t>>(mta_protocol->serializeBobSetup(*setup));
+    cases.push_back({"pb/bob_setup/encode", [=]() {
+        std::vector<uint8_t> bytes = mta_protocol->serializeBobSetup(*setup);
+        keep(bytes);
+    }});
+    cases.push_back({"pb/bob_setup/decode", [=]() {
+        MTAProtocol::BobSetup decoded;
+        mta_protocol->deserializeBobSetup(*setup_bytes, decoded);
+        keep(decoded);
+    }});
+
+    // AliceMessages: the nanopb schema, plus the fixed layout the server
+    // actually reads off the wire
+    auto choices = std::make_shared<std::vector<bool>>(32);
+    auto shares = std::make_shared<std::vector<std::vector<uint8_t>>>(
+        mta_protocol->splitIntoByteVectors(alice->encrypted_m0_messages, 32));
+    for (int i = 0; i < 32; i++) {
+        (*choices)[i] = (0xA5A5A5A5u >> i) & 1;
+    }
+    auto alice_pb_bytes = std::make_shared<std::vector<uint8_t>>(protobuf_handler->serializeAliceMessages(
+        protobuf_handler->createAliceMessages(alice->masked_share, *choices, *shares)));
+    cases.push_back({"pb/alice_messages/encode", [=]() {
+        mta_AliceMessages messages = protobuf_handler->createAliceMessages(alice->masked_share, *choices, *shares);
+        std::vector<uint8_t> bytes = protobuf_handler->serializeAliceMessages(messages);
+        keep(bytes);
+    }});
+    cases.push_back({"pb/alice_messages/decode", [=]() {
+        mta_AliceMessages messages;
+        protobuf_handler->deserializeAliceMessages(*alice_pb_bytes, messages);
+        keep(messages);
+    }});
+
+    auto alice_wire_bytes = std::make_shared<std::vector<uint8_t>>(mta_protocol->serializeAliceMessages(*alice));
+    cases.push_back({"wire/alice_messages/encode", [=]() {
+        std::vector<uint8_t> bytes = mta_protocol->serializeAliceMessages(*alice);
+        keep(bytes);
+    }});
+    cases.push_back({"wire/alice_messages/decode", [=]() {
+        MTAProtocol::AliceMessages decoded;
+        mta_protocol->deserializeAliceMessages(*alice_wire_bytes, decoded);
+        keep(decoded);
+    }});
+
+    auto alice_compressed_bytes = std::make_shared<std::vector<uint8_t>>(
+        mta_protocol->serializeAliceMessages(*alice, MTAProtocol::FEATURE_COMPRESSED_POINTS));
+    cases.push_back({"wire/alice_messages/decode_compressed", [=]() {
+        MTAProtocol::AliceMessages decoded;
+        mta_protocol->deserializeAliceMessages(*alice_compressed_bytes, decoded, MTAProtocol::FEATURE_COMPRESSED_POINTS);
+        keep(decoded);
+    }});
+
+    // BobMessages as the server fills it: no OT responses, scalar fields set
+    auto bob = std::make_shared<MTAProtocol::BobMessages>();
+    bob->success = true;
+    bob->masked_share = 0xDEADBEEF;
+    auto bob_bytes = std::make_shared<std::vector<uint8_t>>(mta_protocol->serializeBobMessages(*bob));
+    cases.push_back({"pb/bob_messages/encode", [=]() {
+        std::vector<uint8_t> bytes = mta_protocol->serializeBobMessages(*bob);
+        keep(bytes);
+    }});
+    cases.push_back({"pb/bob_messages/decode", [=]() {
+        mta_BobMessages messages;
+        protobuf_handler->deserializeBobMessages(*bob_bytes, messages);
+        keep(messages);
+    }});
+
+    // One MtA's worth of codec work in each wire format
+    cases.push_back({"codec/protobuf/per_mta", [=]() {
+        uint32_t delta = 0;
+        protobuf_handler->deserializeCorrelationDelta(protobuf_handler->serializeCorrelationDelta(12345), delta);
+        MTAProtocol::BobSetup decoded_setup;
+        mta_protocol->deserializeBobSetup(mta_protocol->serializeBobSetup(*setup), decoded_setup);
+        MTAProtocol::AliceMessages decoded_alice;
+        mta_protocol->deserializeAliceMessages(mta_protocol->serializeAliceMessages(*alice), decoded_alice);
+        mta_BobMessages decoded_bob;
+        protobuf_handler->deserializeBobMessages(mta_protocol->serializeBobMessages(*bob), decoded_bob);
+        keep(delta);
+        keep(decoded_setup);
+        keep(decoded_alice);
+        keep(decoded_bob);
+    }});
+    cases.push_back({"codec/binary/per_mta", [=]() {
+        std::vector<uint8_t> bytes;
+        uint32_t delta = 0;
+        uint32_t features = 0;
+        BinaryCodec::encodeCorrelationDelta(12345, 0, bytes);
+        BinaryCodec::decodeCorrelationDelta(bytes, delta, features);
+        MTAProtocol::BobSetup decoded_setup;
+        BinaryCodec::encodeBobSetup(*setup, bytes);
+        BinaryCodec::decodeBobSetup(bytes, decoded_setup);
+        MTAProtocol::AliceMessages decoded_alice;
+        BinaryCodec::encodeAliceMessages(*alice, 0, bytes);
+        BinaryCodec::decodeAliceMessages(bytes, 0, decoded_alice);
+        MTAProtocol::BobMessages decoded_bob;
+        BinaryCodec::encodeBobMessages(*bob, bytes);
+        BinaryCodec::decodeBobMessages(bytes, decoded_bob);
+        keep(delta);
+        keep(decoded_setup);
+        keep(decoded_alice);
+        keep(decoded_bob);
+    }});
+
+    return cases;
+}
+
+static void printUsage(const char* program) {
+    std::fprintf(stderr, "Usage: %s [--json] [--seed N] [--filter SUBSTRING] [--min-time MS] [--max-allocs N]\n",
+                 program);
+}
+
+int main(int argc, char* argv[]) {
+    bool json = false;
+    bool deterministic = false;
+    uint64_t seed = 0;
+    std::string filter;
+    std::chrono::milliseconds min_time(200);
+    double max_allocs = -1;
+
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "--json") {
+            json = true;
+        } else if (arg == "--seed" && i + 1 < argc) {
+            deterministic = true;
+            seed = std::strtoull(argv[++i], nullptr, 10);
+        } else if (arg == "--filter" && i + 1 < argc) {
+            filter = argv[++i];
+        } else if (arg == "--min-time" && i + 1 < argc) {
+            min_time = std::chrono::milliseconds(std::strtoul(argv[++i], nullptr, 10));
+        } else if (arg == "--max-allocs" && i + 1 < argc) {
+            max_allocs = std::strtod(argv[++i], nullptr);
+        } else {
+            printUsage(argv[0]);
+            return 1;
+        }
+    }
+
+    // Before any fixture draws randomness
+    if (deterministic) {
+        deterministic_seed = seed;
+        SecureRandom::setSource(deterministicRandom);
+    }
+    Logger::setLevel(LogLevel::WARN);
+
+    std::vector<BenchResult> results;
+    for (const BenchCase& bench_case : buildCases()) {
+        if (!filter.empty() && bench_case.name.find(filter) == std::string::npos) {
+            continue;
+        }
+        results.push_back(runBenchmark(bench_case.name, bench_case.body, min_time));
+        if (!json) {
+            const BenchResult& result = results.back();
+            std::printf("%-40s %12.1f ns/op %8.2f allocs/op %14.1f ops/s\n",
+                        result.name.c_str(), result.ns_per_op, result.allocs_per_op, 1e9 / result.ns_per_op);
+            std::fflush(stdout);
+        }
+    }
+
+    if (json) {
+        std::printf("{\n  \"deterministic\": %s,\n  \"seed\": %llu,\n  \"benchmarks\": [\n",
+                    deterministic ? "true" : "false", static_cast<unsigned long long>(seed));
+        for (size_t i = 0; i < results.size(); i++) {
+            const BenchResult& result = results[i];
+            std::printf("    {\"name\": \"%s\", \"iterations\": %llu, \"ns_per_op\": %.1f, "
+                        "\"allocs_per_op\": %.2f, \"ops_per_sec\": %.1f}%s\n",
+                        result.name.c_str(), static_cast<unsigned long long>(result.iterations),
+                        result.ns_per_op, result.allocs_per_op, 1e9 / result.ns_per_op,
+                        i + 1 < results.size() ? "," : "");
+        }
+        std::printf("  ]\n}\n");
+    }
+
+    int status = 0;
+    if (max_allocs >= 0) {
+        for (const BenchResult& result : results) {
+            if (result.allocs_per_op > max_allocs) {
+                std::fprintf(stderr, "%s: %.2f allocs/op exceeds the budget of %g\n",
+                             result.name.c_str(), result.allocs_per_op, max_allocs);
+                status = 4;
+            }
+        }
+    }
+
+    Logger::flush();
+    return status;
+}
@@ -0,0 +1,762 @@
+// Load generator for tcp_server: runs the native Alice over N concurrent
+// loopback connections, one MtA per connection as the server expects, and
+// reports throughput and latency percentiles. Every session is verified:
+// Alice's share plus Bob's share must equal x*y mod 2^32, and no throughput
+// is reported if any session fails that check. Bob's share never leaves the
+// server on the wire, so it is read from the server's result journal
+// (--journal, MTA_RESULT_JOURNAL_PATH) or from its debug log (--server-log).
+// The journal is only read: its consumed cursor belongs to the downstream
+// reader.
+//
+// Closed loop (default): each connection starts its next MtA as soon as the
+// previous one finishes, optionally paced so all connections together aim
+// at --rate. Open loop: MtAs arrive at --rate regardless of completions and
+// queue for a free connection. In both cases latency is measured from the
+// intended start, so queueing behind a slow server is counted. Sessions the
+// server turns away with its busy frame are counted separately and excluded
+// from the latencies.
+//
+// Usage: mta_loadgen --y Y [--host H] [--port P] [--connections N]
+//                    [--threads T] [--mode closed|open] [--rate R]
+//                    [--duration S] [--sessions M] [--compressed] [--binary]
+//                    [--streamed] [--interleaved] [--json]
+//                    (--journal FILE | --server-log FILE)
+//
+// Y must be the multiplicative share tcp_server was started with. For
+// --server-log, the server must log at debug level (a build without NDEBUG,
+// MTA_LOG_LEVEL=debug) with its standard output going to FILE.
+// --compressed offers 33-byte compressed points to the server, and --binary
+// uses the fixed-layout binary codec instead of protobuf. --streamed offers
+// the chunked setup, answering each chunk of Bob's setup as it arrives, and
+// --interleaved sends Alice's messages as per-instance records.
+
+#include <boost/asio.hpp>
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+#include "alice_mta_protocol.h"
+#include "crypto_operations.h"
+#include "logger.h"
+#include "result_journal.h"
+
+using boost::asio::ip::tcp;
+using Clock = std::chrono::steady_clock;
+
+struct LoadgenOptions {
+    std::string host = "127.0.0.1";
+    unsigned short port = 8080;
+    uint32_t y_share = 0;
+    bool have_y = false;
+    size_t connections = 16;
+    size_t threads = 1;
+    bool open_loop = false;
+    double rate = 0;            // MtA/s, 0 = unpaced (closed loop only)
+    double duration_s = 0;
+    uint64_t sessions = 0;
+    bool compressed_points = false;
+    bool binary_codec = false;
+    bool streamed_setup = false;
+    bool interleaved_messages = false;
+    std::string journal_path;   // server's result journal, for verification
+    std::string log_path;       // or the server's debug log
+    bool json = false;
+};
+
+struct ThreadStats {
+    std::vector<uint64_t> latencies_ns;
+    uint64_t completed = 0;
+    uint64_t failed = 0;        // I/O or protocol errors
+    uint64_t busy = 0;          // turned away by the server's admission control
+};
+
+enum class SessionOutcome {
+    COMPLETED,
+    FAILED,
+    BUSY,
+};
+
+// Matches each session with Bob's result as the server reported it. A
+// result's correlation check is (y + share_B) ^ delta, so it names its
+// session by the delta, which is kept unique among sessions in flight.
+// Results of other clients match no session and are skipped.
+class ShareVerifier {
+public:
+    explicit ShareVerifier(uint32_t y_share) : y_share_(y_share) {}
+
+    // A correlation delta no session in flight uses
+    uint32_t reserve(CryptoOperations& crypto_ops) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        for (;;) {
+            uint32_t delta = crypto_ops.generateRandomUint32();
+            if (sessions_.emplace(delta, Pending()).second) {
+                return delta;
+            }
+        }
+    }
+
+    // The session ended without a result
+    void release(uint32_t delta) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        sessions_.erase(delta);
+    }
+
+    // Alice's side completed; Bob's share must be `bob_share`
+    void expect(uint32_t delta, uint32_t bob_share) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto it = sessions_.find(delta);
+        if (it == sessions_.end()) {
+            return;
+        }
+        it->second.expected = true;
+        it->second.expected_share = bob_share;
+        settle(it);
+    }
+
+    // The server reported a result
+    void reported(uint32_t additive_share, uint32_t correlation_check) {
+        uint32_t delta = correlation_check ^ (y_share_ + additive_share);
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto it = sessions_.find(delta);
+        if (it != sessions_.end()) {
+            it->second.reported = true;
+            it->second.reported_share = additive_share;
+            settle(it);
+        }
+    }
+
+    // Sessions Alice completed whose result has not been seen yet
+    uint64_t outstanding() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return static_cast<uint64_t>(std::count_if(sessions_.begin(), sessions_.end(),
+                                                   [](const auto& entry) { return entry.second.expected; }));
+    }
+
+    uint64_t verified() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return verified_;
+    }
+
+    uint64_t mismatched() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return mismatched_;
+    }
+
+private:
+    struct Pending {
+        bool expected = false;
+        uint32_t expected_share = 0;
+        bool reported = false;
+        uint32_t reported_share = 0;
+    };
+
+    // Checks a session once both sides are known; under mutex_
+    void settle(std::unordered_map<uint32_t, Pending>::iterator it) {
+        const Pending& pending = it->second;
+        if (!pending.expected || !pending.reported) {
+            return;
+        }
+        if (pending.expected_share == pending.reported_share) {
+            verified_++;
+        } else {
+            MTA_LOG_ERROR("shares do not reconstruct x*y: delta=%u bob=%u, expected %u",
+                          it->first, pending.reported_share, pending.expected_share);
+            mismatched_++;
+        }
+        sessions_.erase(it);
+    }
+
+    uint32_t y_share_;
+
+    std::mutex mutex_;
+    std::unordered_map<uint32_t, Pending> sessions_;    // by delta
+    uint64_t verified_ = 0;
+    uint64_t mismatched_ = 0;
+};
+
+// Where Bob's results are read from; polled from one thread
+class ResultSource {
+public:
+    virtual ~ResultSource() = default;
+    // Hands the results that appeared since the last poll to `verifier`
+    virtual void poll(ShareVerifier& verifier) = 0;
+    // For the report, e.g. "the result journal"
+    virtual const char* name() const = 0;
+};
+
+// Reads the records committed to the server's result journal after the run
+// started. It never calls consume(): the cursor is the downstream reader's,
+// and records that reader releases may be written over before we see them,
+// in which case their sessions stay unverified.
+class JournalSource : public ResultSource {
+public:
+    explicit JournalSource(std::unique_ptr<ResultJournal> journal)
+        : journal_(std::move(journal)),
+          next_(journal_->committed()) {}
+
+    void poll(ShareVerifier& verifier) override {
+        uint64_t end = journal_->committed();
+        if (end - next_ > journal_->capacity()) {
+            MTA_LOG_ERROR("result journal records %llu to %llu were written over before they were read",
+                          static_cast<unsigned long long>(next_),
+                          static_cast<unsigned long long>(end - journal_->capacity() - 1));
+            next_ = end - journal_->capacity();
+        }
+        for (; next_ < end; next_++) {
+            ResultJournal::Record record;
+            if (!journal_->read(next_, record)) {
+                MTA_LOG_ERROR("result journal record %llu is damaged or was written over",
+                              static_cast<unsigned long long>(next_));
+                continue;
+            }
+            verifier.reported(record.additive_share, record.correlation_check);
+        }
+    }
+
+    const char* name() const override {
+        return "the result journal";
+    }
+
+private:
+    std::unique_ptr<ResultJournal> journal_;
+    uint64_t next_;     // next sequence to read
+};
+
+// Follows the server's log from its end at startup, for the per-session
+// debug line "complete y=Y additive_share=S correlation_check=C"
+class ServerLogSource : public ResultSource {
+public:
+    static std::unique_ptr<ServerLogSource> open(const std::string& path) {
+        std::FILE* file = std::fopen(path.c_str(), "r");
+        if (file == nullptr || std::fseek(file, 0, SEEK_END) != 0) {
+            std::fprintf(stderr, "Cannot read server log %s: %s\n", path.c_str(), std::strerror(errno));
+            if (file != nullptr) {
+                std::fclose(file);
+            }
+            return nullptr;
+        }
+        return std::unique_ptr<ServerLogSource>(new ServerLogSource(file));
+    }
+
+    ~ServerLogSource() override {
+        std::fclose(file_);
+    }
+
+    void poll(ShareVerifier& verifier) override {
+        char chunk[4096];
+        size_t count;
+        while ((count = std::fread(chunk, 1, sizeof(chunk), file_)) > 0) {
+            pending_.append(chunk, count);
+        }
+        // Keep following the file past its current end
+        std::clearerr(file_);
+
+        size_t start = 0;
+        size_t end;
+        while ((end = pending_.find('\n', start)) != std::string::npos) {
+            std::string line = pending_.substr(start, end - start);
+            start = end + 1;
+            const char* found = std::strstr(line.c_str(), " complete y=");
+            unsigned int y;
+            unsigned int additive_share;
+            unsigned int correlation_check;
+            if (found != nullptr &&
+                std::sscanf(found, " complete y=%u additive_share=%u correlation_check=%u",
+                            &y, &additive_share, &correlation_check) == 3) {
+                verifier.reported(additive_share, correlation_check);
+            }
+        }
+        pending_.erase(0, start);
+    }
+
+    const char* name() const override {
+        return "the server log";
+    }
+
+private:
+    explicit ServerLogSource(std::FILE* file) : file_(file) {}
+
+    std::FILE* file_;
+    std::string pending_;   // a line not yet complete
+};
+
+static std::vector<uint8_t> withSizePrefix(const std::vector<uint8_t>& message) {
+    std::vector<uint8_t> frame(4 + message.size());
+    uint32_t size = static_cast<uint32_t>(message.size());
+    frame[0] = size & 0xFF;
+    frame[1] = (size >> 8) & 0xFF;
+    frame[2] = (size >> 16) & 0xFF;
+    frame[3] = (size >> 24) & 0xFF;
+    std::copy(message.begin(), message.end(), frame.begin() + 4);
+    return frame;
+}
+
+static boost::asio::awaitable<bool> readFrame(tcp::socket& socket, std::vector<uint8_t>& buffer) {
+    boost::system::error_code ec;
+    auto token = boost::asio::redirect_error(boost::asio::use_awaitable, ec);
+
+    uint8_t header[4];
+    co_await boost::asio::async_read(socket, boost::asio::buffer(header), token);
+    if (ec) {
+        co_return false;
+    }
+    uint32_t size = header[0] | (header[1] << 8) | (header[2] << 16) | (header[3] << 24);
+    buffer.resize(size);
+    co_await boost::asio::async_read(socket, boost::asio::buffer(buffer), token);
+    co_return !ec;
+}
+
+static boost::asio::awaitable<bool> writeFrame(tcp::socket& socket, const std::vector<uint8_t>& message) {
+    boost::system::error_code ec;
+    std::vector<uint8_t> frame = withSizePrefix(message);
+    co_await boost::asio::async_write(socket, boost::asio::buffer(frame),
+                                      boost::asio::redirect_error(boost::asio::use_awaitable, ec));
+    co_return !ec;
+}
+
+// The messages of one MtA, as Alice with input `x_share`
+static boost::asio::awaitable<SessionOutcome> exchangeMessages(tcp::socket& socket, AliceMTAProtocol& alice,
+                                                               uint32_t x_share, uint32_t delta,
+                                                               uint32_t& alice_share) {
+    if (!alice.initializeAsAlice(x_share)) {
+        co_return SessionOutcome::FAILED;
+    }
+
+    std::vector<uint8_t> frame;
+    MTAProtocol::BobSetup bob_setup;
+    if (!co_await writeFrame(socket, alice.serializeCorrelationDelta(delta)) ||
+        !co_await readFrame(socket, frame) ||
+        !alice.deserializeBobSetup(frame, bob_setup)) {
+        co_return SessionOutcome::FAILED;
+    }
+    // An unsuccessful BobSetup is the server's busy frame
+    if (!bob_setup.success) {
+        co_return SessionOutcome::BUSY;
+    }
+
+    if (alice.acceptedFeatures() & MTAProtocol::FEATURE_STREAMED_SETUP) {
+        // Answer each chunk before reading the next
+        uint32_t first = 0;
+        while (true) {
+            MTAProtocol::AliceMessages alice_chunk = alice.prepareAliceChunk(bob_setup, first);
+            if (!alice_chunk.success ||
+                !co_await writeFrame(socket, alice.serializeAliceMessages(alice_chunk))) {
+                co_return SessionOutcome::FAILED;
+            }
+            first += static_cast<uint32_t>(bob_setup.points_B.size() / 65);
+            if (first == AliceMTAProtocol::BIT_LENGTH) {
+                break;
+            }
+            if (!co_await readFrame(socket, frame) ||
+                !alice.deserializeBobSetup(frame, bob_setup)) {
+                co_return SessionOutcome::FAILED;
+            }
+        }
+    } else {
+        MTAProtocol::AliceMessages alice_messages = alice.prepareAliceMessages(bob_setup);
+        if (!alice_messages.success ||
+            !co_await writeFrame(socket, alice.serializeAliceMessages(alice_messages))) {
+            co_return SessionOutcome::FAILED;
+        }
+    }
+
+    MTAProtocol::BobMessages bob_messages;
+    if (!co_await readFrame(socket, frame) ||
+        !alice.deserializeBobMessages(frame, bob_messages)) {
+        co_return SessionOutcome::FAILED;
+    }
+
+    MTAProtocol::MTAResult alice_result = alice.executeAliceMTA(bob_messages);
+    if (!alice_result.success) {
+        co_return SessionOutcome::FAILED;
+    }
+    alice_share = alice_result.additive_share;
+    co_return SessionOutcome::COMPLETED;
+}
+
+// One connection, one MtA
+static boost::asio::awaitable<SessionOutcome> runMtA(tcp::endpoint endpoint, AliceMTAProtocol& alice,
+                                                     CryptoOperations& crypto_ops, uint32_t y_share,
+                                                     ShareVerifier& verifier) {
+    auto executor = co_await boost::asio::this_coro::executor;
+    tcp::socket socket(executor);
+    boost::system::error_code ec;
+    co_await socket.async_connect(endpoint, boost::asio::redirect_error(boost::asio::use_awaitable, ec));
+    if (ec) {
+        MTA_LOG_WARN("connect failed: %s", ec.message().c_str());
+        co_return SessionOutcome::FAILED;
+    }
+    socket.set_option(tcp::no_delay(true), ec);
+
+    uint32_t x_share = crypto_ops.generateRandomUint32();
+    uint32_t delta = verifier.reserve(crypto_ops);
+    uint32_t alice_share = 0;
+    SessionOutcome outcome = co_await exchangeMessages(socket, alice, x_share, delta, alice_share);
+    if (outcome == SessionOutcome::COMPLETED) {
+        verifier.expect(delta, x_share * y_share - alice_share);
+    } else {
+        verifier.release(delta);
+    }
+    co_return outcome;
+}
+
+// State shared by all threads
+struct RunControl {
+    Clock::time_point deadline;
+    bool has_deadline = false;
+    uint64_t session_limit = 0;
+    std::atomic<uint64_t> claimed{0};
+
+    // Takes one session from the budget; false once the run is over
+    bool claim(Clock::time_point now) {
+        if (has_deadline && now >= deadline) {
+            return false;
+        }
+        return session_limit == 0 || claimed.fetch_add(1, std::memory_order_relaxed) < session_limit;
+    }
+};
+
+// One io_context with its share of the connections
+class LoadThread {
+public:
+    LoadThread(const LoadgenOptions& options, RunControl& control, ShareVerifier& verifier,
+               tcp::endpoint endpoint, size_t connections)
+        : options_(options),
+          control_(control),
+          verifier_(verifier),
+          endpoint_(endpoint),
+          connections_(connections),
+          arrivals_signal_(io_context_),
+          arrivals_done_(false) {}
+
+    void run() {
+        // Per-thread rate: this thread's fraction of the connections
+        double rate = options_.rate * connections_ / options_.connections;
+        if (options_.open_loop) {
+            boost::asio::co_spawn(io_context_, generateArrivals(rate), boost::asio::detached);
+        }
+        for (size_t i = 0; i < connections_; i++) {
+            boost::asio::co_spawn(io_context_, connection(options_.open_loop ? 0 : rate / connections_),
+                                  boost::asio::detached);
+        }
+        io_context_.run();
+    }
+
+    ThreadStats& stats() {
+        return stats_;
+    }
+
+private:
+    boost::asio::awaitable<void> generateArrivals(double rate) {
+        boost::asio::steady_timer timer(io_context_);
+        auto interval = std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(1.0 / rate));
+        Clock::time_point next = Clock::now();
+        for (;;) {
+            timer.expires_at(next);
+            co_await timer.async_wait(boost::asio::use_awaitable);
+            if (!control_.claim(next)) {
+                break;
+            }
+            pending_.push_back(next);
+            arrivals_signal_.cancel();
+            next += interval;
+        }
+        arrivals_done_ = true;
+        arrivals_signal_.cancel();
+    }
+
+    // Next intended start, or false when the run is over
+    boost::asio::awaitable<bool> nextArrival(Clock::time_point& intended) {
+        while (pending_.empty()) {
+            if (arrivals_done_) {
+                co_return false;
+            }
+            boost::system::error_code ec;
+            arrivals_signal_.expires_at(Clock::time_point::max());
+            co_await arrivals_signal_.async_wait(boost::asio::redirect_error(boost::asio::use_awaitable, ec));
+        }
+        intended = pending_.front();
+        pending_.pop_front();
+        co_return true;
+    }
+
+    boost::asio::awaitable<void> connection(double paced_rate) {
+        AliceMTAProtocol alice;
+        alice.offerFeatures((options_.compressed_points ? MTAProtocol::FEATURE_COMPRESSED_POINTS : 0) |
+                            (options_.streamed_setup ? MTAProtocol::FEATURE_STREAMED_SETUP : 0) |
+                            (options_.interleaved_messages ? MTAProtocol::FEATURE_INTERLEAVED_MESSAGES : 0));
+        alice.useBinaryCodec(options_.binary_codec);
+        CryptoOperations crypto_ops;
+        boost::asio::steady_timer pacer(io_context_);
+        Clock::duration pace_interval = paced_rate > 0
+            ? std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(1.0 / paced_rate))
+            : Clock::duration::zero();
+        Clock::time_point next_start = Clock::now();
+
+        for (;;) {
+            Clock::time_point intended;
+            if (options_.open_loop) {
+                if (!co_await nextArrival(intended)) {
+                    break;
+                }
+            } else {
+                intended = pace_interval > Clock::duration::zero() ? next_start : Clock::now();
+                if (!control_.claim(intended)) {
+                    break;
+                }
+                if (intended > Clock::now()) {
+                    pacer.expires_at(intended);
+                    co_await pacer.async_wait(boost::asio::use_awaitable);
+                }
+                next_start += pace_interval;
+            }
+
+            SessionOutcome outcome = co_await runMtA(endpoint_, alice, crypto_ops, options_.y_share, verifier_);
+            switch (outcome) {
+            case SessionOutcome::COMPLETED:
+                stats_.completed++;
+                stats_.latencies_ns.push_back(static_cast<uint64_t>(
+                    std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - intended).count()));
+                break;
+            case SessionOutcome::FAILED:
+                stats_.failed++;
+                break;
+            case SessionOutcome::BUSY:
+                stats_.busy++;
+                break;
+            }
+        }
+    }
+
+    boost::asio::io_context io_context_;
+    const LoadgenOptions& options_;
+    RunControl& control_;
+    ShareVerifier& verifier_;
+    tcp::endpoint endpoint_;
+    size_t connections_;
+    ThreadStats stats_;
+    std::deque<Clock::time_point> pending_;
+    boost::asio::steady_timer arrivals_signal_;
+    bool arrivals_done_;
+};
+
+static void printUsage(const char* program) {
+    std::fprintf(stderr,
+                 "Usage: %s --y Y [--host H] [--port P] [--connections N] [--threads T]\n"
+                 "       [--mode closed|open] [--rate R] [--duration S] [--sessions M] [--compressed]\n"
+                 "       [--binary] [--streamed] [--interleaved] [--json]\n"
+                 "       (--journal FILE | --server-log FILE)\n",
+                 program);
+}
+
+static bool parseOptions(int argc, char* argv[], LoadgenOptions& options) {
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        bool has_value = i + 1 < argc;
+        if (arg == "--json") {
+            options.json = true;
+        } else if (arg == "--compressed") {
+            options.compressed_points = true;
+        } else if (arg == "--binary") {
+            options.binary_codec = true;
+        } else if (arg == "--streamed") {
+            options.streamed_setup = true;
+        } else if (arg == "--interleaved") {
+            options.interleaved_messages = true;
+        } else if (arg == "--y" && has_value) {
+            options.y_share = static_cast<uint32_t>(std::strtoul(argv[++i], nullptr, 10));
+            options.have_y = true;
+        } else if (arg == "--journal" && has_value) {
+            options.journal_path = argv[++i];
+        } else if (arg == "--server-log" && has_value) {
+            options.log_path = argv[++i];
+        } else if (arg == "--host" && has_value) {
+            options.host = argv[++i];
+        } else if (arg == "--port" && has_value) {
+            options.port = static_cast<unsigned short>(std::strtoul(argv[++i], nullptr, 10));
+        } else if (arg == "--connections" && has_value) {
+            options.connections = std::strtoul(argv[++i], nullptr, 10);
+        } else if (arg == "--threads" && has_value) {
+            options.threads = std::strtoul(argv[++i], nullptr, 10);
+        } else if (arg == "--mode" && has_value) {
+            std::string mode = argv[++i];
+            if (mode != "open" && mode != "closed") {
+                return false;
+            }
+            options.open_loop = mode == "open";
+        } else if (arg == "--rate" && has_value) {
+            options.rate = std::strtod(argv[++i], nullptr);
+        } else if (arg == "--duration" && has_value) {
+            options.duration_s = std::strtod(argv[++i], nullptr);
+        } else if (arg == "--sessions" && has_value) {
+            options.sessions = std::strtoull(argv[++i], nullptr, 10);
+        } else {
+            return false;
+        }
+    }
+
+    if (!options.have_y || options.connections == 0 || options.threads == 0 ||
+        (options.open_loop && options.rate <= 0)) {
+        return false;
+    }
+    // Throughput is only reported for verified sessions
+    if (options.journal_path.empty() == options.log_path.empty()) {
+        std::fprintf(stderr, "Exactly one of --journal and --server-log is needed to verify the sessions\n");
+        return false;
+    }
+    options.threads = std::min(options.threads, options.connections);
+    if (options.duration_s <= 0 && options.sessions == 0) {
+        options.duration_s = 10;
+    }
+    return true;
+}
+
+static double percentile(const std::vector<uint64_t>& sorted, double q) {
+    if (sorted.empty()) {
+        return 0;
+    }
+    size_t index = static_cast<size_t>(q * static_cast<double>(sorted.size() - 1));
+    return static_cast<double>(sorted[index]) * 1e-6;
+}
+
+int main(int argc, char* argv[]) {
+    LoadgenOptions options;
+    if (!parseOptions(argc, argv, options)) {
+        printUsage(argv[0]);
+        return 1;
+    }
+
+    tcp::endpoint endpoint;
+    try {
+        endpoint = tcp::endpoint(boost::asio::ip::make_address(options.host), options.port);
+    } catch (const std::exception& e) {
+        std::fprintf(stderr, "Invalid host %s: %s\n", options.host.c_str(), e.what());
+        return 1;
+    }
+
+    std::unique_ptr<ResultSource> source;
+    if (!options.journal_path.empty()) {
+        std::unique_ptr<ResultJournal> journal = ResultJournal::openReader(options.journal_path);
+        if (journal) {
+            source = std::make_unique<JournalSource>(std::move(journal));
+        }
+    } else {
+        source = ServerLogSource::open(options.log_path);
+    }
+    if (!source) {
+        return 1;
+    }
+    ShareVerifier verifier(options.y_share);
+
+    RunControl control;
+    control.session_limit = options.sessions;
+    Clock::time_point started = Clock::now();
+    if (options.duration_s > 0) {
+        control.has_deadline = true;
+        control.deadline = started + std::chrono::duration_cast<Clock::duration>(
+            std::chrono::duration<double>(options.duration_s));
+    }
+
+    std::vector<std::unique_ptr<LoadThread>> load_threads;
+    for (size_t t = 0; t < options.threads; t++) {
+        // Spread connections as evenly as possible
+        size_t connections = options.connections / options.threads +
+                             (t < options.connections % options.threads ? 1 : 0);
+        load_threads.push_back(std::make_unique<LoadThread>(options, control, verifier, endpoint,
+                                                            connections));
+    }
+
+    std::vector<std::thread> threads;
+    for (auto& load_thread : load_threads) {
+        threads.emplace_back([&load_thread]() { load_thread->run(); });
+    }
+    std::atomic<bool> running{true};
+    std::thread verify_thread([&]() {
+        while (running.load()) {
+            source->poll(verifier);
+            std::this_thread::sleep_for(std::chrono::milliseconds(5));
+        }
+    });
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    double elapsed = std::chrono::duration<double>(Clock::now() - started).count();
+
+    running = false;
+    verify_thread.join();
+    // The last results reach the journal within the server's commit
+    // interval, and the log within its logger's next drain
+    Clock::time_point give_up = Clock::now() + std::chrono::seconds(5);
+    source->poll(verifier);
+    while (verifier.outstanding() > 0 && Clock::now() < give_up) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(5));
+        source->poll(verifier);
+    }
+    uint64_t verified = verifier.verified();
+    uint64_t mismatched = verifier.mismatched();
+    uint64_t unreported = verifier.outstanding();
+
+    ThreadStats total;
+    for (auto& load_thread : load_threads) {
+        ThreadStats& stats = load_thread->stats();
+        total.completed += stats.completed;
+        total.failed += stats.failed;
+        total.busy += stats.busy;
+        total.latencies_ns.insert(total.latencies_ns.end(), stats.latencies_ns.begin(), stats.latencies_ns.end());
+    }
+    std::sort(total.latencies_ns.begin(), total.latencies_ns.end());
+    Logger::flush();
+
+    if (mismatched > 0 || unreported > 0) {
+        std::fprintf(stderr, "verification FAILED: of %llu sessions, %llu did not reconstruct x*y and %llu "
+                             "have no result in %s; not reporting throughput\n",
+                     static_cast<unsigned long long>(total.completed),
+                     static_cast<unsigned long long>(mismatched), static_cast<unsigned long long>(unreported),
+                     source->name());
+        return 2;
+    }
+
+    double throughput = total.completed / elapsed;
+    const char* mode = options.open_loop ? "open" : "closed";
+    if (options.json) {
+        std::printf("{\"mode\": \"%s\", \"connections\": %zu, \"threads\": %zu, \"target_rate\": %.1f, "
+                    "\"elapsed_s\": %.3f, \"completed\": %llu, \"verified\": %llu, \"failed\": %llu, "
+                    "\"busy\": %llu, "
+                    "\"throughput\": %.1f, "
+                    "\"latency_ms\": {\"p50\": %.3f, \"p90\": %.3f, \"p99\": %.3f, \"p999\": %.3f, \"max\": %.3f}}\n",
+                    mode, options.connections, options.threads, options.rate, elapsed,
+                    static_cast<unsigned long long>(total.completed), static_cast<unsigned long long>(verified),
+                    static_cast<unsigned long long>(total.failed),
+                    static_cast<unsigned long long>(total.busy), throughput,
+                    percentile(total.latencies_ns, 0.5), percentile(total.latencies_ns, 0.9),
+                    percentile(total.latencies_ns, 0.99), percentile(total.latencies_ns, 0.999),
+                    percentile(total.latencies_ns, 1.0));
+    } else {
+        std::printf("mode: %s loop, %zu connections on %zu threads", mode, options.connections, options.threads);
+        if (options.rate > 0) {
+            std::printf(", target %.1f MtA/s", options.rate);
+        }
+        std::printf("\nsessions: %llu completed, %llu failed, %llu busy in %.3f s\n",
+                    static_cast<unsigned long long>(total.completed),
+                    static_cast<unsigned long long>(total.failed),
+                    static_cast<unsigned long long>(total.busy), elapsed);
+        std::printf("verified: %llu against %s\n", static_cast<unsigned long long>(verified), source->name());
+        std::printf("throughput: %.1f MtA/s\n", throughput);
+        std::printf("latency ms: p50 %.3f  p90 %.3f  p99 %.3f  p99.9 %.3f  max %.3f\n",
+                    percentile(total.latencies_ns, 0.5), percentile(total.latencies_ns, 0.9),
+                    percentile(total.latencies_ns, 0.99), percentile(total.latencies_ns, 0.999),
+                    percentile(total.latencies_ns, 1.0));
+    }
+
+    return total.failed == 0 ? 0 : 1;
+}
@@ -0,0 +1,75 @@
+// Fills a precompute store (MTA_PRECOMPUTE_PATH) ahead of time. Each entry
+// is one session's 32 setup scalars and their points, so tcp_server takes
+// its setup from the store instead of generating points while the client
+// waits, from the first session after a restart.
+//
+// Usage: MTA_PRECOMPUTE_KEY=<64 hex digits> mta_precompute STORE COUNT
+//
+// Appends COUNT entries to STORE, creating it if needed. Entries are
+// sealed with the key, which tcp_server must be given as well. The store
+// cannot be filled while a server has it open.
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include "precompute_store.h"
+#include "crypto_operations.h"
+#include "logger.h"
+
+extern "C" {
+    #include <trezor-crypto/memzero.h>
+}
+
+// Entries between syncs, so an interrupted run keeps most of its work
+static const uint64_t SYNC_EVERY = 1024;
+
+int main(int argc, char* argv[]) {
+    if (argc != 3) {
+        std::fprintf(stderr, "Usage: MTA_PRECOMPUTE_KEY=<64 hex digits> %s STORE COUNT\n", argv[0]);
+        return 1;
+    }
+    const char* key_hex = std::getenv("MTA_PRECOMPUTE_KEY");
+    uint8_t key[PrecomputeStore::KEY_SIZE];
+    if (key_hex == nullptr || !PrecomputeStore::parseKey(key_hex, key)) {
+        std::fprintf(stderr, "MTA_PRECOMPUTE_KEY must be set to 64 hex digits\n");
+        return 1;
+    }
+    uint64_t count = std::strtoull(argv[2], nullptr, 10);
+
+    std::unique_ptr<PrecomputeStore> store = PrecomputeStore::open(argv[1], key, true);
+    memzero(key, sizeof(key));
+    if (!store) {
+        return 1;
+    }
+
+    CryptoOperations crypto_ops;
+    uint8_t scalars[PrecomputeStore::SCALARS_SIZE];
+    uint8_t points[PrecomputeStore::POINTS_SIZE];
+    auto start = std::chrono::steady_clock::now();
+    for (uint64_t i = 0; i < count; i++) {
+        for (size_t j = 0; j < 32; j++) {
+            crypto_ops.generateRandomScalar(&scalars[j * 32]);
+        }
+        if (!crypto_ops.generatePointsFromScalars(scalars, 32, points) ||
+            !store->append(scalars, points)) {
+            std::fprintf(stderr, "Failed at entry %llu\n", static_cast<unsigned long long>(i));
+            memzero(scalars, sizeof(scalars));
+            store->sync();
+            return 1;
+        }
+        if ((i + 1) % SYNC_EVERY == 0 && !store->sync()) {
+            memzero(scalars, sizeof(scalars));
+            return 1;
+        }
+    }
+    memzero(scalars, sizeof(scalars));
+    if (!store->sync()) {
+        return 1;
+    }
+
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    std::printf("Appended %llu entries in %.1f s; %llu available\n", static_cast<unsigned long long>(count),
+                seconds, static_cast<unsigned long long>(store->remaining()));
+    return 0;
+}
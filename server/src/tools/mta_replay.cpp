@@ -0,0 +1,307 @@
+// Replays a session capture (MTA_CAPTURE_PATH) against an in-process
+// MTAServer and reports the server's per-phase latencies. Each captured
+// session becomes one connection that sends the captured client frames
+// at their original offsets (divided by --speed) and reads as many
+// replies as were captured, so the traffic shape matches production.
+//
+// Usage: mta_replay CAPTURE [--speed X] [--max-inflight N]
+//                           [--out FILE] [--baseline FILE] [--threshold PCT]
+//
+// --speed 0 sends as fast as the server allows. --out saves the phase
+// summary, and --baseline compares against a summary saved by another
+// build. When p50 or p99 of any phase regresses by more than --threshold
+// percent (default 10), the exit status is 3, so `git bisect run` can use it.
+
+#include <boost/asio.hpp>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <map>
+#include <string>
+#include <thread>
+#include <vector>
+#include "tcp/mta_server.h"
+#include "session_capture.h"
+#include "metrics.h"
+#include "logger.h"
+
+using boost::asio::ip::tcp;
+using Clock = std::chrono::steady_clock;
+
+struct CapturedSession {
+    uint32_t id;
+    uint64_t start_ns;
+    std::vector<const CaptureRecord*> records;
+};
+
+struct ReplayState {
+    tcp::endpoint endpoint;
+    Clock::time_point replay_start;
+    double speed;
+    size_t in_flight = 0;
+    size_t completed = 0;
+    size_t failed = 0;
+};
+
+// Offset of `timestamp_ns` in the capture, scaled to replay time
+static Clock::time_point replayTime(const ReplayState& state, uint64_t offset_ns) {
+    if (state.speed <= 0) {
+        return state.replay_start;
+    }
+    return state.replay_start + std::chrono::nanoseconds(static_cast<int64_t>(offset_ns / state.speed));
+}
+
+static boost::asio::awaitable<bool> replaySession(const CapturedSession& session, uint64_t origin_ns,
+                                                  ReplayState& state) {
+    auto executor = co_await boost::asio::this_coro::executor;
+    auto token = [](boost::system::error_code& ec) {
+        return boost::asio::redirect_error(boost::asio::use_awaitable, ec);
+    };
+
+    boost::system::error_code ec;
+    tcp::socket socket(executor);
+    co_await socket.async_connect(state.endpoint, token(ec));
+    if (ec) {
+        co_return false;
+    }
+    socket.set_option(tcp::no_delay(true), ec);
+
+    boost::asio::steady_timer timer(executor);
+    std::vector<uint8_t> frame;
+    for (const CaptureRecord* record : session.records) {
+        if (record->direction == CaptureDirection::TO_CLIENT) {
+            uint8_t header[4];
+            co_await boost::asio::async_read(socket, boost::asio::buffer(header), token(ec));
+            if (ec) {
+                co_return false;
+            }
+            frame.resize(header[0] | (header[1] << 8) | (header[2] << 16) | (header[3] << 24));
+            co_await boost::asio::async_read(socket, boost::asio::buffer(frame), token(ec));
+            if (ec) {
+                co_return false;
+            }
+            continue;
+        }
+
+        timer.expires_at(replayTime(state, record->timestamp_ns - origin_ns));
+        co_await timer.async_wait(token(ec));
+
+        uint32_t size = static_cast<uint32_t>(record->payload.size());
+        frame.resize(4 + size);
+        frame[0] = size & 0xFF;
+        frame[1] = (size >> 8) & 0xFF;
+        frame[2] = (size >> 16) & 0xFF;
+        frame[3] = (size >> 24) & 0xFF;
+        std::copy(record->payload.begin(), record->payload.end(), frame.begin() + 4);
+        co_await boost::asio::async_write(socket, boost::asio::buffer(frame), token(ec));
+        if (ec) {
+            co_return false;
+        }
+    }
+    co_return true;
+}
+
+// Starts sessions in capture order, never more than max_in_flight at once
+static boost::asio::awaitable<void> replayAll(const std::vector<CapturedSession>& sessions, uint64_t origin_ns,
+                                              ReplayState& state, size_t max_in_flight) {
+    auto executor = co_await boost::asio::this_coro::executor;
+    boost::asio::steady_timer timer(executor);
+    boost::system::error_code ec;
+
+    for (const CapturedSession& session : sessions) {
+        timer.expires_at(replayTime(state, session.start_ns - origin_ns));
+        co_await timer.async_wait(boost::asio::redirect_error(boost::asio::use_awaitable, ec));
+        while (state.in_flight >= max_in_flight) {
+            timer.expires_after(std::chrono::microseconds(100));
+            co_await timer.async_wait(boost::asio::redirect_error(boost::asio::use_awaitable, ec));
+        }
+
+        state.in_flight++;
+        boost::asio::co_spawn(executor, replaySession(session, origin_ns, state),
+            [&state](std::exception_ptr error, bool ok) {
+                state.in_flight--;
+                if (!error && ok) {
+                    state.completed++;
+                } else {
+                    state.failed++;
+                }
+            });
+    }
+}
+
+static const MetricPhase REPORTED_PHASES[] = {
+    MetricPhase::ACCEPT, MetricPhase::READ_DELTA, MetricPhase::INITIALIZE_BOB,
+    MetricPhase::SERIALIZE_SETUP, MetricPhase::WAIT_FOR_ALICE, MetricPhase::EXECUTE_MTA,
+    MetricPhase::WRITE_RESULT, MetricPhase::SESSION,
+};
+
+static bool writeSummary(const std::string& path, const std::map<std::string, PhaseSummary>& summaries) {
+    std::FILE* file = std::fopen(path.c_str(), "w");
+    if (file == nullptr) {
+        return false;
+    }
+    std::fprintf(file, "mta-replay-v1\n");
+    for (const auto& [name, summary] : summaries) {
+        std::fprintf(file, "%s %llu %.1f %llu %llu %llu %llu\n", name.c_str(),
+                     static_cast<unsigned long long>(summary.count), summary.mean_ns,
+                     static_cast<unsigned long long>(summary.p50_ns), static_cast<unsigned long long>(summary.p90_ns),
+                     static_cast<unsigned long long>(summary.p99_ns), static_cast<unsigned long long>(summary.max_ns));
+    }
+    return std::fclose(file) == 0;
+}
+
+static bool readSummary(const std::string& path, std::map<std::string, PhaseSummary>& summaries) {
+    std::FILE* file = std::fopen(path.c_str(), "r");
+    if (file == nullptr) {
+        return false;
+    }
+    char header[32];
+    if (std::fscanf(file, "%31s", header) != 1 || std::string(header) != "mta-replay-v1") {
+        std::fclose(file);
+        return false;
+    }
+    char name[64];
+    unsigned long long count, p50, p90, p99, max;
+    double mean;
+    while (std::fscanf(file, "%63s %llu %lf %llu %llu %llu %llu", name, &count, &mean, &p50, &p90, &p99, &max) == 7) {
+        summaries[name] = PhaseSummary{count, mean, p50, p90, p99, max};
+    }
+    std::fclose(file);
+    return true;
+}
+
+static double percentChange(uint64_t baseline, uint64_t current) {
+    return baseline == 0 ? 0 : 100.0 * (static_cast<double>(current) - baseline) / baseline;
+}
+
+int main(int argc, char* argv[]) {
+    if (argc < 2) {
+        std::fprintf(stderr, "Usage: %s CAPTURE [--speed X] [--max-inflight N] [--out FILE] "
+                             "[--baseline FILE] [--threshold PCT]\n", argv[0]);
+        return 1;
+    }
+
+    std::string capture_path = argv[1];
+    double speed = 1.0;
+    size_t max_in_flight = 256;
+    std::string out_path;
+    std::string baseline_path;
+    double threshold = 10.0;
+    for (int i = 2; i + 1 < argc; i += 2) {
+        std::string arg = argv[i];
+        if (arg == "--speed") {
+            speed = std::strtod(argv[i + 1], nullptr);
+        } else if (arg == "--max-inflight") {
+            max_in_flight = std::max<size_t>(std::strtoul(argv[i + 1], nullptr, 10), 1);
+        } else if (arg == "--out") {
+            out_path = argv[i + 1];
+        } else if (arg == "--baseline") {
+            baseline_path = argv[i + 1];
+        } else if (arg == "--threshold") {
+            threshold = std::strtod(argv[i + 1], nullptr);
+        } else {
+            std::fprintf(stderr, "Unknown option %s\n", arg.c_str());
+            return 1;
+        }
+    }
+
+    std::vector<CaptureRecord> records;
+    if (!CaptureFile::readAll(capture_path, records) || records.empty()) {
+        Logger::flush();
+        std::fprintf(stderr, "No records in %s\n", capture_path.c_str());
+        return 1;
+    }
+
+    // Group by session, keeping each session's records in capture order
+    std::map<uint32_t, CapturedSession> by_id;
+    for (const CaptureRecord& record : records) {
+        CapturedSession& session = by_id[record.session_id];
+        if (session.records.empty()) {
+            session.id = record.session_id;
+            session.start_ns = record.timestamp_ns;
+        }
+        session.records.push_back(&record);
+    }
+    std::vector<CapturedSession> sessions;
+    for (auto& [id, session] : by_id) {
+        sessions.push_back(std::move(session));
+    }
+    std::sort(sessions.begin(), sessions.end(), [](const CapturedSession& a, const CapturedSession& b) {
+        return a.start_ns < b.start_ns;
+    });
+    uint64_t origin_ns = sessions.front().start_ns;
+
+    // The replayed server must not capture its own replay
+    ServerConfig config = ServerConfig::fromEnvironment();
+    config.capture_path.clear();
+    Logger::setLevel(LogLevel::WARN);
+
+    boost::asio::io_context server_context;
+    MTAServer server(server_context, 0, 0, config);
+    auto work = boost::asio::make_work_guard(server_context);
+    std::thread server_thread([&server_context]() { server_context.run(); });
+
+    boost::asio::io_context client_context;
+    ReplayState state;
+    state.endpoint = tcp::endpoint(boost::asio::ip::address_v4::loopback(), server.port());
+    state.speed = speed;
+    state.replay_start = Clock::now();
+    boost::asio::co_spawn(client_context, replayAll(sessions, origin_ns, state, max_in_flight), boost::asio::detached);
+    client_context.run();
+    double elapsed = std::chrono::duration<double>(Clock::now() - state.replay_start).count();
+
+    work.reset();
+    server_context.stop();
+    server_thread.join();
+    Logger::flush();
+
+    std::map<std::string, PhaseSummary> summaries;
+    for (MetricPhase phase : REPORTED_PHASES) {
+        summaries[Metrics::phaseName(phase)] = Metrics::summarizePhase(phase);
+    }
+
+    std::printf("replayed %zu sessions (%zu failed) from %s in %.3f s at speed %g\n",
+                state.completed, state.failed, capture_path.c_str(), elapsed, speed);
+    std::printf("%-16s %8s %12s %12s %12s %12s\n", "phase", "count", "mean us", "p50 us", "p90 us", "p99 us");
+    for (MetricPhase phase : REPORTED_PHASES) {
+        const PhaseSummary& summary = summaries[Metrics::phaseName(phase)];
+        std::printf("%-16s %8llu %12.1f %12.1f %12.1f %12.1f\n", Metrics::phaseName(phase),
+                    static_cast<unsigned long long>(summary.count), summary.mean_ns / 1e3,
+                    summary.p50_ns / 1e3, summary.p90_ns / 1e3, summary.p99_ns / 1e3);
+    }
+
+    if (!out_path.empty() && !writeSummary(out_path, summaries)) {
+        std::fprintf(stderr, "Cannot write %s\n", out_path.c_str());
+        return 1;
+    }
+
+    int status = state.failed == 0 ? 0 : 1;
+    if (!baseline_path.empty()) {
+        std::map<std::string, PhaseSummary> baseline;
+        if (!readSummary(baseline_path, baseline)) {
+            std::fprintf(stderr, "Cannot read baseline %s\n", baseline_path.c_str());
+            return 1;
+        }
+
+        std::printf("\nagainst %s (regression threshold %.1f%%):\n", baseline_path.c_str(), threshold);
+        std::printf("%-16s %10s %10s\n", "phase", "p50", "p99");
+        for (MetricPhase phase : REPORTED_PHASES) {
+            const char* name = Metrics::phaseName(phase);
+            auto found = baseline.find(name);
+            if (found == baseline.end() || found->second.count == 0 || summaries[name].count == 0) {
+                continue;
+            }
+            double p50_change = percentChange(found->second.p50_ns, summaries[name].p50_ns);
+            double p99_change = percentChange(found->second.p99_ns, summaries[name].p99_ns);
+            bool regressed = p50_change > threshold || p99_change > threshold;
+            std::printf("%-16s %+9.1f%% %+9.1f%%%s\n", name, p50_change, p99_change, regressed ? "  REGRESSED" : "");
+            if (regressed) {
+                status = 3;
+            }
+        }
+    }
+
+    return status;
+}
@@ -0,0 +1,44 @@
+// Reads the result journal tcp_server appends completed sessions to
+// (MTA_RESULT_JOURNAL_PATH), for the signing service or by hand.
+//
+// Usage: mta_results JOURNAL [--consume]
+//
+// Prints every committed record not yet consumed, one per line:
+//   sequence timestamp_ns session_id additive_share correlation_check
+// With --consume, marks them consumed afterwards, so the server may write
+// over their slots and the next run starts after them. It runs alongside
+// the server.
+
+#include <cstdio>
+#include <cstring>
+#include "result_journal.h"
+
+int main(int argc, char* argv[]) {
+    bool consume = argc == 3 && std::strcmp(argv[2], "--consume") == 0;
+    if (argc != 2 && !consume) {
+        std::fprintf(stderr, "Usage: %s JOURNAL [--consume]\n", argv[0]);
+        return 1;
+    }
+
+    std::unique_ptr<ResultJournal> journal = ResultJournal::openReader(argv[1]);
+    if (!journal) {
+        return 1;
+    }
+
+    uint64_t end = journal->committed();
+    uint64_t sequence = journal->consumed();
+    for (; sequence < end; sequence++) {
+        ResultJournal::Record record;
+        if (!journal->read(sequence, record)) {
+            std::fprintf(stderr, "Record %llu is damaged\n", static_cast<unsigned long long>(sequence));
+            break;
+        }
+        std::printf("%llu %llu %u %u %u\n", static_cast<unsigned long long>(record.sequence),
+                    static_cast<unsigned long long>(record.timestamp_ns), record.session_id,
+                    record.additive_share, record.correlation_check);
+    }
+    if (consume) {
+        journal->consume(sequence);
+    }
+    return sequence == end ? 0 : 1;
+}
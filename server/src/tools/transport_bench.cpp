@@ -0,0 +1,298 @@
+// Drives an in-process MTAServer with MtA-shaped traffic over loopback TCP,
+// an AF_UNIX socket or shared-memory rings, and reports throughput plus the
+// syscalls issued by the server thread per MtA. The server runs with a
+// single acceptor shard, so that one thread is the whole server. Build once
+// with and once without -DMTA_USE_IO_URING=ON to compare backends.
+//
+// Built with -DMTA_ALLOC_TRACKING=ON it also reports the server's heap
+// allocations per phase per MtA, and an optional allocation budget per MtA
+// makes the exit status 4 when the server exceeds it.
+
+#include <boost/asio.hpp>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <future>
+#include <iostream>
+#include <memory>
+#include <linux/perf_event.h>
+#include <string>
+#include <sys/syscall.h>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+#include "tcp/mta_server.h"
+#include "mta_protocol.h"
+#include "protobuf_handler.h"
+#include "crypto_operations.h"
+#include "shm_ring.h"
+#include "logger.h"
+#include "alloc_tracker.h"
+
+using boost::asio::ip::tcp;
+using boost::asio::local::stream_protocol;
+
+// Counts raw_syscalls:sys_enter for the calling thread; -1 when tracepoints
+// are not accessible (perf_event_paranoid, missing tracefs)
+static int openSyscallCounter() {
+    const char* id_paths[] = {
+        "/sys/kernel/tracing/events/raw_syscalls/sys_enter/id",
+        "/sys/kernel/debug/tracing/events/raw_syscalls/sys_enter/id",
+    };
+
+    uint64_t tracepoint_id = 0;
+    for (const char* path : id_paths) {
+        std::ifstream in(path);
+        if (in >> tracepoint_id) {
+            break;
+        }
+    }
+    if (tracepoint_id == 0) {
+        return -1;
+    }
+
+    perf_event_attr attr;
+    std::memset(&attr, 0, sizeof(attr));
+    attr.type = PERF_TYPE_TRACEPOINT;
+    attr.size = sizeof(attr);
+    attr.config = tracepoint_id;
+    attr.sample_period = 0;
+
+    return static_cast<int>(syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0));
+}
+
+static uint64_t readCounter(int fd) {
+    uint64_t value = 0;
+    if (fd < 0 || read(fd, &value, sizeof(value)) != sizeof(value)) {
+        return 0;
+    }
+    return value;
+}
+
+static std::vector<uint8_t> withSizePrefix(const std::vector<uint8_t>& message) {
+    std::vector<uint8_t> frame(4 + message.size());
+    uint32_t size = static_cast<uint32_t>(message.size());
+    frame[0] = size & 0xFF;
+    frame[1] = (size >> 8) & 0xFF;
+    frame[2] = (size >> 16) & 0xFF;
+    frame[3] = (size >> 24) & 0xFF;
+    std::copy(message.begin(), message.end(), frame.begin() + 4);
+    return frame;
+}
+
+template <typename Socket>
+static void readFrame(Socket& socket, std::vector<uint8_t>& buffer) {
+    uint8_t header[4];
+    boost::asio::read(socket, boost::asio::buffer(header));
+    uint32_t size = header[0] | (header[1] << 8) | (header[2] << 16) | (header[3] << 24);
+    buffer.resize(size);
+    boost::asio::read(socket, boost::asio::buffer(buffer));
+}
+
+static bool readFrame(ShmChannel& channel, std::vector<uint8_t>& buffer) {
+    uint8_t header[4];
+    if (!channel.readExact(header, sizeof(header))) {
+        return false;
+    }
+    uint32_t size = header[0] | (header[1] << 8) | (header[2] << 16) | (header[3] << 24);
+    buffer.resize(size);
+    return channel.readExact(buffer.data(), buffer.size());
+}
+
+template <typename Socket>
+static void runExchange(Socket& socket, const std::vector<uint8_t>& delta_frame,
+                        const std::vector<uint8_t>& alice_frame, std::vector<uint8_t>& reply) {
+    boost::asio::write(socket, boost::asio::buffer(delta_frame));
+    readFrame(socket, reply);
+    boost::asio::write(socket, boost::asio::buffer(alice_frame));
+    readFrame(socket, reply);
+}
+
+static bool runExchange(ShmChannel& channel, const std::vector<uint8_t>& delta_frame,
+                        const std::vector<uint8_t>& alice_frame, std::vector<uint8_t>& reply) {
+    return channel.writeAll(delta_frame.data(), delta_frame.size()) &&
+           readFrame(channel, reply) &&
+           channel.writeAll(alice_frame.data(), alice_frame.size()) &&
+           readFrame(channel, reply);
+}
+
+// One AliceMessages frame with valid points, reused by every connection
+static std::vector<uint8_t> buildAliceFrame() {
+    CryptoOperations crypto_ops;
+    MTAProtocol::AliceMessages messages;
+    messages.success = true;
+    messages.masked_share = crypto_ops.generateRandomUint32();
+    messages.points_A.resize(32 * 65);
+    messages.encrypted_m0_messages.resize(32 * 32);
+    messages.encrypted_m1_messages.resize(32 * 32);
+
+    uint8_t scalar[32];
+    for (int i = 0; i < 32; i++) {
+        crypto_ops.generateECDHKeyPair(scalar, &messages.points_A[i * 65]);
+        crypto_ops.generateRandomScalar(&messages.encrypted_m0_messages[i * 32]);
+        crypto_ops.generateRandomScalar(&messages.encrypted_m1_messages[i * 32]);
+    }
+
+    MTAProtocol protocol;
+    return withSizePrefix(protocol.serializeAliceMessages(messages));
+}
+
+int main(int argc, char* argv[]) {
+    size_t sessions = argc >= 2 ? std::strtoul(argv[1], nullptr, 10) : 2000;
+    size_t concurrency = argc >= 3 ? std::strtoul(argv[2], nullptr, 10) : 16;
+    std::string transport = argc >= 4 ? argv[3] : "tcp";
+    double max_allocs_per_mta = argc >= 5 ? std::strtod(argv[4], nullptr) : -1;
+    if (sessions == 0 || concurrency == 0 ||
+        (transport != "tcp" && transport != "unix" && transport != "shm")) {
+        std::cerr << "Usage: " << argv[0] << " [sessions] [concurrency] [tcp|unix|shm] [max_allocs_per_mta]"
+                  << std::endl;
+        return 1;
+    }
+#if !defined(MTA_ALLOC_TRACKING)
+    if (max_allocs_per_mta >= 0) {
+        std::cerr << "An allocation budget needs a build with -DMTA_ALLOC_TRACKING=ON" << std::endl;
+        return 1;
+    }
+#endif
+
+    ServerConfig config = ServerConfig::fromEnvironment();
+    // The syscall counter follows one thread; further shards would run
+    // sessions on threads it does not see
+    if (config.acceptor_shards > 1) {
+        std::cerr << "Ignoring MTA_ACCEPTOR_SHARDS=" << config.acceptor_shards
+                  << "; the syscall count covers a single shard" << std::endl;
+    }
+    config.acceptor_shards = 1;
+    std::string local_path = "/tmp/mta_transport_bench." + std::to_string(getpid()) + ".sock";
+    if (transport == "unix") {
+        config.unix_path = local_path;
+    } else if (transport == "shm") {
+        config.shm_path = local_path;
+    }
+
+    MTAProtobufHandler protobuf_handler;
+    std::vector<uint8_t> delta_frame = withSizePrefix(protobuf_handler.serializeCorrelationDelta(12345));
+    std::vector<uint8_t> alice_frame = buildAliceFrame();
+
+    // Keep the server's startup and session logging off the terminal while measuring
+    Logger::setLevel(LogLevel::WARN);
+
+    boost::asio::io_context io_context;
+    MTAServer server(io_context, 0, 0, config);
+    unsigned short port = server.port();
+
+    auto work = boost::asio::make_work_guard(io_context);
+    std::thread server_thread([&io_context]() { io_context.run(); });
+
+    int counter_fd = -1;
+    {
+        std::promise<int> opened;
+        boost::asio::post(io_context, [&opened]() { opened.set_value(openSyscallCounter()); });
+        counter_fd = opened.get_future().get();
+    }
+
+    std::atomic<size_t> next_session{0};
+    std::atomic<size_t> failures{0};
+    auto started = std::chrono::steady_clock::now();
+
+    std::vector<std::thread> clients;
+    for (size_t c = 0; c < concurrency; c++) {
+        clients.emplace_back([&]() {
+            boost::asio::io_context client_context;
+            std::vector<uint8_t> reply;
+            while (next_session.fetch_add(1) < sessions) {
+                try {
+                    if (transport == "tcp") {
+                        tcp::socket socket(client_context);
+                        socket.connect(tcp::endpoint(boost::asio::ip::address_v4::loopback(), port));
+                        socket.set_option(tcp::no_delay(true));
+                        runExchange(socket, delta_frame, alice_frame, reply);
+                    } else if (transport == "unix") {
+                        stream_protocol::socket socket(client_context);
+                        socket.connect(stream_protocol::endpoint(local_path));
+                        runExchange(socket, delta_frame, alice_frame, reply);
+                    } else {
+                        std::unique_ptr<ShmChannel> channel(ShmChannel::connect(local_path));
+                        if (!channel || !runExchange(*channel, delta_frame, alice_frame, reply)) {
+                            failures++;
+                            continue;
+                        }
+                        channel->markClosed();
+                    }
+                } catch (const std::exception&) {
+                    failures++;
+                }
+            }
+        });
+    }
+    for (auto& client : clients) {
+        client.join();
+    }
+
+    auto elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - started).count();
+
+    uint64_t server_syscalls = 0;
+    {
+        std::promise<uint64_t> counted;
+        boost::asio::post(io_context, [&counted, counter_fd]() { counted.set_value(readCounter(counter_fd)); });
+        server_syscalls = counted.get_future().get();
+    }
+
+    work.reset();
+    io_context.stop();
+    server_thread.join();
+
+    Logger::flush();
+
+    size_t completed = sessions - failures.load();
+#if defined(BOOST_ASIO_HAS_IO_URING)
+    const char* backend = "io_uring";
+#else
+    const char* backend = "epoll";
+#endif
+    std::printf("backend: %s, transport: %s\n", backend, transport.c_str());
+    std::printf("sessions: %zu completed, %zu failed (concurrency %zu)\n", completed, failures.load(), concurrency);
+    std::printf("elapsed: %.3f s\n", elapsed);
+    std::printf("throughput: %.1f MtA/s\n", completed / elapsed);
+    if (counter_fd >= 0 && completed > 0) {
+        std::printf("server syscalls: %llu (%.2f per MtA)\n",
+                    static_cast<unsigned long long>(server_syscalls),
+                    static_cast<double>(server_syscalls) / completed);
+        close(counter_fd);
+    } else {
+        std::printf("server syscalls: unavailable (needs perf_event_paranoid <= 1 and tracefs)\n");
+    }
+
+    int status = failures.load() == 0 ? 0 : 1;
+#if defined(MTA_ALLOC_TRACKING)
+    // Client threads never tag, so the phase counters are the server's alone
+    static const MetricPhase session_phases[] = {
+        MetricPhase::ACCEPT, MetricPhase::READ_DELTA, MetricPhase::INITIALIZE_BOB,
+        MetricPhase::SERIALIZE_SETUP, MetricPhase::WAIT_FOR_ALICE, MetricPhase::EXECUTE_MTA,
+        MetricPhase::WRITE_RESULT,
+    };
+    if (completed > 0) {
+        AllocCounts session_total;
+        std::printf("server allocations per MtA:\n");
+        for (MetricPhase phase : session_phases) {
+            AllocCounts counts = AllocTracker::phase(phase);
+            session_total.allocations += counts.allocations;
+            session_total.bytes += counts.bytes;
+            std::printf("  %-16s %8.2f allocs %10.1f bytes\n", Metrics::phaseName(phase),
+                        static_cast<double>(counts.allocations) / completed,
+                        static_cast<double>(counts.bytes) / completed);
+        }
+        double allocs_per_mta = static_cast<double>(session_total.allocations) / completed;
+        std::printf("  %-16s %8.2f allocs %10.1f bytes\n", "total", allocs_per_mta,
+                    static_cast<double>(session_total.bytes) / completed);
+        if (max_allocs_per_mta >= 0 && allocs_per_mta > max_allocs_per_mta) {
+            std::printf("allocation budget exceeded: %.2f > %g per MtA\n", allocs_per_mta, max_allocs_per_mta);
+            status = 4;
+        }
+    }
+#endif
+
+    return status;
+}
@@ -0,0 +1,98 @@
+#pragma once
+
+#include <boost/asio.hpp>
+#include <cstddef>
+
+// Byte stream a Session reads its length-prefixed frames from and writes its
+// replies to. Framing, the protocol state machine and the MtA code sit above
+// this interface and never see which transport carried the bytes.
+class SessionTransport {
+public:
+    virtual ~SessionTransport() = default;
+
+    virtual boost::asio::any_io_executor get_executor() = 0;
+
+    // Reads at least one byte; `ec` is set (eof on orderly close) instead of throwing
+    virtual boost::asio::awaitable<std::size_t> read_some(
+        boost::asio::mutable_buffer buffer, boost::system::error_code& ec) = 0;
+
+#if defined(BOOST_ASIO_HAS_IO_URING)
+    // Read into a buffer registered with the io_uring instance. Transports
+    // that are not backed by a socket fall back to a plain read.
+    virtual boost::asio::awaitable<std::size_t> read_some(
+        boost::asio::mutable_registered_buffer buffer, boost::system::error_code& ec) {
+        co_return co_await read_some(boost::asio::mutable_buffer(buffer.data(), buffer.size()), ec);
+    }
+#endif
+
+    // Completes when a read would not block, so that a session can wait for
+    // its next frame without holding a buffer. Transports that cannot wait
+    // without reading complete immediately.
+    virtual boost::asio::awaitable<void> wait_readable(boost::system::error_code& ec) {
+        ec = {};
+        co_return;
+    }
+
+    // Writes the whole buffer
+    virtual boost::asio::awaitable<std::size_t> write(
+        boost::asio::const_buffer buffer, boost::system::error_code& ec) = 0;
+
+    virtual void close() = 0;
+};
+
+// Completion token for transport I/O: errors are reported through `ec` instead
+// of exceptions, and operation state is drawn from the per-thread recycling
+// allocator (the same cache that backs the awaitable frames).
+inline auto transport_token(boost::system::error_code& ec) {
+    return boost::asio::bind_allocator(
+        boost::asio::recycling_allocator<void>(),
+        boost::asio::redirect_error(boost::asio::use_awaitable, ec));
+}
+
+// Any connected Asio stream socket: TCP or AF_UNIX
+template <typename Socket>
+class StreamTransport : public SessionTransport {
+public:
+    explicit StreamTransport(Socket socket) : socket_(std::move(socket)) {}
+
+    boost::asio::any_io_executor get_executor() override {
+        return socket_.get_executor();
+    }
+
+    boost::asio::awaitable<std::size_t> read_some(
+        boost::asio::mutable_buffer buffer, boost::system::error_code& ec) override {
+        co_return co_await socket_.async_read_some(buffer, transport_token(ec));
+    }
+
+#if defined(BOOST_ASIO_HAS_IO_URING)
+    boost::asio::awaitable<std::size_t> read_some(
+        boost::asio::mutable_registered_buffer buffer, boost::system::error_code& ec) override {
+        co_return co_await socket_.async_read_some(buffer, transport_token(ec));
+    }
+#endif
+
+    boost::asio::awaitable<void> wait_readable(boost::system::error_code& ec) override {
+        co_await socket_.async_wait(Socket::wait_read, transport_token(ec));
+    }
+
+    boost::asio::awaitable<std::size_t> write(
+        boost::asio::const_buffer buffer, boost::system::error_code& ec) override {
+        co_return co_await boost::asio::async_write(socket_, buffer, transport_token(ec));
+    }
+
+    void close() override {
+        boost::system::error_code ignored;
+        socket_.shutdown(Socket::shutdown_both, ignored);
+        socket_.close(ignored);
+    }
+
+    Socket& socket() {
+        return socket_;
+    }
+
+private:
+    Socket socket_;
+};
+
+using TcpTransport = StreamTransport<boost::asio::ip::tcp::socket>;
+using UnixTransport = StreamTransport<boost::asio::local::stream_protocol::socket>;
@@ -0,0 +1,386 @@
+#include "shm_ring.h"
+#include "logger.h"
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <new>
+#include <poll.h>
+#include <sys/eventfd.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+static const size_t SHM_MIN_RING_CAPACITY = 4096;
+
+static size_t dataOffset() {
+    return (sizeof(ShmRegionHeader) + 63) & ~size_t(63);
+}
+
+static void signalEventFd(int fd) {
+    uint64_t one = 1;
+    if (write(fd, &one, sizeof(one)) < 0 && errno != EAGAIN) {
+        MTA_LOG_ERROR("shm ring: eventfd write failed: %s", std::strerror(errno));
+    }
+}
+
+static void closeIfOpen(int fd) {
+    if (fd >= 0) {
+        close(fd);
+    }
+}
+
+ShmChannel::ShmChannel(Side side, int memfd, int own_wake_fd, int peer_wake_fd, int control_fd,
+                       uint8_t* base, size_t mapped_size)
+    : side_(side),
+      memfd_(memfd),
+      own_wake_fd_(own_wake_fd),
+      peer_wake_fd_(peer_wake_fd),
+      control_fd_(control_fd),
+      base_(base),
+      mapped_size_(mapped_size),
+      header_(reinterpret_cast<ShmRegionHeader*>(base)),
+      capacity_(header_->ring_capacity),
+      peer_gone_(false) {}
+
+ShmChannel::~ShmChannel() {
+    munmap(base_, mapped_size_);
+    closeIfOpen(memfd_);
+    closeIfOpen(own_wake_fd_);
+    closeIfOpen(peer_wake_fd_);
+    closeIfOpen(control_fd_);
+}
+
+ShmChannel* ShmChannel::create(size_t ring_capacity) {
+    size_t capacity = SHM_MIN_RING_CAPACITY;
+    while (capacity < ring_capacity) {
+        capacity <<= 1;
+    }
+    size_t mapped_size = dataOffset() + 2 * capacity;
+
+    int memfd = memfd_create("mta-shm-ring", MFD_CLOEXEC);
+    if (memfd < 0) {
+        MTA_LOG_ERROR("shm ring: memfd_create failed: %s", std::strerror(errno));
+        return nullptr;
+    }
+    if (ftruncate(memfd, static_cast<off_t>(mapped_size)) != 0) {
+        MTA_LOG_ERROR("shm ring: ftruncate failed: %s", std::strerror(errno));
+        close(memfd);
+        return nullptr;
+    }
+
+    void* base = mmap(nullptr, mapped_size, PROT_READ | PROT_WRITE, MAP_SHARED, memfd, 0);
+    if (base == MAP_FAILED) {
+        MTA_LOG_ERROR("shm ring: mmap failed: %s", std::strerror(errno));
+        close(memfd);
+        return nullptr;
+    }
+
+    ShmRegionHeader* header = new (base) ShmRegionHeader();
+    header->magic = SHM_RING_MAGIC;
+    header->version = SHM_RING_VERSION;
+    header->ring_capacity = static_cast<uint32_t>(capacity);
+    for (int i = 0; i < 2; i++) {
+        header->waiting[i].store(0, std::memory_order_relaxed);
+        header->closed[i].store(0, std::memory_order_relaxed);
+        header->rings[i].head.store(0, std::memory_order_relaxed);
+        header->rings[i].tail.store(0, std::memory_order_relaxed);
+    }
+
+    int server_wake = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+    int client_wake = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+    if (server_wake < 0 || client_wake < 0) {
+        MTA_LOG_ERROR("shm ring: eventfd failed: %s", std::strerror(errno));
+        closeIfOpen(server_wake);
+        closeIfOpen(client_wake);
+        munmap(base, mapped_size);
+        close(memfd);
+        return nullptr;
+    }
+
+    return new ShmChannel(SERVER, memfd, server_wake, client_wake, -1,
+                          static_cast<uint8_t*>(base), mapped_size);
+}
+
+bool ShmChannel::sendDescriptors(int socket_fd) const {
+    // memfd, server wake, client wake
+    int fds[3] = {memfd_, own_wake_fd_, peer_wake_fd_};
+    uint8_t tag = 'R';
+    iovec iov = {&tag, sizeof(tag)};
+
+    alignas(cmsghdr) char control[CMSG_SPACE(sizeof(fds))];
+    std::memset(control, 0, sizeof(control));
+
+    msghdr message;
+    std::memset(&message, 0, sizeof(message));
+    message.msg_iov = &iov;
+    message.msg_iovlen = 1;
+    message.msg_control = control;
+    message.msg_controllen = sizeof(control);
+
+    cmsghdr* cmsg = CMSG_FIRSTHDR(&message);
+    cmsg->cmsg_level = SOL_SOCKET;
+    cmsg->cmsg_type = SCM_RIGHTS;
+    cmsg->cmsg_len = CMSG_LEN(sizeof(fds));
+    std::memcpy(CMSG_DATA(cmsg), fds, sizeof(fds));
+
+    if (sendmsg(socket_fd, &message, MSG_NOSIGNAL) != 1) {
+        MTA_LOG_ERROR("shm ring: failed to send descriptors: %s", std::strerror(errno));
+        return false;
+    }
+    return true;
+}
+
+ShmChannel* ShmChannel::connect(const std::string& path) {
+    sockaddr_un address;
+    std::memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    if (path.size() >= sizeof(address.sun_path)) {
+        MTA_LOG_ERROR("shm ring: socket path too long: %s", path.c_str());
+        return nullptr;
+    }
+    std::memcpy(address.sun_path, path.c_str(), path.size());
+
+    int socket_fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (socket_fd < 0 ||
+        ::connect(socket_fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0) {
+        MTA_LOG_ERROR("shm ring: connect to %s failed: %s", path.c_str(), std::strerror(errno));
+        closeIfOpen(socket_fd);
+        return nullptr;
+    }
+
+    int fds[3] = {-1, -1, -1};
+    uint8_t tag = 0;
+    iovec iov = {&tag, sizeof(tag)};
+    alignas(cmsghdr) char control[CMSG_SPACE(sizeof(fds))];
+
+    msghdr message;
+    std::memset(&message, 0, sizeof(message));
+    message.msg_iov = &iov;
+    message.msg_iovlen = 1;
+    message.msg_control = control;
+    message.msg_controllen = sizeof(control);
+
+    ssize_t received = recvmsg(socket_fd, &message, MSG_CMSG_CLOEXEC);
+    cmsghdr* cmsg = received == 1 ? CMSG_FIRSTHDR(&message) : nullptr;
+    if (cmsg == nullptr || cmsg->cmsg_level != SOL_SOCKET || cmsg->cmsg_type != SCM_RIGHTS ||
+        cmsg->cmsg_len != CMSG_LEN(sizeof(fds))) {
+        MTA_LOG_ERROR("shm ring: server did not hand over a ring");
+        close(socket_fd);
+        return nullptr;
+    }
+    std::memcpy(fds, CMSG_DATA(cmsg), sizeof(fds));
+
+    struct stat info;
+    void* base = MAP_FAILED;
+    if (fstat(fds[0], &info) == 0 && static_cast<size_t>(info.st_size) > dataOffset()) {
+        base = mmap(nullptr, info.st_size, PROT_READ | PROT_WRITE, MAP_SHARED, fds[0], 0);
+    }
+    const ShmRegionHeader* header = static_cast<const ShmRegionHeader*>(base);
+    if (base == MAP_FAILED || header->magic != SHM_RING_MAGIC || header->version != SHM_RING_VERSION ||
+        dataOffset() + 2 * static_cast<size_t>(header->ring_capacity) > static_cast<size_t>(info.st_size)) {
+        MTA_LOG_ERROR("shm ring: invalid ring region");
+        if (base != MAP_FAILED) {
+            munmap(base, info.st_size);
+        }
+        for (int fd : fds) {
+            close(fd);
+        }
+        close(socket_fd);
+        return nullptr;
+    }
+
+    return new ShmChannel(CLIENT, fds[0], fds[2], fds[1], socket_fd,
+                          static_cast<uint8_t*>(base), static_cast<size_t>(info.st_size));
+}
+
+ShmRingIndices& ShmChannel::inbound() {
+    return header_->rings[side_ == SERVER ? 0 : 1];
+}
+
+ShmRingIndices& ShmChannel::outbound() {
+    return header_->rings[side_ == SERVER ? 1 : 0];
+}
+
+uint8_t* ShmChannel::inboundData() {
+    return base_ + dataOffset() + (side_ == SERVER ? 0 : capacity_);
+}
+
+uint8_t* ShmChannel::outboundData() {
+    return base_ + dataOffset() + (side_ == SERVER ? capacity_ : 0);
+}
+
+// The indices live in memory the peer can write, so a buggy or hostile peer
+// can hand us any pair. Each is loaded once and checked before it is used to
+// index the ring; a bad pair fails the channel as if the peer had closed it.
+bool ShmChannel::indicesValid(uint64_t head, uint64_t tail) {
+    if (head <= tail && tail - head <= capacity_) {
+        return true;
+    }
+    if (!peer_gone_) {
+        MTA_LOG_ERROR("shm ring: corrupt ring indices head=%llu tail=%llu capacity=%llu",
+                      static_cast<unsigned long long>(head), static_cast<unsigned long long>(tail),
+                      static_cast<unsigned long long>(capacity_));
+        markPeerGone();
+    }
+    return false;
+}
+
+size_t ShmChannel::tryRead(uint8_t* data, size_t size) {
+    ShmRingIndices& ring = inbound();
+    uint64_t head = ring.head.load(std::memory_order_relaxed);
+    uint64_t tail = ring.tail.load(std::memory_order_acquire);
+    if (!indicesValid(head, tail)) {
+        return 0;
+    }
+    size_t count = static_cast<size_t>(std::min<uint64_t>(tail - head, size));
+    if (count == 0) {
+        return 0;
+    }
+
+    const uint8_t* ring_data = inboundData();
+    size_t offset = static_cast<size_t>(head & (capacity_ - 1));
+    size_t first = std::min(count, static_cast<size_t>(capacity_) - offset);
+    std::memcpy(data, ring_data + offset, first);
+    std::memcpy(data + first, ring_data, count - first);
+
+    ring.head.store(head + count, std::memory_order_release);
+    return count;
+}
+
+size_t ShmChannel::tryWrite(const uint8_t* data, size_t size) {
+    ShmRingIndices& ring = outbound();
+    uint64_t tail = ring.tail.load(std::memory_order_relaxed);
+    uint64_t head = ring.head.load(std::memory_order_acquire);
+    if (!indicesValid(head, tail)) {
+        return 0;
+    }
+    size_t count = static_cast<size_t>(std::min<uint64_t>(capacity_ - (tail - head), size));
+    if (count == 0) {
+        return 0;
+    }
+
+    uint8_t* ring_data = outboundData();
+    size_t offset = static_cast<size_t>(tail & (capacity_ - 1));
+    size_t first = std::min(count, static_cast<size_t>(capacity_) - offset);
+    std::memcpy(ring_data + offset, data, first);
+    std::memcpy(ring_data, data + first, count - first);
+
+    ring.tail.store(tail + count, std::memory_order_release);
+    return count;
+}
+
+// The waiter publishes its flag and then re-reads the ring; the other side
+// publishes ring progress and then reads the flag. The fences on both sides
+// guarantee at least one of them sees the other's store, so a wakeup is never
+// lost.
+void ShmChannel::prepareWait() {
+    header_->waiting[side_].store(1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+}
+
+void ShmChannel::finishWait() {
+    header_->waiting[side_].store(0, std::memory_order_relaxed);
+    uint64_t drained;
+    while (read(own_wake_fd_, &drained, sizeof(drained)) < 0 && errno == EINTR) {
+    }
+}
+
+int ShmChannel::wakeFd() const {
+    return own_wake_fd_;
+}
+
+void ShmChannel::notifyPeer() {
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (header_->waiting[1 - side_].load(std::memory_order_relaxed) != 0) {
+        signalEventFd(peer_wake_fd_);
+    }
+}
+
+void ShmChannel::wakeSelf() {
+    signalEventFd(own_wake_fd_);
+}
+
+void ShmChannel::markClosed() {
+    header_->closed[side_].store(1, std::memory_order_release);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    signalEventFd(peer_wake_fd_);
+}
+
+bool ShmChannel::peerClosed() const {
+    return peer_gone_ || header_->closed[1 - side_].load(std::memory_order_acquire) != 0;
+}
+
+void ShmChannel::markPeerGone() {
+    peer_gone_ = true;
+}
+
+bool ShmChannel::waitForWake() {
+    pollfd fds[2] = {
+        {own_wake_fd_, POLLIN, 0},
+        {control_fd_, POLLIN, 0},
+    };
+    int count = control_fd_ >= 0 ? 2 : 1;
+    int result;
+    do {
+        result = poll(fds, count, -1);
+    } while (result < 0 && errno == EINTR);
+    if (result < 0) {
+        return false;
+    }
+    // Nothing is ever sent on the rendezvous socket after the handover, so
+    // readability there means the server went away
+    if (count == 2 && fds[1].revents != 0) {
+        markPeerGone();
+    }
+    return true;
+}
+
+bool ShmChannel::readExact(uint8_t* data, size_t size) {
+    size_t done = 0;
+    while (done < size) {
+        size_t count = tryRead(data + done, size - done);
+        if (count == 0) {
+            if (peerClosed()) {
+                return false;
+            }
+            prepareWait();
+            count = tryRead(data + done, size - done);
+            if (count == 0 && !peerClosed() && !waitForWake()) {
+                finishWait();
+                return false;
+            }
+            finishWait();
+        }
+        if (count > 0) {
+            done += count;
+            notifyPeer();
+        }
+    }
+    return true;
+}
+
+bool ShmChannel::writeAll(const uint8_t* data, size_t size) {
+    size_t done = 0;
+    while (done < size) {
+        if (peerClosed()) {
+            return false;
+        }
+        size_t count = tryWrite(data + done, size - done);
+        if (count == 0) {
+            prepareWait();
+            count = tryWrite(data + done, size - done);
+            if (count == 0 && !peerClosed() && !waitForWake()) {
+                finishWait();
+                return false;
+            }
+            finishWait();
+        }
+        if (count > 0) {
+            done += count;
+            notifyPeer();
+        }
+    }
+    return true;
+}
@@ -0,0 +1,106 @@
+#ifndef SHM_RING_H
+#define SHM_RING_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+// Shared-memory channel between the server and one co-located client: a pair
+// of single-producer/single-consumer byte rings in a memfd mapping, one per
+// direction, plus one eventfd per side for wakeups.
+//
+// The server creates the region and hands the memfd and both eventfds to the
+// client over an AF_UNIX rendezvous socket (SCM_RIGHTS). Either side only
+// signals the other's eventfd when the peer has announced it is about to
+// sleep, so a busy exchange runs without syscalls on the data path.
+
+static const uint32_t SHM_RING_MAGIC = 0x4D544152;   // "MTAR"
+static const uint32_t SHM_RING_VERSION = 1;
+
+struct ShmRingIndices {
+    alignas(64) std::atomic<uint64_t> head;   // advanced by the consumer
+    alignas(64) std::atomic<uint64_t> tail;   // advanced by the producer
+};
+
+struct ShmRegionHeader {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t ring_capacity;                   // bytes per ring, power of two
+    uint32_t reserved;
+    alignas(64) std::atomic<uint32_t> waiting[2];   // indexed by ShmChannel::Side
+    std::atomic<uint32_t> closed[2];
+    ShmRingIndices rings[2];                  // [0] client -> server, [1] server -> client
+};
+
+static_assert(std::atomic<uint64_t>::is_always_lock_free, "shared ring indices must be lock-free");
+static_assert(std::atomic<uint32_t>::is_always_lock_free, "shared ring flags must be lock-free");
+
+class ShmChannel {
+public:
+    enum Side { SERVER = 0, CLIENT = 1 };
+
+    ~ShmChannel();
+    ShmChannel(const ShmChannel&) = delete;
+    ShmChannel& operator=(const ShmChannel&) = delete;
+
+    // Server side: map a fresh region with rings of at least `ring_capacity`
+    // bytes. Returns nullptr (and logs) on failure.
+    static ShmChannel* create(size_t ring_capacity);
+
+    // Server side: pass the memfd and eventfds to the client on `socket_fd`
+    bool sendDescriptors(int socket_fd) const;
+
+    // Client side: connect to the rendezvous socket at `path` and map the
+    // region the server hands back. Blocking; returns nullptr on failure.
+    static ShmChannel* connect(const std::string& path);
+
+    // Non-blocking ring access; both return the number of bytes moved. Ring
+    // indices that cannot be valid mark the peer gone and move nothing.
+    size_t tryRead(uint8_t* data, size_t size);
+    size_t tryWrite(const uint8_t* data, size_t size);
+
+    // Sleep protocol: announce, re-check the ring, then wait on wakeFd().
+    // After waking, drain the eventfd and clear the announcement.
+    void prepareWait();
+    void finishWait();
+    int wakeFd() const;
+
+    // Signal the peer if it announced it is waiting
+    void notifyPeer();
+    // Wake our own side (used when the peer disappears)
+    void wakeSelf();
+
+    // Orderly shutdown: the peer reads what is left, then sees end of stream
+    void markClosed();
+    bool peerClosed() const;
+    void markPeerGone();
+
+    // Client side blocking helpers built on the sleep protocol
+    bool readExact(uint8_t* data, size_t size);
+    bool writeAll(const uint8_t* data, size_t size);
+
+private:
+    ShmChannel(Side side, int memfd, int own_wake_fd, int peer_wake_fd, int control_fd,
+               uint8_t* base, size_t mapped_size);
+
+    ShmRingIndices& inbound();
+    ShmRingIndices& outbound();
+    uint8_t* inboundData();
+    uint8_t* outboundData();
+    bool indicesValid(uint64_t head, uint64_t tail);
+    bool waitForWake();
+
+    Side side_;
+    int memfd_;
+    int own_wake_fd_;
+    int peer_wake_fd_;
+    int control_fd_;                          // client side: rendezvous socket, kept open as a liveness signal
+    uint8_t* base_;
+    size_t mapped_size_;
+    ShmRegionHeader* header_;
+    uint64_t capacity_;
+    bool peer_gone_;
+};
+
+#endif // SHM_RING_H
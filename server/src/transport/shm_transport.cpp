@@ -0,0 +1,131 @@
+#include "shm_transport.h"
+#include "logger.h"
+#include <unistd.h>
+
+std::unique_ptr<ShmTransport> ShmTransport::accept(
+    boost::asio::local::stream_protocol::socket control, size_t ring_capacity) {
+    std::shared_ptr<ShmChannel> channel(ShmChannel::create(ring_capacity));
+    if (!channel) {
+        return nullptr;
+    }
+    if (!channel->sendDescriptors(control.native_handle())) {
+        return nullptr;
+    }
+
+    // The descriptor object takes ownership of what it wraps; the channel
+    // keeps its own copy for finishWait()
+    int wake_fd = dup(channel->wakeFd());
+    if (wake_fd < 0) {
+        MTA_LOG_ERROR("shm ring: failed to duplicate wake descriptor");
+        return nullptr;
+    }
+
+    return std::unique_ptr<ShmTransport>(new ShmTransport(std::move(control), channel, wake_fd));
+}
+
+ShmTransport::ShmTransport(boost::asio::local::stream_protocol::socket control,
+                           std::shared_ptr<ShmChannel> channel, int wake_fd)
+    : control_(std::move(control)),
+      channel_(std::move(channel)),
+      wake_(control_.get_executor(), wake_fd),
+      closed_(false) {
+    // The client never writes to the rendezvous socket after the handover:
+    // readability means it closed (or died). The handler holds the channel,
+    // so it stays valid even if it runs after the transport is gone.
+    control_.async_wait(boost::asio::socket_base::wait_read,
+        [channel = channel_](boost::system::error_code ec) {
+            if (!ec) {
+                channel->markPeerGone();
+                channel->wakeSelf();
+            }
+        });
+}
+
+ShmTransport::~ShmTransport() {
+    close();
+}
+
+boost::asio::any_io_executor ShmTransport::get_executor() {
+    return control_.get_executor();
+}
+
+boost::asio::awaitable<void> ShmTransport::wait(boost::system::error_code& ec) {
+    co_await wake_.async_wait(boost::asio::posix::descriptor_base::wait_read, transport_token(ec));
+    channel_->finishWait();
+}
+
+boost::asio::awaitable<std::size_t> ShmTransport::read_some(
+    boost::asio::mutable_buffer buffer, boost::system::error_code& ec) {
+    uint8_t* data = static_cast<uint8_t*>(buffer.data());
+    while (buffer.size() > 0) {
+        size_t count = channel_->tryRead(data, buffer.size());
+        if (count > 0) {
+            channel_->notifyPeer();
+            co_return count;
+        }
+        if (channel_->peerClosed()) {
+            ec = boost::asio::error::eof;
+            co_return 0;
+        }
+
+        channel_->prepareWait();
+        count = channel_->tryRead(data, buffer.size());
+        if (count > 0) {
+            channel_->finishWait();
+            channel_->notifyPeer();
+            co_return count;
+        }
+        if (channel_->peerClosed()) {
+            channel_->finishWait();
+            continue;
+        }
+
+        co_await wait(ec);
+        if (ec) {
+            co_return 0;
+        }
+    }
+    co_return 0;
+}
+
+boost::asio::awaitable<std::size_t> ShmTransport::write(
+    boost::asio::const_buffer buffer, boost::system::error_code& ec) {
+    const uint8_t* data = static_cast<const uint8_t*>(buffer.data());
+    size_t written = 0;
+    while (written < buffer.size()) {
+        if (channel_->peerClosed()) {
+            ec = boost::asio::error::broken_pipe;
+            co_return written;
+        }
+
+        size_t count = channel_->tryWrite(data + written, buffer.size() - written);
+        if (count == 0) {
+            channel_->prepareWait();
+            count = channel_->tryWrite(data + written, buffer.size() - written);
+            if (count == 0 && !channel_->peerClosed()) {
+                co_await wait(ec);
+                if (ec) {
+                    co_return written;
+                }
+                continue;
+            }
+            channel_->finishWait();
+        }
+
+        written += count;
+        channel_->notifyPeer();
+    }
+    co_return written;
+}
+
+void ShmTransport::close() {
+    if (closed_) {
+        return;
+    }
+    closed_ = true;
+    channel_->markClosed();
+
+    boost::system::error_code ignored;
+    wake_.close(ignored);
+    control_.close(ignored);
+}
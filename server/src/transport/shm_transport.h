@@ -0,0 +1,42 @@
+#pragma once
+
+#include <boost/asio.hpp>
+#include <memory>
+#include "session_transport.h"
+#include "shm_ring.h"
+
+// Server end of a shared-memory ring pair. Created once the client has
+// connected to the rendezvous socket; the socket then stays open only so
+// that the server notices when the client process goes away.
+class ShmTransport : public SessionTransport {
+public:
+    using SessionTransport::read_some;
+
+    // Maps a new ring pair and hands it to the client on `control`.
+    // Returns nullptr (and logs) when the rendezvous fails.
+    static std::unique_ptr<ShmTransport> accept(
+        boost::asio::local::stream_protocol::socket control, size_t ring_capacity);
+
+    ~ShmTransport() override;
+
+    boost::asio::any_io_executor get_executor() override;
+
+    boost::asio::awaitable<std::size_t> read_some(
+        boost::asio::mutable_buffer buffer, boost::system::error_code& ec) override;
+
+    boost::asio::awaitable<std::size_t> write(
+        boost::asio::const_buffer buffer, boost::system::error_code& ec) override;
+
+    void close() override;
+
+private:
+    ShmTransport(boost::asio::local::stream_protocol::socket control,
+                 std::shared_ptr<ShmChannel> channel, int wake_fd);
+
+    boost::asio::awaitable<void> wait(boost::system::error_code& ec);
+
+    boost::asio::local::stream_protocol::socket control_;
+    std::shared_ptr<ShmChannel> channel_;
+    boost::asio::posix::stream_descriptor wake_;
+    bool closed_;
+};
@@ -0,0 +1,117 @@
+#include "alloc_tracker.h"
+#include <algorithm>
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+static const size_t TAG_COUNT = static_cast<size_t>(MetricPhase::COUNT) + 1;
+
+// Threads beyond this share the last block through atomic adds
+static const size_t MAX_THREADS = 256;
+
+struct alignas(64) ThreadAllocCounters {
+    std::atomic<uint64_t> allocations[TAG_COUNT];
+    std::atomic<uint64_t> bytes[TAG_COUNT];
+};
+
+// Static storage: the hooks must not allocate to find their counters
+static ThreadAllocCounters thread_counters[MAX_THREADS];
+static std::atomic<size_t> next_thread{0};
+static thread_local ThreadAllocCounters* local_counters = nullptr;
+static thread_local bool shared_block = false;
+
+static ThreadAllocCounters& localCounters() {
+    if (local_counters == nullptr) {
+        size_t index = next_thread.fetch_add(1, std::memory_order_relaxed);
+        shared_block = index >= MAX_THREADS - 1;
+        local_counters = &thread_counters[shared_block ? MAX_THREADS - 1 : index];
+    }
+    return *local_counters;
+}
+
+static void bump(std::atomic<uint64_t>& cell, uint64_t amount) {
+    if (shared_block) {
+        cell.fetch_add(amount, std::memory_order_relaxed);
+    } else {
+        cell.store(cell.load(std::memory_order_relaxed) + amount, std::memory_order_relaxed);
+    }
+}
+
+static void countAllocation(size_t size) {
+    ThreadAllocCounters& counters = localCounters();
+    uint8_t tag = AllocTracker::current_phase;
+    bump(counters.allocations[tag], 1);
+    bump(counters.bytes[tag], size);
+}
+
+static AllocCounts sum(size_t first_tag, size_t last_tag) {
+    AllocCounts counts;
+    size_t threads = std::min(next_thread.load(std::memory_order_relaxed), MAX_THREADS);
+    for (size_t t = 0; t < threads; t++) {
+        for (size_t tag = first_tag; tag <= last_tag; tag++) {
+            counts.allocations += thread_counters[t].allocations[tag].load(std::memory_order_relaxed);
+            counts.bytes += thread_counters[t].bytes[tag].load(std::memory_order_relaxed);
+        }
+    }
+    return counts;
+}
+
+AllocCounts AllocTracker::phase(MetricPhase phase) {
+    return sum(static_cast<size_t>(phase), static_cast<size_t>(phase));
+}
+
+AllocCounts AllocTracker::untagged() {
+    return sum(UNTAGGED, UNTAGGED);
+}
+
+AllocCounts AllocTracker::total() {
+    return sum(0, TAG_COUNT - 1);
+}
+
+AllocCounts AllocTracker::thisThread() {
+    ThreadAllocCounters& counters = localCounters();
+    AllocCounts counts;
+    for (size_t tag = 0; tag < TAG_COUNT; tag++) {
+        counts.allocations += counters.allocations[tag].load(std::memory_order_relaxed);
+        counts.bytes += counters.bytes[tag].load(std::memory_order_relaxed);
+    }
+    return counts;
+}
+
+void* operator new(size_t size) {
+    countAllocation(size);
+    void* block = std::malloc(size == 0 ? 1 : size);
+    if (block == nullptr) {
+        throw std::bad_alloc();
+    }
+    return block;
+}
+
+void* operator new[](size_t size) {
+    return operator new(size);
+}
+
+void* operator new(size_t size, const std::nothrow_t&) noexcept {
+    countAllocation(size);
+    return std::malloc(size == 0 ? 1 : size);
+}
+
+void* operator new[](size_t size, const std::nothrow_t&) noexcept {
+    return operator new(size, std::nothrow);
+}
+
+void operator delete(void* block) noexcept {
+    std::free(block);
+}
+
+void operator delete[](void* block) noexcept {
+    std::free(block);
+}
+
+void operator delete(void* block, size_t) noexcept {
+    std::free(block);
+}
+
+void operator delete[](void* block, size_t) noexcept {
+    std::free(block);
+}
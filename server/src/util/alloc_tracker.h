@@ -0,0 +1,58 @@
+#ifndef ALLOC_TRACKER_H
+#define ALLOC_TRACKER_H
+
+#include <cstddef>
+#include <cstdint>
+#include "metrics.h"
+
+// Heap allocation accounting for the session hot path.
+//
+// Linking alloc_tracker.cpp replaces the global operator new/delete with
+// hooks that count every allocation and its size against the calling
+// thread's current phase tag. Counters are per thread and summed on demand,
+// the same scheme as Metrics. Sessions re-tag the thread with
+// MTA_ALLOC_PHASE whenever they resume, because several sessions take turns
+// on one IO thread.
+//
+// The server links the hooks only when configured with
+// -DMTA_ALLOC_TRACKING=ON, which also defines MTA_ALLOC_TRACKING. Without
+// it, MTA_ALLOC_PHASE expands to nothing. mta_bench always links the hooks.
+
+struct AllocCounts {
+    uint64_t allocations = 0;
+    uint64_t bytes = 0;
+};
+
+class AllocTracker {
+public:
+    // Tag used for allocations outside any session phase
+    static const uint8_t UNTAGGED = static_cast<uint8_t>(MetricPhase::COUNT);
+
+    static void setPhase(MetricPhase phase) {
+        current_phase = static_cast<uint8_t>(phase);
+    }
+
+    static void clearPhase() {
+        current_phase = UNTAGGED;
+    }
+
+    // Summed over all threads
+    static AllocCounts phase(MetricPhase phase);
+    static AllocCounts untagged();
+    static AllocCounts total();
+
+    // Calling thread only, all tags; cheap enough to bracket a benchmark loop
+    static AllocCounts thisThread();
+
+    static inline thread_local uint8_t current_phase = UNTAGGED;
+};
+
+#if defined(MTA_ALLOC_TRACKING)
+#define MTA_ALLOC_PHASE(phase) AllocTracker::setPhase(phase)
+#define MTA_ALLOC_CLEAR() AllocTracker::clearPhase()
+#else
+#define MTA_ALLOC_PHASE(phase) ((void)0)
+#define MTA_ALLOC_CLEAR() ((void)0)
+#endif
+
+#endif // ALLOC_TRACKER_H
@@ -0,0 +1,266 @@
+#include "logger.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdarg>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+static const size_t RECORD_TEXT_SIZE = 232;
+static const size_t RING_RECORDS = 1024;     // per thread, power of two
+static const auto SINK_INTERVAL = std::chrono::milliseconds(2);
+
+struct LogRecord {
+    int64_t timestamp_us;
+    uint32_t thread_index;
+    uint16_t length;
+    uint8_t level;
+    char text[RECORD_TEXT_SIZE];
+};
+
+// Written only by its thread, drained only by whoever holds the sink's drain
+// lock. Retired rings are dropped by the sink once empty.
+struct ThreadRing {
+    alignas(64) std::atomic<uint64_t> head{0};
+    alignas(64) std::atomic<uint64_t> tail{0};
+    std::atomic<bool> retired{false};
+    uint32_t thread_index = 0;
+    LogRecord records[RING_RECORDS];
+};
+
+class LogSink {
+public:
+    LogSink() : next_thread_index_(1), dropped_(0) {
+        std::thread([this]() { run(); }).detach();
+        std::atexit(Logger::flush);
+    }
+
+    std::shared_ptr<ThreadRing> registerThread() {
+        auto ring = std::make_shared<ThreadRing>();
+        std::lock_guard<std::mutex> lock(rings_mutex_);
+        ring->thread_index = next_thread_index_++;
+        rings_.push_back(ring);
+        return ring;
+    }
+
+    void countDrop() {
+        dropped_.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    uint64_t dropped() const {
+        return dropped_.load(std::memory_order_relaxed);
+    }
+
+    void drain() {
+        std::lock_guard<std::mutex> drain_lock(drain_mutex_);
+
+        std::vector<std::shared_ptr<ThreadRing>> rings;
+        {
+            std::lock_guard<std::mutex> lock(rings_mutex_);
+            rings = rings_;
+        }
+
+        out_.clear();
+        err_.clear();
+        for (auto& ring : rings) {
+            drainRing(*ring);
+        }
+
+        uint64_t dropped = dropped_.load(std::memory_order_relaxed);
+        if (dropped != reported_drops_) {
+            char line[96];
+            std::snprintf(line, sizeof(line), "logger: %llu messages dropped (ring full)\n",
+                          static_cast<unsigned long long>(dropped - reported_drops_));
+            err_ += line;
+            reported_drops_ = dropped;
+        }
+
+        if (!out_.empty()) {
+            std::fwrite(out_.data(), 1, out_.size(), stdout);
+            std::fflush(stdout);
+        }
+        if (!err_.empty()) {
+            std::fwrite(err_.data(), 1, err_.size(), stderr);
+            std::fflush(stderr);
+        }
+
+        std::lock_guard<std::mutex> lock(rings_mutex_);
+        rings_.erase(std::remove_if(rings_.begin(), rings_.end(), [](const std::shared_ptr<ThreadRing>& ring) {
+            return ring->retired.load(std::memory_order_acquire) &&
+                   ring->head.load(std::memory_order_relaxed) == ring->tail.load(std::memory_order_acquire);
+        }), rings_.end());
+    }
+
+private:
+    void run() {
+        for (;;) {
+            std::this_thread::sleep_for(SINK_INTERVAL);
+            drain();
+        }
+    }
+
+    void drainRing(ThreadRing& ring) {
+        static const char* level_names[] = {"TRACE", "DEBUG", "INFO ", "WARN ", "ERROR"};
+
+        uint64_t head = ring.head.load(std::memory_order_relaxed);
+        uint64_t tail = ring.tail.load(std::memory_order_acquire);
+        for (; head != tail; head++) {
+            const LogRecord& record = ring.records[head & (RING_RECORDS - 1)];
+
+            time_t seconds = static_cast<time_t>(record.timestamp_us / 1000000);
+            tm utc;
+            gmtime_r(&seconds, &utc);
+            char prefix[64];
+            int prefix_length = std::snprintf(prefix, sizeof(prefix), "%04d-%02d-%02dT%02d:%02d:%02d.%06dZ %s [t%u] ",
+                                              utc.tm_year + 1900, utc.tm_mon + 1, utc.tm_mday,
+                                              utc.tm_hour, utc.tm_min, utc.tm_sec,
+                                              static_cast<int>(record.timestamp_us % 1000000),
+                                              level_names[std::min<uint8_t>(record.level, MTA_LOG_LEVEL_ERROR)],
+                                              record.thread_index);
+
+            std::string& target = record.level >= MTA_LOG_LEVEL_WARN ? err_ : out_;
+            target.append(prefix, prefix_length);
+            target.append(record.text, record.length);
+            target += '\n';
+        }
+        ring.head.store(head, std::memory_order_release);
+    }
+
+    std::mutex rings_mutex_;
+    std::mutex drain_mutex_;
+    std::vector<std::shared_ptr<ThreadRing>> rings_;
+    uint32_t next_thread_index_;
+    std::atomic<uint64_t> dropped_;
+    uint64_t reported_drops_ = 0;
+    std::string out_;
+    std::string err_;
+};
+
+// Leaked on purpose: IO threads may still log while static destructors run
+static LogSink& logSink() {
+    static LogSink* sink = new LogSink();
+    return *sink;
+}
+
+// Marks the thread's ring retired on thread exit so the sink can drop it
+struct ThreadRingHandle {
+    std::shared_ptr<ThreadRing> ring;
+
+    ~ThreadRingHandle() {
+        if (ring) {
+            ring->retired.store(true, std::memory_order_release);
+        }
+    }
+};
+
+static ThreadRing& localRing() {
+    thread_local ThreadRingHandle handle;
+    if (!handle.ring) {
+        handle.ring = logSink().registerThread();
+    }
+    return *handle.ring;
+}
+
+static uint8_t initialLevel() {
+    const char* value = std::getenv("MTA_LOG_LEVEL");
+    if (value == nullptr) {
+        return MTA_LOG_LEVEL_INFO;
+    }
+
+    static const char* names[] = {"trace", "debug", "info", "warn", "error", "off"};
+    for (uint8_t level = 0; level <= MTA_LOG_LEVEL_OFF; level++) {
+        if (std::strcmp(value, names[level]) == 0) {
+            return level;
+        }
+    }
+    std::fprintf(stderr, "Ignoring invalid MTA_LOG_LEVEL=%s\n", value);
+    return MTA_LOG_LEVEL_INFO;
+}
+
+std::atomic<uint8_t> Logger::runtime_level_{initialLevel()};
+
+// Claims the next record of the calling thread's ring, or nullptr when full
+static LogRecord* beginRecord(ThreadRing& ring, LogLevel level) {
+    uint64_t tail = ring.tail.load(std::memory_order_relaxed);
+    if (tail - ring.head.load(std::memory_order_acquire) >= RING_RECORDS) {
+        logSink().countDrop();
+        return nullptr;
+    }
+
+    LogRecord& record = ring.records[tail & (RING_RECORDS - 1)];
+    record.timestamp_us = std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count();
+    record.thread_index = ring.thread_index;
+    record.level = static_cast<uint8_t>(level);
+    return &record;
+}
+
+static void commitRecord(ThreadRing& ring) {
+    ring.tail.store(ring.tail.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+}
+
+void Logger::write(LogLevel level, const char* format, ...) {
+    ThreadRing& ring = localRing();
+    LogRecord* record = beginRecord(ring, level);
+    if (record == nullptr) {
+        return;
+    }
+
+    va_list args;
+    va_start(args, format);
+    int length = std::vsnprintf(record->text, RECORD_TEXT_SIZE, format, args);
+    va_end(args);
+
+    if (length < 0) {
+        length = 0;
+    } else if (static_cast<size_t>(length) >= RECORD_TEXT_SIZE) {
+        // Truncated: mark it
+        length = RECORD_TEXT_SIZE - 1;
+        std::memcpy(record->text + length - 3, "...", 3);
+    }
+    record->length = static_cast<uint16_t>(length);
+    commitRecord(ring);
+}
+
+void Logger::writeHex(LogLevel level, const char* label, const uint8_t* data, size_t size, size_t max_bytes) {
+    ThreadRing& ring = localRing();
+    LogRecord* record = beginRecord(ring, level);
+    if (record == nullptr) {
+        return;
+    }
+
+    static const char digits[] = "0123456789ABCDEF";
+    int header = std::snprintf(record->text, RECORD_TEXT_SIZE, "%s (%zu bytes):", label, size);
+    size_t length = std::min(static_cast<size_t>(std::max(header, 0)), RECORD_TEXT_SIZE - 1);
+    size_t shown = std::min(size, max_bytes);
+    size_t i = 0;
+    for (; i < shown && length + 3 < RECORD_TEXT_SIZE - 16; i++) {
+        record->text[length++] = ' ';
+        record->text[length++] = digits[data[i] >> 4];
+        record->text[length++] = digits[data[i] & 0x0F];
+    }
+    if (i < size) {
+        std::memcpy(record->text + length, " ...", 4);
+        length += 4;
+    }
+    record->length = static_cast<uint16_t>(length);
+    commitRecord(ring);
+}
+
+void Logger::flush() {
+    logSink().drain();
+}
+
+void Logger::setLevel(LogLevel level) {
+    runtime_level_.store(static_cast<uint8_t>(level), std::memory_order_relaxed);
+}
+
+uint64_t Logger::dropped() {
+    return logSink().dropped();
+}
@@ -0,0 +1,123 @@
+#ifndef LOGGER_H
+#define LOGGER_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+// Asynchronous, level-gated logging.
+//
+// Callers format into a slot of a per-thread single-producer ring and return;
+// a background sink thread drains all rings and does the actual writes, so a
+// log call never takes a lock or flushes a stream. When a ring is full the
+// message is dropped and counted rather than blocking the IO thread.
+//
+// Format strings are printf-style and checked by the compiler. Calls below
+// MTA_LOG_COMPILED_LEVEL expand to nothing (the arguments are still
+// type-checked but never evaluated); the rest are filtered at run time by
+// the MTA_LOG_LEVEL environment variable (trace, debug, info, warn, error).
+
+#define MTA_LOG_LEVEL_TRACE 0
+#define MTA_LOG_LEVEL_DEBUG 1
+#define MTA_LOG_LEVEL_INFO  2
+#define MTA_LOG_LEVEL_WARN  3
+#define MTA_LOG_LEVEL_ERROR 4
+#define MTA_LOG_LEVEL_OFF   5
+
+#ifndef MTA_LOG_COMPILED_LEVEL
+#ifdef NDEBUG
+#define MTA_LOG_COMPILED_LEVEL MTA_LOG_LEVEL_INFO
+#else
+#define MTA_LOG_COMPILED_LEVEL MTA_LOG_LEVEL_DEBUG
+#endif
+#endif
+
+enum class LogLevel : uint8_t {
+    TRACE = MTA_LOG_LEVEL_TRACE,
+    DEBUG = MTA_LOG_LEVEL_DEBUG,
+    INFO = MTA_LOG_LEVEL_INFO,
+    WARN = MTA_LOG_LEVEL_WARN,
+    ERROR = MTA_LOG_LEVEL_ERROR,
+};
+
+class Logger {
+public:
+    static bool enabled(LogLevel level) {
+        return static_cast<uint8_t>(level) >= runtime_level_.load(std::memory_order_relaxed);
+    }
+
+    static void write(LogLevel level, const char* format, ...) __attribute__((format(printf, 2, 3)));
+
+    // Hex dump of at most `max_bytes` bytes of `data`
+    static void writeHex(LogLevel level, const char* label, const uint8_t* data, size_t size, size_t max_bytes);
+
+    // Never called; gives compiled-out statements format checking
+    __attribute__((format(printf, 1, 2))) static void check(const char*, ...) {}
+
+    // Drain every thread's ring now; used before exit and before callers
+    // redirect stdout
+    static void flush();
+
+    static void setLevel(LogLevel level);
+
+    // Messages dropped because a thread's ring was full
+    static uint64_t dropped();
+
+private:
+    static std::atomic<uint8_t> runtime_level_;
+};
+
+#define MTA_LOG_AT(level, ...)                              \
+    do {                                                    \
+        if (Logger::enabled(level)) {                       \
+            Logger::write(level, __VA_ARGS__);              \
+        }                                                   \
+    } while (0)
+
+#define MTA_LOG_HEX_AT(level, label, data, size, max_bytes)             \
+    do {                                                                \
+        if (Logger::enabled(level)) {                                   \
+            Logger::writeHex(level, label, data, size, max_bytes);      \
+        }                                                               \
+    } while (0)
+
+#define MTA_LOG_DISABLED(...)                               \
+    do {                                                    \
+        if (false) {                                        \
+            Logger::check(__VA_ARGS__);                     \
+        }                                                   \
+    } while (0)
+
+#if MTA_LOG_COMPILED_LEVEL <= MTA_LOG_LEVEL_TRACE
+#define MTA_LOG_TRACE(...) MTA_LOG_AT(LogLevel::TRACE, __VA_ARGS__)
+#else
+#define MTA_LOG_TRACE(...) MTA_LOG_DISABLED(__VA_ARGS__)
+#endif
+
+#if MTA_LOG_COMPILED_LEVEL <= MTA_LOG_LEVEL_DEBUG
+#define MTA_LOG_DEBUG(...) MTA_LOG_AT(LogLevel::DEBUG, __VA_ARGS__)
+#define MTA_LOG_DEBUG_HEX(label, data, size, max_bytes) MTA_LOG_HEX_AT(LogLevel::DEBUG, label, data, size, max_bytes)
+#else
+#define MTA_LOG_DEBUG(...) MTA_LOG_DISABLED(__VA_ARGS__)
+#define MTA_LOG_DEBUG_HEX(label, data, size, max_bytes) do { } while (0)
+#endif
+
+#if MTA_LOG_COMPILED_LEVEL <= MTA_LOG_LEVEL_INFO
+#define MTA_LOG_INFO(...) MTA_LOG_AT(LogLevel::INFO, __VA_ARGS__)
+#else
+#define MTA_LOG_INFO(...) MTA_LOG_DISABLED(__VA_ARGS__)
+#endif
+
+#if MTA_LOG_COMPILED_LEVEL <= MTA_LOG_LEVEL_WARN
+#define MTA_LOG_WARN(...) MTA_LOG_AT(LogLevel::WARN, __VA_ARGS__)
+#else
+#define MTA_LOG_WARN(...) MTA_LOG_DISABLED(__VA_ARGS__)
+#endif
+
+#if MTA_LOG_COMPILED_LEVEL <= MTA_LOG_LEVEL_ERROR
+#define MTA_LOG_ERROR(...) MTA_LOG_AT(LogLevel::ERROR, __VA_ARGS__)
+#else
+#define MTA_LOG_ERROR(...) MTA_LOG_DISABLED(__VA_ARGS__)
+#endif
+
+#endif // LOGGER_H
@@ -0,0 +1,280 @@
+#include "metrics.h"
+#include "logger.h"
+#if defined(MTA_ALLOC_TRACKING)
+#include "alloc_tracker.h"
+#endif
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cstdarg>
+#include <cstdio>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+static const int SUB_BUCKET_BITS = 4;
+static const size_t SUB_BUCKETS = size_t(1) << SUB_BUCKET_BITS;
+static const size_t HISTOGRAM_BUCKETS = (64 - SUB_BUCKET_BITS + 1) * SUB_BUCKETS;
+static const size_t PHASE_COUNT = static_cast<size_t>(MetricPhase::COUNT);
+static const size_t COUNTER_COUNT = static_cast<size_t>(MetricCounter::COUNT);
+
+// Exported cumulative bucket bounds are powers of two nanoseconds, which
+// coincide with histogram bucket edges: 2^10 ns (~1 us) .. 2^35 ns (~34 s)
+static const int EXPORT_MIN_EXPONENT = 10;
+static const int EXPORT_MAX_EXPONENT = 35;
+
+static const char* phase_names[PHASE_COUNT] = {
+    "accept", "read_delta", "initialize_bob", "serialize_setup",
+    "wait_for_alice", "execute_mta", "write_result", "session",
+};
+
+static size_t bucketIndex(uint64_t value) {
+    if (value < SUB_BUCKETS) {
+        return static_cast<size_t>(value);
+    }
+    int msb = 63 - __builtin_clzll(value);
+    int shift = msb - SUB_BUCKET_BITS;
+    return static_cast<size_t>(shift + 1) * SUB_BUCKETS + static_cast<size_t>((value >> shift) & (SUB_BUCKETS - 1));
+}
+
+// Smallest value that lands in `index`
+static uint64_t bucketLowerBound(size_t index) {
+    if (index < SUB_BUCKETS) {
+        return index;
+    }
+    int shift = static_cast<int>(index / SUB_BUCKETS) - 1;
+    return (SUB_BUCKETS + index % SUB_BUCKETS) << shift;
+}
+
+static uint64_t bucketUpperBound(size_t index) {
+    return index + 1 < HISTOGRAM_BUCKETS ? bucketLowerBound(index + 1) : UINT64_MAX;
+}
+
+// Single writer (the owning thread); scrapes read concurrently with relaxed
+// loads, which may see a sample in `count` before its bucket and vice versa
+static void bump(std::atomic<uint64_t>& cell, uint64_t amount) {
+    cell.store(cell.load(std::memory_order_relaxed) + amount, std::memory_order_relaxed);
+}
+
+struct alignas(64) ThreadHistogram {
+    std::atomic<uint64_t> count{0};
+    std::atomic<uint64_t> sum{0};
+    std::atomic<uint64_t> buckets[HISTOGRAM_BUCKETS] = {};
+};
+
+struct alignas(64) ThreadMetrics {
+    ThreadHistogram phases[PHASE_COUNT];
+    alignas(64) std::atomic<uint64_t> counters[COUNTER_COUNT] = {};
+};
+
+// Blocks outlive their threads so that totals never go backwards
+class MetricsRegistry {
+public:
+    ThreadMetrics* registerThread() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        threads_.push_back(std::make_unique<ThreadMetrics>());
+        return threads_.back().get();
+    }
+
+    template <typename Visitor>
+    void forEach(Visitor visitor) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        for (auto& metrics : threads_) {
+            visitor(*metrics);
+        }
+    }
+
+private:
+    std::mutex mutex_;
+    std::vector<std::unique_ptr<ThreadMetrics>> threads_;
+};
+
+// Leaked on purpose: threads may record while static destructors run
+static MetricsRegistry& registry() {
+    static MetricsRegistry* instance = new MetricsRegistry();
+    return *instance;
+}
+
+static ThreadMetrics& localMetrics() {
+    thread_local ThreadMetrics* metrics = registry().registerThread();
+    return *metrics;
+}
+
+void Metrics::recordPhase(MetricPhase phase, uint64_t nanoseconds) {
+    ThreadHistogram& histogram = localMetrics().phases[static_cast<size_t>(phase)];
+    bump(histogram.buckets[bucketIndex(nanoseconds)], 1);
+    bump(histogram.sum, nanoseconds);
+    bump(histogram.count, 1);
+}
+
+void Metrics::increment(MetricCounter counter, uint64_t amount) {
+    bump(localMetrics().counters[static_cast<size_t>(counter)], amount);
+}
+
+struct HistogramSnapshot {
+    uint64_t count = 0;
+    uint64_t sum = 0;
+    std::vector<uint64_t> buckets = std::vector<uint64_t>(HISTOGRAM_BUCKETS, 0);
+
+    // Upper edge of the bucket holding the q-th sample
+    uint64_t quantile(double q) const {
+        if (count == 0) {
+            return 0;
+        }
+        uint64_t rank = static_cast<uint64_t>(q * static_cast<double>(count - 1)) + 1;
+        uint64_t seen = 0;
+        for (size_t i = 0; i < HISTOGRAM_BUCKETS; i++) {
+            seen += buckets[i];
+            if (seen >= rank) {
+                return bucketUpperBound(i) - 1;
+            }
+        }
+        return bucketUpperBound(HISTOGRAM_BUCKETS - 1);
+    }
+};
+
+static void appendLine(std::string& out, const char* format, ...) __attribute__((format(printf, 2, 3)));
+
+static void appendLine(std::string& out, const char* format, ...) {
+    char line[512];
+    va_list args;
+    va_start(args, format);
+    int length = std::vsnprintf(line, sizeof(line), format, args);
+    va_end(args);
+    if (length > 0) {
+        out.append(line, std::min(static_cast<size_t>(length), sizeof(line) - 1));
+    }
+}
+
+static void collect(std::array<HistogramSnapshot, PHASE_COUNT>& phases,
+                    std::array<uint64_t, COUNTER_COUNT>& counters) {
+    registry().forEach([&](ThreadMetrics& metrics) {
+        for (size_t p = 0; p < PHASE_COUNT; p++) {
+            const ThreadHistogram& histogram = metrics.phases[p];
+            phases[p].count += histogram.count.load(std::memory_order_relaxed);
+            phases[p].sum += histogram.sum.load(std::memory_order_relaxed);
+            for (size_t i = 0; i < HISTOGRAM_BUCKETS; i++) {
+                phases[p].buckets[i] += histogram.buckets[i].load(std::memory_order_relaxed);
+            }
+        }
+        for (size_t c = 0; c < COUNTER_COUNT; c++) {
+            counters[c] += metrics.counters[c].load(std::memory_order_relaxed);
+        }
+    });
+}
+
+const char* Metrics::phaseName(MetricPhase phase) {
+    return phase_names[static_cast<size_t>(phase)];
+}
+
+PhaseSummary Metrics::summarizePhase(MetricPhase phase) {
+    std::array<HistogramSnapshot, PHASE_COUNT> phases;
+    std::array<uint64_t, COUNTER_COUNT> counters = {};
+    collect(phases, counters);
+
+    const HistogramSnapshot& snapshot = phases[static_cast<size_t>(phase)];
+    PhaseSummary summary;
+    summary.count = snapshot.count;
+    summary.mean_ns = snapshot.count > 0 ? static_cast<double>(snapshot.sum) / snapshot.count : 0;
+    summary.p50_ns = snapshot.quantile(0.5);
+    summary.p90_ns = snapshot.quantile(0.9);
+    summary.p99_ns = snapshot.quantile(0.99);
+    summary.max_ns = snapshot.quantile(1.0);
+    return summary;
+}
+
+std::string Metrics::renderPrometheus() {
+    std::array<HistogramSnapshot, PHASE_COUNT> phases;
+    std::array<uint64_t, COUNTER_COUNT> counters = {};
+    collect(phases, counters);
+
+    std::string out;
+    out.reserve(16384);
+
+    out += "# HELP mta_phase_duration_seconds Time spent in each MtA session phase.\n";
+    out += "# TYPE mta_phase_duration_seconds histogram\n";
+    for (size_t p = 0; p < PHASE_COUNT; p++) {
+        const HistogramSnapshot& snapshot = phases[p];
+        uint64_t cumulative = 0;
+        size_t bucket = 0;
+        for (int exponent = EXPORT_MIN_EXPONENT; exponent <= EXPORT_MAX_EXPONENT; exponent++) {
+            uint64_t bound = uint64_t(1) << exponent;
+            while (bucket < HISTOGRAM_BUCKETS && bucketUpperBound(bucket) <= bound) {
+                cumulative += snapshot.buckets[bucket++];
+            }
+            appendLine(out, "mta_phase_duration_seconds_bucket{phase=\"%s\",le=\"%.9g\"} %llu\n",
+                       phase_names[p], static_cast<double>(bound) * 1e-9,
+                       static_cast<unsigned long long>(cumulative));
+        }
+        // The bucket samples may trail `count` by in-flight records; clamp
+        // so the +Inf bucket is never below the others
+        uint64_t total = std::max(snapshot.count, cumulative);
+        appendLine(out, "mta_phase_duration_seconds_bucket{phase=\"%s\",le=\"+Inf\"} %llu\n",
+                   phase_names[p], static_cast<unsigned long long>(total));
+        appendLine(out, "mta_phase_duration_seconds_sum{phase=\"%s\"} %.9f\n",
+                   phase_names[p], static_cast<double>(snapshot.sum) * 1e-9);
+        appendLine(out, "mta_phase_duration_seconds_count{phase=\"%s\"} %llu\n",
+                   phase_names[p], static_cast<unsigned long long>(total));
+    }
+
+    static const double quantiles[] = {0.5, 0.9, 0.99, 0.999};
+    out += "# HELP mta_phase_latency_quantile_seconds Per-phase latency quantiles since start (~6% precision).\n";
+    out += "# TYPE mta_phase_latency_quantile_seconds gauge\n";
+    for (size_t p = 0; p < PHASE_COUNT; p++) {
+        for (double q : quantiles) {
+            appendLine(out, "mta_phase_latency_quantile_seconds{phase=\"%s\",quantile=\"%g\"} %.9f\n",
+                       phase_names[p], q, static_cast<double>(phases[p].quantile(q)) * 1e-9);
+        }
+    }
+
+    struct CounterInfo {
+        MetricCounter counter;
+        const char* name;
+        const char* help;
+    };
+    static const CounterInfo counter_info[] = {
+        {MetricCounter::SESSIONS_STARTED, "mta_sessions_started_total", "Sessions accepted."},
+        {MetricCounter::SESSIONS_COMPLETED, "mta_sessions_completed_total", "Sessions that sent BobMessages."},
+        {MetricCounter::SESSIONS_FAILED, "mta_sessions_failed_total", "Sessions that ended before completing."},
+        {MetricCounter::BYTES_RECEIVED, "mta_received_bytes_total", "Frame bytes received from clients."},
+        {MetricCounter::BYTES_SENT, "mta_sent_bytes_total", "Frame bytes sent to clients."},
+        {MetricCounter::SESSIONS_REJECTED, "mta_sessions_rejected_total",
+         "Connections sent a busy frame because the accept queue was full."},
+        {MetricCounter::SESSIONS_SHED, "mta_sessions_shed_total",
+         "Connections sent a busy frame because queueing delay stayed above target."},
+        {MetricCounter::SESSIONS_TIMED_OUT, "mta_sessions_timed_out_total",
+         "Sessions closed because the client missed a read or write deadline."},
+        {MetricCounter::RESULTS_NOT_JOURNALED, "mta_results_not_journaled_total",
+         "Completed sessions whose result did not fit in the result journal."},
+        {MetricCounter::EC_BATCHES, "mta_ec_batches_total", "Point batches run by the EC batch scheduler."},
+        {MetricCounter::EC_BATCH_JOBS, "mta_ec_batch_jobs_total", "Session jobs run in EC point batches."},
+        {MetricCounter::EC_BATCH_POINTS, "mta_ec_batch_points_total", "Points generated in EC point batches."},
+        {MetricCounter::EC_QUEUE_DELAY_US, "mta_ec_batch_queue_delay_microseconds_total",
+         "Time jobs waited for their EC point batch to run, summed over jobs."},
+    };
+    for (const CounterInfo& info : counter_info) {
+        appendLine(out, "# HELP %s %s\n# TYPE %s counter\n%s %llu\n", info.name, info.help, info.name, info.name,
+                   static_cast<unsigned long long>(counters[static_cast<size_t>(info.counter)]));
+    }
+
+#if defined(MTA_ALLOC_TRACKING)
+    // Per-MtA figures are these over mta_phase_duration_seconds_count
+    out += "# HELP mta_phase_allocations_total Heap allocations made in each session phase.\n";
+    out += "# TYPE mta_phase_allocations_total counter\n";
+    for (size_t p = 0; p < PHASE_COUNT; p++) {
+        appendLine(out, "mta_phase_allocations_total{phase=\"%s\"} %llu\n", phase_names[p],
+                   static_cast<unsigned long long>(AllocTracker::phase(static_cast<MetricPhase>(p)).allocations));
+    }
+    out += "# HELP mta_phase_allocated_bytes_total Heap bytes allocated in each session phase.\n";
+    out += "# TYPE mta_phase_allocated_bytes_total counter\n";
+    for (size_t p = 0; p < PHASE_COUNT; p++) {
+        appendLine(out, "mta_phase_allocated_bytes_total{phase=\"%s\"} %llu\n", phase_names[p],
+                   static_cast<unsigned long long>(AllocTracker::phase(static_cast<MetricPhase>(p)).bytes));
+    }
+#endif
+
+    appendLine(out, "# HELP mta_log_dropped_total Log messages dropped because a thread's ring was full.\n"
+                    "# TYPE mta_log_dropped_total counter\nmta_log_dropped_total %llu\n",
+               static_cast<unsigned long long>(Logger::dropped()));
+    return out;
+}
@@ -0,0 +1,56 @@
+#ifndef PROBES_H
+#define PROBES_H
+
+// USDT (SystemTap-style) static probes for perf, bpftrace and systemtap.
+//
+// Each probe compiles to a single nop plus an ELF note describing where its
+// arguments live, so an unattached probe costs one instruction and the
+// arguments are values the code already has in registers. Attaching rewrites
+// the nop into a breakpoint; no rebuild or restart is needed:
+//
+//   bpftrace -e 'usdt:./tcp_server:mta:phase { @[arg1] = hist(arg2); }'
+//
+// Provider "mta". Probes and arguments:
+//   session__start        session_id
+//   session__end          session_id, completed (0/1), session ns (0 if failed)
+//   state                 session_id, ProtocolState after the transition
+//   phase                 session_id, MetricPhase, phase ns
+//   cot__setup__start     session_id
+//   cot__setup__done      session_id, ok (0/1)
+//   cot__execute__start   session_id
+//   cot__execute__done    session_id, ok (0/1)
+//   serialize__start      session_id, ProbeMessage
+//   serialize__done       session_id, ProbeMessage, bytes
+//   deserialize__start    session_id, ProbeMessage, bytes
+//   deserialize__done     session_id, ProbeMessage, ok (0/1)
+//
+// Without <sys/sdt.h> (systemtap-sdt-dev) or with -DMTA_PROBES=OFF the
+// macros expand to nothing and their arguments are not evaluated, so the
+// arguments must never have side effects.
+
+#if defined(__has_include) && !defined(MTA_DISABLE_PROBES)
+#if __has_include(<sys/sdt.h>)
+#include <sys/sdt.h>
+#define MTA_PROBES_ENABLED 1
+#endif
+#endif
+
+// Message kinds carried by the (de)serialize probes
+enum ProbeMessage : int {
+    PROBE_CORRELATION_DELTA = 0,
+    PROBE_BOB_SETUP = 1,
+    PROBE_ALICE_MESSAGES = 2,
+    PROBE_BOB_MESSAGES = 3,
+};
+
+#if defined(MTA_PROBES_ENABLED)
+#define MTA_PROBE1(name, a1) DTRACE_PROBE1(mta, name, a1)
+#define MTA_PROBE2(name, a1, a2) DTRACE_PROBE2(mta, name, a1, a2)
+#define MTA_PROBE3(name, a1, a2, a3) DTRACE_PROBE3(mta, name, a1, a2, a3)
+#else
+#define MTA_PROBE1(name, a1) ((void)0)
+#define MTA_PROBE2(name, a1, a2) ((void)0)
+#define MTA_PROBE3(name, a1, a2, a3) ((void)0)
+#endif
+
+#endif // PROBES_H
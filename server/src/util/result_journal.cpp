@@ -0,0 +1,317 @@
+#include "result_journal.h"
+#include "logger.h"
+#include <algorithm>
+#include <bit>
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+static_assert(std::endian::native == std::endian::little, "ResultJournal maps its fields as they are in memory");
+
+static const char JOURNAL_MAGIC[8] = {'M', 'T', 'A', 'R', 'E', 'S', '0', '1'};
+static const size_t HEADER_SIZE = 4096;
+
+// Header fields
+static const size_t RECORD_SIZE_OFFSET = 8;
+static const size_t CAPACITY_OFFSET = 16;
+static const size_t COMMITTED_OFFSET = 24;
+static const size_t CONSUMED_OFFSET = 32;
+
+// Record fields
+static const size_t TIMESTAMP_OFFSET = 8;
+static const size_t SESSION_ID_OFFSET = 16;
+static const size_t ADDITIVE_SHARE_OFFSET = 20;
+static const size_t CORRELATION_CHECK_OFFSET = 24;
+static const size_t CHECKSUM_OFFSET = 28;
+
+// FNV-1a over the record before its checksum: catches a record torn by a
+// crash, not tampering
+static uint32_t checksum(const uint8_t* record) {
+    uint32_t hash = 2166136261u;
+    for (size_t i = 0; i < CHECKSUM_OFFSET; i++) {
+        hash = (hash ^ record[i]) * 16777619u;
+    }
+    return hash;
+}
+
+static uint64_t load64(const uint8_t* in) {
+    uint64_t value;
+    std::memcpy(&value, in, sizeof(value));
+    return value;
+}
+
+static uint32_t load32(const uint8_t* in) {
+    uint32_t value;
+    std::memcpy(&value, in, sizeof(value));
+    return value;
+}
+
+static void store64(uint8_t* out, uint64_t value) {
+    std::memcpy(out, &value, sizeof(value));
+}
+
+static void store32(uint8_t* out, uint32_t value) {
+    std::memcpy(out, &value, sizeof(value));
+}
+
+// Maps the journal at `fd` and checks its header; null on failure
+static uint8_t* mapJournal(int fd, const std::string& path, size_t& size) {
+    struct stat st;
+    if (::fstat(fd, &st) != 0 || static_cast<size_t>(st.st_size) < HEADER_SIZE) {
+        MTA_LOG_ERROR("%s is not a result journal", path.c_str());
+        return nullptr;
+    }
+    size = static_cast<size_t>(st.st_size);
+    void* map = ::mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (map == MAP_FAILED) {
+        MTA_LOG_ERROR("Cannot map result journal %s: %s", path.c_str(), std::strerror(errno));
+        return nullptr;
+    }
+
+    uint8_t* header = static_cast<uint8_t*>(map);
+    uint64_t capacity = load64(header + CAPACITY_OFFSET);
+    uint64_t committed = load64(header + COMMITTED_OFFSET);
+    uint64_t consumed = load64(header + CONSUMED_OFFSET);
+    if (std::memcmp(header, JOURNAL_MAGIC, sizeof(JOURNAL_MAGIC)) != 0 ||
+        load32(header + RECORD_SIZE_OFFSET) != ResultJournal::RECORD_SIZE || capacity == 0 ||
+        capacity > (size - HEADER_SIZE) / ResultJournal::RECORD_SIZE || consumed == 0 || consumed > committed) {
+        MTA_LOG_ERROR("%s is not a result journal of this version", path.c_str());
+        ::munmap(map, size);
+        return nullptr;
+    }
+    return header;
+}
+
+std::unique_ptr<ResultJournal> ResultJournal::open(const std::string& path, uint64_t capacity,
+                                                   std::chrono::milliseconds commit_interval) {
+    int fd = ::open(path.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0600);
+    if (fd < 0) {
+        MTA_LOG_ERROR("Cannot open result journal %s: %s", path.c_str(), std::strerror(errno));
+        return nullptr;
+    }
+    // One appender at a time: sequences are handed out by this process alone
+    if (::flock(fd, LOCK_EX | LOCK_NB) != 0) {
+        MTA_LOG_ERROR("Result journal %s is in use by another process", path.c_str());
+        ::close(fd);
+        return nullptr;
+    }
+
+    struct stat st;
+    if (::fstat(fd, &st) != 0) {
+        ::close(fd);
+        return nullptr;
+    }
+    if (st.st_size == 0) {
+        // Allocate every block up front, so appends never extend the file
+        // and a full disk shows here rather than as SIGBUS in a session
+        size_t size = HEADER_SIZE + static_cast<size_t>(capacity) * RECORD_SIZE;
+        uint8_t header[HEADER_SIZE] = {};
+        std::memcpy(header, JOURNAL_MAGIC, sizeof(JOURNAL_MAGIC));
+        store32(header + RECORD_SIZE_OFFSET, RECORD_SIZE);
+        store64(header + CAPACITY_OFFSET, capacity);
+        store64(header + COMMITTED_OFFSET, 1);
+        store64(header + CONSUMED_OFFSET, 1);
+        int error = capacity == 0 ? EINVAL : ::posix_fallocate(fd, 0, static_cast<off_t>(size));
+        if (error != 0 || ::pwrite(fd, header, sizeof(header), 0) != static_cast<ssize_t>(sizeof(header)) ||
+            ::fsync(fd) != 0) {
+            MTA_LOG_ERROR("Cannot create result journal %s: %s", path.c_str(),
+                          std::strerror(error != 0 ? error : errno));
+            ::ftruncate(fd, 0);
+            ::close(fd);
+            return nullptr;
+        }
+    }
+
+    size_t map_size;
+    uint8_t* map = mapJournal(fd, path, map_size);
+    if (map == nullptr) {
+        ::close(fd);
+        return nullptr;
+    }
+    std::unique_ptr<ResultJournal> journal(new ResultJournal(fd, map, map_size));
+    if (journal->capacity_ != capacity) {
+        MTA_LOG_INFO("Result journal %s keeps its capacity of %llu records", path.c_str(),
+                     static_cast<unsigned long long>(journal->capacity_));
+    }
+
+    // Records appended after the last commit before a restart are kept if
+    // they made it to the file whole
+    uint64_t next = journal->committed();
+    while (next - journal->consumed() < journal->capacity_ && journal->published(next)) {
+        next++;
+    }
+    journal->next_.store(next, std::memory_order_relaxed);
+    journal->commit();
+
+    journal->commit_thread_ = std::thread([raw = journal.get(), commit_interval] {
+        raw->commitLoop(commit_interval);
+    });
+    return journal;
+}
+
+std::unique_ptr<ResultJournal> ResultJournal::openReader(const std::string& path) {
+    int fd = ::open(path.c_str(), O_RDWR | O_CLOEXEC);
+    if (fd < 0) {
+        MTA_LOG_ERROR("Cannot open result journal %s: %s", path.c_str(), std::strerror(errno));
+        return nullptr;
+    }
+    size_t map_size;
+    uint8_t* map = mapJournal(fd, path, map_size);
+    if (map == nullptr) {
+        ::close(fd);
+        return nullptr;
+    }
+    return std::unique_ptr<ResultJournal>(new ResultJournal(fd, map, map_size));
+}
+
+ResultJournal::ResultJournal(int fd, uint8_t* map, size_t map_size)
+    : fd_(fd),
+      map_(map),
+      map_size_(map_size),
+      capacity_(load64(map + CAPACITY_OFFSET)),
+      next_(load64(map + COMMITTED_OFFSET)),
+      stopping_(false) {}
+
+ResultJournal::~ResultJournal() {
+    if (commit_thread_.joinable()) {
+        {
+            std::lock_guard<std::mutex> lock(commit_mutex_);
+            stopping_ = true;
+        }
+        commit_wakeup_.notify_one();
+        commit_thread_.join();
+        commit();
+    }
+    ::munmap(map_, map_size_);
+    ::close(fd_);
+}
+
+uint8_t* ResultJournal::slot(uint64_t sequence) const {
+    return map_ + HEADER_SIZE + ((sequence - 1) % capacity_) * RECORD_SIZE;
+}
+
+std::atomic_ref<uint64_t> ResultJournal::header64(size_t offset) const {
+    return std::atomic_ref<uint64_t>(*reinterpret_cast<uint64_t*>(map_ + offset));
+}
+
+uint64_t ResultJournal::committed() const {
+    return header64(COMMITTED_OFFSET).load(std::memory_order_acquire);
+}
+
+uint64_t ResultJournal::consumed() const {
+    return header64(CONSUMED_OFFSET).load(std::memory_order_acquire);
+}
+
+// The sequence is stored last, so a slot showing it holds the whole record
+bool ResultJournal::published(uint64_t sequence) const {
+    uint8_t* record = slot(sequence);
+    std::atomic_ref<uint64_t> stored(*reinterpret_cast<uint64_t*>(record));
+    return stored.load(std::memory_order_acquire) == sequence &&
+           load32(record + CHECKSUM_OFFSET) == checksum(record);
+}
+
+bool ResultJournal::append(uint32_t session_id, uint32_t additive_share, uint32_t correlation_check) {
+    uint64_t sequence = next_.load(std::memory_order_relaxed);
+    do {
+        // Slot in use by a record the reader has not taken yet
+        if (sequence - consumed() >= capacity_) {
+            return false;
+        }
+    } while (!next_.compare_exchange_weak(sequence, sequence + 1, std::memory_order_relaxed));
+
+    uint64_t timestamp_ns = static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count());
+    uint8_t record[RECORD_SIZE];
+    store64(record, sequence);
+    store64(record + TIMESTAMP_OFFSET, timestamp_ns);
+    store32(record + SESSION_ID_OFFSET, session_id);
+    store32(record + ADDITIVE_SHARE_OFFSET, additive_share);
+    store32(record + CORRELATION_CHECK_OFFSET, correlation_check);
+    store32(record + CHECKSUM_OFFSET, checksum(record));
+
+    uint8_t* target = slot(sequence);
+    std::memcpy(target + 8, record + 8, RECORD_SIZE - 8);
+    std::atomic_ref<uint64_t>(*reinterpret_cast<uint64_t*>(target)).store(sequence, std::memory_order_release);
+    return true;
+}
+
+// msync of slots [first, end), in at most two ranges when they wrap
+bool ResultJournal::syncRecords(uint64_t first, uint64_t end) {
+    static const size_t page_size = static_cast<size_t>(::sysconf(_SC_PAGESIZE));
+    auto syncSlots = [this](size_t from, size_t to) {
+        size_t begin = (HEADER_SIZE + from * RECORD_SIZE) / page_size * page_size;
+        size_t finish = std::min(map_size_, (HEADER_SIZE + to * RECORD_SIZE + page_size - 1) / page_size * page_size);
+        return ::msync(map_ + begin, finish - begin, MS_SYNC) == 0;
+    };
+    size_t from = static_cast<size_t>((first - 1) % capacity_);
+    size_t count = static_cast<size_t>(end - first);
+    if (from + count <= capacity_) {
+        return syncSlots(from, from + count);
+    }
+    return syncSlots(from, capacity_) && syncSlots(0, from + count - capacity_);
+}
+
+void ResultJournal::commit() {
+    std::lock_guard<std::mutex> lock(sync_mutex_);
+    uint64_t first = committed();
+    uint64_t end = next_.load(std::memory_order_acquire);
+
+    // Stop at the first record still being written; it goes with the next
+    // commit
+    uint64_t last = first;
+    while (last < end && published(last)) {
+        last++;
+    }
+    if (last == first) {
+        return;
+    }
+    if (!syncRecords(first, last)) {
+        MTA_LOG_ERROR("Cannot sync result journal: %s", std::strerror(errno));
+        return;
+    }
+    header64(COMMITTED_OFFSET).store(last, std::memory_order_release);
+    if (::msync(map_, HEADER_SIZE, MS_SYNC) != 0) {
+        MTA_LOG_ERROR("Cannot sync result journal header: %s", std::strerror(errno));
+    }
+}
+
+void ResultJournal::commitLoop(std::chrono::milliseconds interval) {
+    std::unique_lock<std::mutex> lock(commit_mutex_);
+    while (!stopping_) {
+        commit_wakeup_.wait_for(lock, interval);
+        lock.unlock();
+        commit();
+        lock.lock();
+    }
+}
+
+bool ResultJournal::read(uint64_t sequence, Record& record) const {
+    if (sequence == 0 || sequence >= committed() || !published(sequence)) {
+        return false;
+    }
+    const uint8_t* data = slot(sequence);
+    record.sequence = sequence;
+    record.timestamp_ns = load64(data + TIMESTAMP_OFFSET);
+    record.session_id = load32(data + SESSION_ID_OFFSET);
+    record.additive_share = load32(data + ADDITIVE_SHARE_OFFSET);
+    record.correlation_check = load32(data + CORRELATION_CHECK_OFFSET);
+    return true;
+}
+
+void ResultJournal::consume(uint64_t sequence) {
+    uint64_t limit = committed();
+    if (sequence > limit) {
+        sequence = limit;
+    }
+    if (sequence <= consumed()) {
+        return;
+    }
+    header64(CONSUMED_OFFSET).store(sequence, std::memory_order_release);
+    if (::msync(map_, HEADER_SIZE, MS_SYNC) != 0) {
+        MTA_LOG_ERROR("Cannot sync result journal header: %s", std::strerror(errno));
+    }
+}
@@ -0,0 +1,93 @@
+#ifndef RESULT_JOURNAL_H
+#define RESULT_JOURNAL_H
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+
+// Durable record of completed sessions for the downstream signing service:
+// Bob's additive share and correlation check, appended by tcp_server
+// (MTA_RESULT_JOURNAL_PATH) and read by mta_results.
+//
+// The file is pre-allocated and memory-mapped, little-endian:
+//   header, 4096 bytes: magic "MTARES01", uint32 record size, uint32 0,
+//                       uint64 capacity (records), uint64 committed,
+//                       uint64 consumed
+//   records, a ring of `capacity` slots of 32 bytes:
+//                       uint64 sequence, uint64 timestamp_ns (Unix time),
+//                       uint32 session_id, uint32 additive_share,
+//                       uint32 correlation_check, uint32 checksum
+// Record n (sequences start at 1) sits in slot (n - 1) % capacity.
+//
+// append() only stores into the mapping. A commit thread syncs the records
+// appended since its last pass every commit interval, then advances
+// `committed` in the header: records below it are on disk. The reader
+// advances `consumed` past what it has taken; a record is never written
+// over before it has been consumed, so a full ring refuses new records.
+class ResultJournal {
+public:
+    static const size_t RECORD_SIZE = 32;
+
+    struct Record {
+        uint64_t sequence;
+        uint64_t timestamp_ns;
+        uint32_t session_id;
+        uint32_t additive_share;
+        uint32_t correlation_check;
+    };
+
+    // Opens the journal at `path` for appending, creating it with room for
+    // `capacity` records if there is none, and starts the commit thread.
+    // Null (and an error logged) on failure, including when another process
+    // is appending to it.
+    static std::unique_ptr<ResultJournal> open(const std::string& path, uint64_t capacity,
+                                               std::chrono::milliseconds commit_interval);
+    // Opens an existing journal to read, alongside the process appending
+    static std::unique_ptr<ResultJournal> openReader(const std::string& path);
+    ~ResultJournal();
+
+    // Thread-safe and free of system calls; false when the ring is full of
+    // records not yet consumed
+    bool append(uint32_t session_id, uint32_t additive_share, uint32_t correlation_check);
+    // Syncs everything appended so far, without waiting for the thread
+    void commit();
+
+    uint64_t capacity() const { return capacity_; }
+    uint64_t committed() const;
+    uint64_t consumed() const;
+    // Record `sequence`, if it is committed and intact
+    bool read(uint64_t sequence, Record& record) const;
+    // Releases the records below `sequence` to be written over
+    void consume(uint64_t sequence);
+
+private:
+    ResultJournal(int fd, uint8_t* map, size_t map_size);
+
+    uint8_t* slot(uint64_t sequence) const;
+    std::atomic_ref<uint64_t> header64(size_t offset) const;
+    bool published(uint64_t sequence) const;
+    bool syncRecords(uint64_t first, uint64_t end);
+    void commitLoop(std::chrono::milliseconds interval);
+
+    int fd_;
+    uint8_t* map_;
+    size_t map_size_;
+    uint64_t capacity_;
+    std::atomic<uint64_t> next_;        // sequence the next append takes
+
+    std::mutex sync_mutex_;             // one commit at a time
+
+    // Commit thread; absent in readers
+    std::mutex commit_mutex_;
+    std::condition_variable commit_wakeup_;
+    bool stopping_;
+    std::thread commit_thread_;
+};
+
+#endif // RESULT_JOURNAL_H
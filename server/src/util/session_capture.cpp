@@ -0,0 +1,138 @@
+#include "session_capture.h"
+#include "logger.h"
+#include <cerrno>
+#include <cstring>
+
+static const char CAPTURE_MAGIC[8] = {'M', 'T', 'A', 'C', 'A', 'P', 'T', '1'};
+static const size_t RECORD_HEADER_SIZE = 8 + 4 + 1 + 4;
+static const size_t FLUSH_THRESHOLD = 256 * 1024;
+static const uint64_t FLUSH_INTERVAL_NS = 1000000000ULL;
+
+static void putLittleEndian(uint8_t* out, uint64_t value, size_t bytes) {
+    for (size_t i = 0; i < bytes; i++) {
+        out[i] = static_cast<uint8_t>(value >> (8 * i));
+    }
+}
+
+static uint64_t getLittleEndian(const uint8_t* in, size_t bytes) {
+    uint64_t value = 0;
+    for (size_t i = 0; i < bytes; i++) {
+        value |= static_cast<uint64_t>(in[i]) << (8 * i);
+    }
+    return value;
+}
+
+std::unique_ptr<CaptureFile> CaptureFile::create(const std::string& path) {
+    std::FILE* file = std::fopen(path.c_str(), "wb");
+    if (file == nullptr) {
+        MTA_LOG_ERROR("Cannot open capture file %s: %s", path.c_str(), std::strerror(errno));
+        return nullptr;
+    }
+    if (std::fwrite(CAPTURE_MAGIC, 1, sizeof(CAPTURE_MAGIC), file) != sizeof(CAPTURE_MAGIC)) {
+        MTA_LOG_ERROR("Cannot write capture file %s", path.c_str());
+        std::fclose(file);
+        return nullptr;
+    }
+    return std::unique_ptr<CaptureFile>(new CaptureFile(file));
+}
+
+CaptureFile::CaptureFile(std::FILE* file)
+    : file_(file),
+      opened_(std::chrono::steady_clock::now()) {}
+
+CaptureFile::~CaptureFile() {
+    std::fclose(file_);
+}
+
+void CaptureFile::write(const uint8_t* data, size_t size) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (std::fwrite(data, 1, size, file_) != size) {
+        MTA_LOG_WARN("Short write to capture file");
+    }
+    std::fflush(file_);
+}
+
+uint64_t CaptureFile::elapsedNanoseconds() const {
+    return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now() - opened_).count());
+}
+
+bool CaptureFile::readAll(const std::string& path, std::vector<CaptureRecord>& records) {
+    std::FILE* file = std::fopen(path.c_str(), "rb");
+    if (file == nullptr) {
+        MTA_LOG_ERROR("Cannot open capture file %s: %s", path.c_str(), std::strerror(errno));
+        return false;
+    }
+
+    char magic[sizeof(CAPTURE_MAGIC)];
+    if (std::fread(magic, 1, sizeof(magic), file) != sizeof(magic) ||
+        std::memcmp(magic, CAPTURE_MAGIC, sizeof(magic)) != 0) {
+        MTA_LOG_ERROR("%s is not a session capture", path.c_str());
+        std::fclose(file);
+        return false;
+    }
+
+    // Payload lengths come from the file, so no record may claim more bytes
+    // than are left in it; a damaged length would otherwise allocate up to 4 GB
+    std::fseek(file, 0, SEEK_END);
+    long file_size = std::ftell(file);
+    std::fseek(file, sizeof(CAPTURE_MAGIC), SEEK_SET);
+
+    uint8_t header[RECORD_HEADER_SIZE];
+    while (std::fread(header, 1, sizeof(header), file) == sizeof(header)) {
+        CaptureRecord record;
+        record.timestamp_ns = getLittleEndian(header, 8);
+        record.session_id = static_cast<uint32_t>(getLittleEndian(header + 8, 4));
+        record.direction = static_cast<CaptureDirection>(header[12]);
+        uint64_t length = getLittleEndian(header + 13, 4);
+        if (length > static_cast<uint64_t>(file_size - std::ftell(file))) {
+            MTA_LOG_WARN("Capture %s ends with a truncated record", path.c_str());
+            break;
+        }
+        record.payload.resize(static_cast<size_t>(length));
+        if (std::fread(record.payload.data(), 1, record.payload.size(), file) != record.payload.size()) {
+            // A capture cut off mid-record (server killed): keep what is whole
+            MTA_LOG_WARN("Capture %s ends with a truncated record", path.c_str());
+            break;
+        }
+        records.push_back(std::move(record));
+    }
+
+    std::fclose(file);
+    return true;
+}
+
+CaptureBuffer::CaptureBuffer(CaptureFile& file)
+    : file_(file),
+      last_flush_ns_(0) {
+    buffer_.reserve(FLUSH_THRESHOLD + 8192);
+}
+
+CaptureBuffer::~CaptureBuffer() {
+    flush();
+}
+
+void CaptureBuffer::record(uint32_t session_id, CaptureDirection direction, const uint8_t* payload, size_t size) {
+    uint64_t now = file_.elapsedNanoseconds();
+
+    uint8_t header[RECORD_HEADER_SIZE];
+    putLittleEndian(header, now, 8);
+    putLittleEndian(header + 8, session_id, 4);
+    header[12] = static_cast<uint8_t>(direction);
+    putLittleEndian(header + 13, size, 4);
+    buffer_.insert(buffer_.end(), header, header + sizeof(header));
+    buffer_.insert(buffer_.end(), payload, payload + size);
+
+    if (buffer_.size() >= FLUSH_THRESHOLD || now - last_flush_ns_ >= FLUSH_INTERVAL_NS) {
+        flush();
+        last_flush_ns_ = now;
+    }
+}
+
+void CaptureBuffer::flush() {
+    if (buffer_.empty()) {
+        return;
+    }
+    file_.write(buffer_.data(), buffer_.size());
+    buffer_.clear();
+}
@@ -0,0 +1,73 @@
+#ifndef SESSION_CAPTURE_H
+#define SESSION_CAPTURE_H
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+// Capture of session traffic for offline replay (mta_replay).
+//
+// File layout, little-endian: the 8-byte magic "MTACAPT1", then records of
+//   uint64 timestamp_ns   since the capture was opened
+//   uint32 session_id
+//   uint8  direction      CaptureDirection
+//   uint32 length
+//   uint8  payload[length]
+// Frames are recorded without their 4-byte size prefix. Records of different
+// sessions interleave; those of one session are in order.
+
+enum class CaptureDirection : uint8_t {
+    FROM_CLIENT = 0,
+    TO_CLIENT = 1,
+};
+
+struct CaptureRecord {
+    uint64_t timestamp_ns;
+    uint32_t session_id;
+    CaptureDirection direction;
+    std::vector<uint8_t> payload;
+};
+
+// The output file, shared by all IO threads; only whole chunks are written to it
+class CaptureFile {
+public:
+    // nullptr (and an error logged) when the file cannot be created
+    static std::unique_ptr<CaptureFile> create(const std::string& path);
+    ~CaptureFile();
+
+    void write(const uint8_t* data, size_t size);
+    uint64_t elapsedNanoseconds() const;
+
+    static bool readAll(const std::string& path, std::vector<CaptureRecord>& records);
+
+private:
+    CaptureFile(std::FILE* file);
+
+    std::mutex mutex_;
+    std::FILE* file_;
+    std::chrono::steady_clock::time_point opened_;
+};
+
+// Per-IO-thread staging buffer: records are appended without locking and
+// handed to the file in chunks, at least once a second while traffic flows
+// and when the buffer is destroyed
+class CaptureBuffer {
+public:
+    explicit CaptureBuffer(CaptureFile& file);
+    ~CaptureBuffer();
+
+    void record(uint32_t session_id, CaptureDirection direction, const uint8_t* payload, size_t size);
+    void flush();
+
+private:
+    CaptureFile& file_;
+    std::vector<uint8_t> buffer_;
+    uint64_t last_flush_ns_;
+};
+
+#endif // SESSION_CAPTURE_H
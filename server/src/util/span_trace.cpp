@@ -0,0 +1,137 @@
+#include "span_trace.h"
+#include "logger.h"
+#include <atomic>
+#include <cstdio>
+#include <memory>
+#include <mutex>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <vector>
+
+static const size_t SPANS_PER_THREAD = 16384;
+
+static std::atomic<uint32_t> sample_every{0};
+
+struct Span {
+    const char* name;
+    const char* category;
+    int64_t start_ns;
+    int64_t duration_ns;
+    const char* arg_name;
+    uint64_t arg_value;
+};
+
+// The owning thread writes; writeChromeTrace() takes the lock to read
+struct ThreadSpans {
+    std::mutex mutex;
+    uint32_t tid = static_cast<uint32_t>(::syscall(SYS_gettid));
+    std::vector<Span> ring;
+    size_t next = 0;
+    bool wrapped = false;
+};
+
+// Rings outlive their threads so that a dump still shows finished threads
+class SpanRegistry {
+public:
+    ThreadSpans* registerThread() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        threads_.push_back(std::make_unique<ThreadSpans>());
+        return threads_.back().get();
+    }
+
+    template <typename Visitor>
+    void forEach(Visitor visitor) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        for (auto& spans : threads_) {
+            visitor(*spans);
+        }
+    }
+
+private:
+    std::mutex mutex_;
+    std::vector<std::unique_ptr<ThreadSpans>> threads_;
+};
+
+// Leaked on purpose, like the metrics registry
+static SpanRegistry& registry() {
+    static SpanRegistry* instance = new SpanRegistry();
+    return *instance;
+}
+
+static ThreadSpans& localSpans() {
+    thread_local ThreadSpans* spans = registry().registerThread();
+    return *spans;
+}
+
+void SpanTrace::enable(uint32_t every) {
+    sample_every.store(every, std::memory_order_relaxed);
+}
+
+bool SpanTrace::enabled() {
+    return sample_every.load(std::memory_order_relaxed) != 0;
+}
+
+bool SpanTrace::sample() {
+    uint32_t every = sample_every.load(std::memory_order_relaxed);
+    if (every == 0) {
+        return false;
+    }
+    thread_local uint32_t calls = 0;
+    return ++calls % every == 0;
+}
+
+void SpanTrace::record(const char* name, const char* category, Clock::time_point start, Clock::time_point end,
+                       const char* arg_name, uint64_t arg_value) {
+    ThreadSpans& spans = localSpans();
+    std::lock_guard<std::mutex> lock(spans.mutex);
+    if (spans.ring.empty()) {
+        spans.ring.resize(SPANS_PER_THREAD);
+    }
+    spans.ring[spans.next] = Span{
+        name, category,
+        std::chrono::duration_cast<std::chrono::nanoseconds>(start.time_since_epoch()).count(),
+        std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count(),
+        arg_name, arg_value,
+    };
+    if (++spans.next == spans.ring.size()) {
+        spans.next = 0;
+        spans.wrapped = true;
+    }
+}
+
+bool SpanTrace::writeChromeTrace(const std::string& path) {
+    std::string temp_path = path + ".tmp";
+    std::FILE* file = std::fopen(temp_path.c_str(), "w");
+    if (file == nullptr) {
+        MTA_LOG_ERROR("Cannot create trace file %s", temp_path.c_str());
+        return false;
+    }
+
+    int pid = static_cast<int>(::getpid());
+    size_t written = 0;
+    std::fprintf(file, "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[\n");
+    registry().forEach([&](ThreadSpans& spans) {
+        std::lock_guard<std::mutex> lock(spans.mutex);
+        size_t count = spans.wrapped ? spans.ring.size() : spans.next;
+        size_t first = spans.wrapped ? spans.next : 0;
+        for (size_t i = 0; i < count; i++) {
+            const Span& span = spans.ring[(first + i) % spans.ring.size()];
+            // Chrome trace timestamps are microseconds
+            std::fprintf(file, "%s{\"name\":\"%s\",\"cat\":\"%s\",\"ph\":\"X\",\"pid\":%d,\"tid\":%u,"
+                               "\"ts\":%.3f,\"dur\":%.3f,\"args\":{\"%s\":%llu}}",
+                         written++ == 0 ? "" : ",\n", span.name, span.category, pid, spans.tid,
+                         span.start_ns / 1e3, span.duration_ns / 1e3, span.arg_name,
+                         static_cast<unsigned long long>(span.arg_value));
+        }
+    });
+    std::fprintf(file, "\n]}\n");
+
+    bool ok = std::ferror(file) == 0;
+    ok = std::fclose(file) == 0 && ok;
+    if (!ok || std::rename(temp_path.c_str(), path.c_str()) != 0) {
+        MTA_LOG_ERROR("Cannot write trace file %s", path.c_str());
+        return false;
+    }
+    MTA_LOG_INFO("Wrote %zu trace spans to %s", written, path.c_str());
+    return true;
+}
@@ -0,0 +1,37 @@
+#ifndef SPAN_TRACE_H
+#define SPAN_TRACE_H
+
+#include <chrono>
+#include <cstdint>
+#include <string>
+
+// Flight recorder of timed spans for per-session timelines.
+//
+// Each thread appends complete spans to its own fixed-size ring (the newest
+// 16384 are kept), so recording takes an uncontended lock and a copy, and a
+// thread that never records allocates nothing. writeChromeTrace() dumps every
+// ring as Chrome trace event JSON, which chrome://tracing and the Perfetto UI
+// both open; the server calls it on SIGUSR2 (MTA_TRACE_PATH).
+//
+// Sessions are sampled one in `sample_every` per thread, so tracing can stay
+// on in production. Names and argument names must be string literals: only
+// the pointers are stored.
+class SpanTrace {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    // 0 turns tracing off (the default)
+    static void enable(uint32_t sample_every);
+    static bool enabled();
+
+    // True for one call in `sample_every` on the calling thread
+    static bool sample();
+
+    static void record(const char* name, const char* category, Clock::time_point start, Clock::time_point end,
+                       const char* arg_name, uint64_t arg_value);
+
+    // Written to a temporary file and renamed over `path`; false on I/O errors
+    static bool writeChromeTrace(const std::string& path);
+};
+
+#endif // SPAN_TRACE_H
@@ -0,0 +1,290 @@
+// Round trips and malformed input for the four BinaryCodec messages and for
+// CryptoOperations::decompressPoints. Prints each failed check and exits
+// non-zero if there was one.
+
+#include <cstdio>
+#include <cstring>
+#include <vector>
+#include "binary_codec.h"
+#include "crypto_operations.h"
+
+static int failures = 0;
+
+#define CHECK(condition)                                                                    \
+    do {                                                                                    \
+        if (!(condition)) {                                                                 \
+            std::fprintf(stderr, "%s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, #condition); \
+            failures++;                                                                     \
+        }                                                                                   \
+    } while (0)
+
+static const size_t OT_INSTANCES = 32;
+
+// The generator G, uncompressed
+static const uint8_t GENERATOR[65] = {
+    0x04,
+    0x79, 0xBE, 0x66, 0x7E, 0xF9, 0xDC, 0xBB, 0xAC, 0x55, 0xA0, 0x62, 0x95, 0xCE, 0x87, 0x0B, 0x07,
+    0x02, 0x9B, 0xFC, 0xDB, 0x2D, 0xCE, 0x28, 0xD9, 0x59, 0xF2, 0x81, 0x5B, 0x16, 0xF8, 0x17, 0x98,
+    0x48, 0x3A, 0xDA, 0x77, 0x26, 0xA3, 0xC4, 0x65, 0x5D, 0xA4, 0xFB, 0xFC, 0x0E, 0x11, 0x08, 0xA8,
+    0xFD, 0x17, 0xB4, 0x48, 0xA6, 0x85, 0x54, 0x19, 0x9C, 0x47, 0xD0, 0x8F, 0xFB, 0x10, 0xD4, 0xB8,
+};
+
+// `count` points b*G for random b
+static std::vector<uint8_t> randomPoints(CryptoOperations& crypto_ops, size_t count) {
+    std::vector<uint8_t> scalars(count * 32);
+    for (size_t i = 0; i < count; i++) {
+        crypto_ops.generateRandomScalar(&scalars[i * 32]);
+    }
+    std::vector<uint8_t> points(count * 65);
+    CHECK(crypto_ops.generatePointsFromScalars(scalars.data(), count, points.data()));
+    return points;
+}
+
+// `message` with one byte more and one byte less
+static std::vector<std::vector<uint8_t>> wrongLengths(const std::vector<uint8_t>& message) {
+    std::vector<uint8_t> longer = message;
+    longer.push_back(0);
+    std::vector<uint8_t> shorter(message.begin(), message.end() - 1);
+    return {longer, shorter};
+}
+
+static void testVersion() {
+    // Wire type 7 in the low bits: no protobuf message starts with it
+    CHECK((BinaryCodec::VERSION & 7) == 7);
+    CHECK(!BinaryCodec::isBinary({}));
+
+    std::vector<uint8_t> message;
+    BinaryCodec::encodeCorrelationDelta(1, 0, message);
+    CHECK(BinaryCodec::isBinary(message));
+    message[0] = 0x08;      // protobuf field 1, varint
+    CHECK(!BinaryCodec::isBinary(message));
+}
+
+static void testCorrelationDelta() {
+    std::vector<uint8_t> message;
+    BinaryCodec::encodeCorrelationDelta(0xDEADBEEF, MTAProtocol::SUPPORTED_FEATURES, message);
+    CHECK(message.size() == 9);
+
+    uint32_t delta = 0;
+    uint32_t features = 0;
+    CHECK(BinaryCodec::decodeCorrelationDelta(message, delta, features));
+    CHECK(delta == 0xDEADBEEF);
+    CHECK(features == MTAProtocol::SUPPORTED_FEATURES);
+
+    for (const auto& malformed : wrongLengths(message)) {
+        CHECK(!BinaryCodec::decodeCorrelationDelta(malformed, delta, features));
+    }
+    CHECK(!BinaryCodec::decodeCorrelationDelta({}, delta, features));
+    message[0] ^= 1;
+    CHECK(!BinaryCodec::decodeCorrelationDelta(message, delta, features));
+}
+
+static void testBobSetup(CryptoOperations& crypto_ops, uint32_t features) {
+    MTAProtocol::BobSetup setup;
+    setup.success = true;
+    setup.num_ot_instances = OT_INSTANCES;
+    setup.features = features;
+    setup.points_B = randomPoints(crypto_ops, OT_INSTANCES);
+    setup.public_key.assign(GENERATOR, GENERATOR + sizeof(GENERATOR));
+
+    std::vector<uint8_t> message;
+    BinaryCodec::encodeBobSetup(setup, message);
+    CHECK(message.size() == 12 + OT_INSTANCES * MTAProtocol::wirePointSize(features) + sizeof(GENERATOR));
+
+    MTAProtocol::BobSetup decoded;
+    CHECK(BinaryCodec::decodeBobSetup(message, decoded));
+    CHECK(decoded.success);
+    CHECK(decoded.num_ot_instances == OT_INSTANCES);
+    CHECK(decoded.features == features);
+    CHECK(decoded.points_B == setup.points_B);
+    CHECK(decoded.public_key == setup.public_key);
+
+    for (const auto& malformed : wrongLengths(message)) {
+        CHECK(!BinaryCodec::decodeBobSetup(malformed, decoded));
+    }
+    CHECK(!BinaryCodec::decodeBobSetup(std::span<const uint8_t>(message.data(), 11), decoded));
+
+    // More points than OT instances
+    std::vector<uint8_t> too_many = message;
+    too_many[2] = OT_INSTANCES + 1;
+    CHECK(!BinaryCodec::decodeBobSetup(too_many, decoded));
+
+    // A public key size past the end of the message
+    std::vector<uint8_t> long_key = message;
+    long_key[10] = 0xFF;
+    CHECK(!BinaryCodec::decodeBobSetup(long_key, decoded));
+}
+
+static void testAliceMessages(CryptoOperations& crypto_ops, uint32_t features, size_t count) {
+    MTAProtocol::AliceMessages messages;
+    messages.success = true;
+    messages.masked_share = 0x01020304;
+    messages.points_A = randomPoints(crypto_ops, count);
+    messages.encrypted_m0_messages.assign(count * 32, 0x5A);
+    messages.encrypted_m1_messages.assign(count * 32, 0xA5);
+
+    std::vector<uint8_t> message;
+    BinaryCodec::encodeAliceMessages(messages, features, message);
+    CHECK(message.size() == 6 + count * (MTAProtocol::wirePointSize(features) + 64));
+
+    MTAProtocol::AliceMessages decoded;
+    CHECK(BinaryCodec::decodeAliceMessages(message, features, decoded, count));
+    CHECK(decoded.success);
+    CHECK(decoded.masked_share == messages.masked_share);
+    CHECK(decoded.points_A == messages.points_A);
+    CHECK(decoded.encrypted_m0_messages == messages.encrypted_m0_messages);
+    CHECK(decoded.encrypted_m1_messages == messages.encrypted_m1_messages);
+
+    for (const auto& malformed : wrongLengths(message)) {
+        CHECK(!BinaryCodec::decodeAliceMessages(malformed, features, decoded, count));
+    }
+    // A frame of the wrong instance count
+    CHECK(!BinaryCodec::decodeAliceMessages(message, features, decoded, count == OT_INSTANCES ? 8 : OT_INSTANCES));
+    CHECK(!BinaryCodec::decodeAliceMessages(message, features, decoded, OT_INSTANCES + 1));
+    message[0] ^= 1;
+    CHECK(!BinaryCodec::decodeAliceMessages(message, features, decoded, count));
+}
+
+static void testInterleavedAliceMessages(CryptoOperations& crypto_ops, uint32_t features) {
+    features |= MTAProtocol::FEATURE_INTERLEAVED_MESSAGES;
+    MTAProtocol::AliceMessages messages;
+    messages.success = true;
+    messages.masked_share = 7;
+    messages.points_A = randomPoints(crypto_ops, OT_INSTANCES);
+    messages.encrypted_m0_messages.assign(OT_INSTANCES * 32, 0x11);
+    messages.encrypted_m1_messages.assign(OT_INSTANCES * 32, 0x22);
+
+    std::vector<uint8_t> message;
+    BinaryCodec::encodeAliceMessages(messages, features, message);
+    size_t record_size = MTAProtocol::interleavedRecordSize(features);
+    CHECK(message.size() == 6 + OT_INSTANCES * record_size);
+
+    // Record i: point A_i, then m0_i, then m1_i
+    const uint8_t* record = &message[6 + 5 * record_size];
+    size_t point_size = MTAProtocol::wirePointSize(features);
+    uint8_t point[65];
+    if (point_size == 33) {
+        CHECK(CryptoOperations::decompressPoints(record, 1, point));
+    } else {
+        std::memcpy(point, record, 65);
+    }
+    CHECK(std::memcmp(point, &messages.points_A[5 * 65], 65) == 0);
+    CHECK(record[point_size] == 0x11);
+    CHECK(record[point_size + 32] == 0x22);
+}
+
+static void testBobMessages() {
+    MTAProtocol::BobMessages messages;
+    messages.success = true;
+    messages.masked_share = 0xCAFEF00D;
+    messages.ot_responses.assign(3 * 32, 0x33);
+    messages.encrypted_result = {1, 2, 3, 4, 5};
+
+    std::vector<uint8_t> message;
+    BinaryCodec::encodeBobMessages(messages, message);
+    CHECK(message.size() == 10 + 3 * 32 + 5);
+
+    MTAProtocol::BobMessages decoded;
+    CHECK(BinaryCodec::decodeBobMessages(message, decoded));
+    CHECK(decoded.success);
+    CHECK(decoded.masked_share == messages.masked_share);
+    CHECK(decoded.ot_responses == messages.ot_responses);
+    CHECK(decoded.encrypted_result == messages.encrypted_result);
+
+    for (const auto& malformed : wrongLengths(message)) {
+        CHECK(!BinaryCodec::decodeBobMessages(malformed, decoded));
+    }
+    CHECK(!BinaryCodec::decodeBobMessages(std::span<const uint8_t>(message.data(), 9), decoded));
+
+    // Counts that claim more bytes than there are
+    std::vector<uint8_t> many_responses = message;
+    many_responses[6] = 4;
+    CHECK(!BinaryCodec::decodeBobMessages(many_responses, decoded));
+    std::vector<uint8_t> long_result = message;
+    long_result[8] = 6;
+    CHECK(!BinaryCodec::decodeBobMessages(long_result, decoded));
+
+    // The server's BobMessages: no responses, no result
+    MTAProtocol::BobMessages bare;
+    bare.success = true;
+    bare.masked_share = 9;
+    BinaryCodec::encodeBobMessages(bare, message);
+    CHECK(message.size() == 10);
+    CHECK(BinaryCodec::decodeBobMessages(message, decoded));
+    CHECK(decoded.masked_share == 9 && decoded.ot_responses.empty() && decoded.encrypted_result.empty());
+}
+
+static void testDecompressPoints(CryptoOperations& crypto_ops) {
+    // G compresses to 02 || x (its y is even) and back
+    uint8_t compressed[33];
+    CryptoOperations::compressPoints(GENERATOR, 1, compressed);
+    CHECK(compressed[0] == 0x02);
+    CHECK(std::memcmp(compressed + 1, GENERATOR + 1, 32) == 0);
+    uint8_t point[65];
+    CHECK(CryptoOperations::decompressPoints(compressed, 1, point));
+    CHECK(std::memcmp(point, GENERATOR, 65) == 0);
+
+    // -G: same x, odd y
+    compressed[0] = 0x03;
+    CHECK(CryptoOperations::decompressPoints(compressed, 1, point));
+    CHECK(std::memcmp(point + 1, GENERATOR + 1, 32) == 0);
+    CHECK(std::memcmp(point + 33, GENERATOR + 33, 32) != 0);
+    CHECK(point[64] & 1);
+
+    // A batch of random points
+    std::vector<uint8_t> points = randomPoints(crypto_ops, OT_INSTANCES);
+    std::vector<uint8_t> batch(OT_INSTANCES * 33);
+    CryptoOperations::compressPoints(points.data(), OT_INSTANCES, batch.data());
+    std::vector<uint8_t> decompressed(OT_INSTANCES * 65);
+    CHECK(CryptoOperations::decompressPoints(batch.data(), OT_INSTANCES, decompressed.data()));
+    CHECK(decompressed == points);
+
+    // Any bad point fails the whole batch: a prefix other than 02 or 03,
+    // x = 5 (5^3 + 7 is not a square mod p), and x >= p
+    std::vector<uint8_t> bad_prefix = batch;
+    bad_prefix[7 * 33] = 0x04;
+    CHECK(!CryptoOperations::decompressPoints(bad_prefix.data(), OT_INSTANCES, decompressed.data()));
+
+    std::vector<uint8_t> off_curve = batch;
+    std::memset(&off_curve[9 * 33 + 1], 0, 32);
+    off_curve[9 * 33 + 32] = 5;
+    CHECK(!CryptoOperations::decompressPoints(off_curve.data(), OT_INSTANCES, decompressed.data()));
+
+    std::vector<uint8_t> past_prime = batch;
+    std::memset(&past_prime[31 * 33 + 1], 0xFF, 32);
+    CHECK(!CryptoOperations::decompressPoints(past_prime.data(), OT_INSTANCES, decompressed.data()));
+
+    // A compressed BobSetup carrying the off-curve point does not decode
+    MTAProtocol::BobSetup setup;
+    setup.success = true;
+    setup.features = MTAProtocol::FEATURE_COMPRESSED_POINTS;
+    setup.points_B = points;
+    std::vector<uint8_t> message;
+    BinaryCodec::encodeBobSetup(setup, message);
+    std::memcpy(&message[12 + 9 * 33], &off_curve[9 * 33], 33);
+    MTAProtocol::BobSetup decoded;
+    CHECK(!BinaryCodec::decodeBobSetup(message, decoded));
+}
+
+int main() {
+    CryptoOperations crypto_ops;
+
+    testVersion();
+    testCorrelationDelta();
+    testBobSetup(crypto_ops, 0);
+    testBobSetup(crypto_ops, MTAProtocol::FEATURE_COMPRESSED_POINTS);
+    testAliceMessages(crypto_ops, 0, OT_INSTANCES);
+    testAliceMessages(crypto_ops, MTAProtocol::FEATURE_COMPRESSED_POINTS, OT_INSTANCES);
+    testAliceMessages(crypto_ops, MTAProtocol::FEATURE_STREAMED_SETUP, MTAProtocol::STREAM_CHUNK);
+    testInterleavedAliceMessages(crypto_ops, 0);
+    testInterleavedAliceMessages(crypto_ops, MTAProtocol::FEATURE_COMPRESSED_POINTS);
+    testBobMessages();
+    testDecompressPoints(crypto_ops);
+
+    if (failures > 0) {
+        std::fprintf(stderr, "%d checks failed\n", failures);
+        return 1;
+    }
+    std::printf("binary_codec_test: all checks passed\n");
+    return 0;
+}
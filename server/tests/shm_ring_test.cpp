@@ -0,0 +1,178 @@
+// ShmChannel against a peer that writes impossible ring indices: the channel
+// must move nothing and report the peer gone. Prints each failed check and
+// exits non-zero if there was one.
+
+#include <cstdio>
+#include <cstring>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "shm_ring.h"
+
+static int failures = 0;
+
+#define CHECK(condition)                                                                    \
+    do {                                                                                    \
+        if (!(condition)) {                                                                 \
+            std::fprintf(stderr, "%s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, #condition); \
+            failures++;                                                                     \
+        }                                                                                   \
+    } while (0)
+
+static const size_t RING_CAPACITY = 4096;
+
+// The server side of a fresh channel plus the peer's own mapping of the
+// region, received the way a client would receive it
+struct Fixture {
+    ShmChannel* channel = nullptr;
+    ShmRegionHeader* header = nullptr;
+    uint8_t* base = nullptr;
+    size_t mapped_size = 0;
+    int fds[3] = {-1, -1, -1};
+
+    bool open() {
+        channel = ShmChannel::create(RING_CAPACITY);
+        int sockets[2];
+        if (channel == nullptr || socketpair(AF_UNIX, SOCK_STREAM, 0, sockets) != 0) {
+            return false;
+        }
+        bool sent = channel->sendDescriptors(sockets[0]);
+
+        uint8_t tag = 0;
+        iovec iov = {&tag, sizeof(tag)};
+        alignas(cmsghdr) char control[CMSG_SPACE(sizeof(fds))];
+        msghdr message;
+        std::memset(&message, 0, sizeof(message));
+        message.msg_iov = &iov;
+        message.msg_iovlen = 1;
+        message.msg_control = control;
+        message.msg_controllen = sizeof(control);
+        bool received = sent && recvmsg(sockets[1], &message, 0) == 1;
+        close(sockets[0]);
+        close(sockets[1]);
+        cmsghdr* cmsg = received ? CMSG_FIRSTHDR(&message) : nullptr;
+        if (cmsg == nullptr) {
+            return false;
+        }
+        std::memcpy(fds, CMSG_DATA(cmsg), sizeof(fds));
+
+        struct stat info;
+        if (fstat(fds[0], &info) != 0) {
+            return false;
+        }
+        mapped_size = static_cast<size_t>(info.st_size);
+        void* mapping = mmap(nullptr, mapped_size, PROT_READ | PROT_WRITE, MAP_SHARED, fds[0], 0);
+        if (mapping == MAP_FAILED) {
+            return false;
+        }
+        base = static_cast<uint8_t*>(mapping);
+        header = static_cast<ShmRegionHeader*>(mapping);
+        return true;
+    }
+
+    ~Fixture() {
+        if (base != nullptr) {
+            munmap(base, mapped_size);
+        }
+        for (int fd : fds) {
+            if (fd >= 0) {
+                close(fd);
+            }
+        }
+        delete channel;
+    }
+};
+
+static void testValidIndices() {
+    Fixture fixture;
+    CHECK(fixture.open());
+    if (fixture.header == nullptr) {
+        return;
+    }
+
+    // The peer publishes five bytes on the client -> server ring
+    uint8_t* inbound = fixture.base + ((sizeof(ShmRegionHeader) + 63) & ~size_t(63));
+    std::memcpy(inbound, "hello", 5);
+    fixture.header->rings[0].tail.store(5, std::memory_order_release);
+
+    uint8_t data[16];
+    CHECK(fixture.channel->tryRead(data, sizeof(data)) == 5);
+    CHECK(std::memcmp(data, "hello", 5) == 0);
+    CHECK(fixture.channel->tryWrite(data, 5) == 5);
+    CHECK(fixture.header->rings[1].tail.load() == 5);
+    CHECK(!fixture.channel->peerClosed());
+}
+
+static void testInboundTailTooFar() {
+    Fixture fixture;
+    CHECK(fixture.open());
+    if (fixture.header == nullptr) {
+        return;
+    }
+
+    // More bytes published than the ring can hold
+    fixture.header->rings[0].tail.store(RING_CAPACITY + 1, std::memory_order_release);
+    uint8_t data[16];
+    CHECK(fixture.channel->tryRead(data, sizeof(data)) == 0);
+    CHECK(fixture.channel->peerClosed());
+    CHECK(fixture.header->rings[0].head.load() == 0);
+}
+
+static void testInboundHeadPastTail() {
+    Fixture fixture;
+    CHECK(fixture.open());
+    if (fixture.header == nullptr) {
+        return;
+    }
+
+    // Our own head moved past the peer's tail: tail - head wraps around
+    fixture.header->rings[0].head.store(8, std::memory_order_release);
+    fixture.header->rings[0].tail.store(4, std::memory_order_release);
+    uint8_t data[16];
+    CHECK(fixture.channel->tryRead(data, sizeof(data)) == 0);
+    CHECK(fixture.channel->peerClosed());
+}
+
+static void testOutboundHeadPastTail() {
+    Fixture fixture;
+    CHECK(fixture.open());
+    if (fixture.header == nullptr) {
+        return;
+    }
+
+    // The peer claims to have consumed bytes we never wrote
+    fixture.header->rings[1].head.store(1, std::memory_order_release);
+    uint8_t data[16] = {0};
+    CHECK(fixture.channel->tryWrite(data, sizeof(data)) == 0);
+    CHECK(fixture.channel->peerClosed());
+    CHECK(fixture.header->rings[1].tail.load() == 0);
+}
+
+static void testOutboundTailTooFar() {
+    Fixture fixture;
+    CHECK(fixture.open());
+    if (fixture.header == nullptr) {
+        return;
+    }
+
+    fixture.header->rings[1].tail.store(RING_CAPACITY + 1, std::memory_order_release);
+    uint8_t data[16] = {0};
+    CHECK(fixture.channel->tryWrite(data, sizeof(data)) == 0);
+    CHECK(fixture.channel->peerClosed());
+}
+
+int main() {
+    testValidIndices();
+    testInboundTailTooFar();
+    testInboundHeadPastTail();
+    testOutboundHeadPastTail();
+    testOutboundTailTooFar();
+
+    if (failures > 0) {
+        std::fprintf(stderr, "%d checks failed\n", failures);
+        return 1;
+    }
+    std::printf("shm_ring_test: all checks passed\n");
+    return 0;
+}